@@ -217,6 +217,20 @@ static double get_u01(void *param, void *state)
     return uint32_to_udouble(get_bits32(param, state));
 }
 
+static void get_array32(void *param, void *state, uint32_t *out, size_t len)
+{
+    ChaChaAVXState *obj = state;
+    (void) param;
+    for (size_t i = 0; i < len; i++) {
+        if (obj->pos >= 32) {
+            ChaChaAVX_inc_counter(obj);
+            ChaChaAVX_block(obj);
+            obj->pos = 0;
+        }
+        out[i] = obj->out[obj->pos++];
+    }
+}
+
 
 static void *init_state(void)
 {
@@ -315,7 +329,7 @@ int EXPORT gen_closelib(void)
     return 1;
 }
 
-int EXPORT gen_getinfo(GenInfoC *gi)
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size)
 {
     static const char name[] = "ChaCha12AVX";
     gi->name = name;
@@ -323,6 +337,13 @@ int EXPORT gen_getinfo(GenInfoC *gi)
     gi->delete_state = delete_state;
     gi->get_u01 = get_u01;
     gi->get_bits32 = get_bits32;
+    gi->get_array32 = get_array32;
     gi->run_self_test = run_self_test;
+    GenInfoC_set_flags(gi, size, GENINFOC_FLAG_VECTORIZED | GENINFOC_FLAG_COUNTER);
     return 1;
 }
+
+int EXPORT gen_getinfo(GenInfoC *gi)
+{
+    return gen_getinfo2(gi, GENINFOC_BASE_SIZE);
+}
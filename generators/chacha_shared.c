@@ -351,7 +351,7 @@ int EXPORT gen_closelib()
     return 1;
 }
 
-int EXPORT gen_getinfo(GenInfoC *gi)
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size)
 {
     if (!intf.strcmp(gi->options, "20")) {
         gi->name = "ChaCha20";
@@ -374,5 +374,11 @@ int EXPORT gen_getinfo(GenInfoC *gi)
     gi->get_bits32 = get_bits32;
     gi->get_array32 = get_array32;
     gi->run_self_test = run_self_test;
+    GenInfoC_set_flags(gi, size, GENINFOC_FLAG_VECTORIZED | GENINFOC_FLAG_COUNTER);
     return 1;
 }
+
+int EXPORT gen_getinfo(GenInfoC *gi)
+{
+    return gen_getinfo2(gi, GENINFOC_BASE_SIZE);
+}
@@ -21,3 +21,8 @@ EXPORT int gen_getinfo(GenInfoC *gi)
 {
     return dummy_gen_getinfo(gi);
 }
+
+EXPORT int gen_getinfo2(GenInfoC *gi, size_t size)
+{
+    return dummy_gen_getinfo2(gi, size);
+}
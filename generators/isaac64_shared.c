@@ -250,7 +250,7 @@ static int run_self_test(void)
 ///// Exported functions (module interface) /////
 /////////////////////////////////////////////////
 
-int EXPORT gen_getinfo(GenInfoC *gi)
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size)
 {
     static const char name[] = "ISAAC64";
     gi->name = name;
@@ -261,5 +261,11 @@ int EXPORT gen_getinfo(GenInfoC *gi)
     gi->get_bits64 = get_bits64;
     gi->get_array64 = get_array64;
     gi->run_self_test = run_self_test;
+    GenInfoC_set_flags(gi, size, GENINFOC_FLAG_NATIVE64 | GENINFOC_FLAG_VECTORIZED);
     return 1;
 }
+
+int EXPORT gen_getinfo(GenInfoC *gi)
+{
+    return gen_getinfo2(gi, GENINFOC_BASE_SIZE);
+}
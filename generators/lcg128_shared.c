@@ -17,6 +17,9 @@
  * In scientific publications which used this software, a reference to it
  * would be appreciated.
  */
+#define PRNG_FLAGS GENINFOC_FLAG_JUMPABLE
+#define PRNG_JUMP jump
+#define PRNG_PERIOD_LOG2 128
 #include "testu01th/cinterface.h"
 
 PRNG_CMODULE_PROLOG
@@ -57,6 +60,43 @@ static inline uint64_t get_bits64_raw(void *param, void *state)
 }
 
 
+/**
+ * @brief Jump by 2^log2_distance steps: x -> A*x + C where the (A, C) pair
+ * is obtained by log2_distance squarings of the x -> a*x + 1 map.
+ */
+static void jump(void *param, void *state, unsigned int log2_distance)
+{
+    Lcg128State *obj = state;
+    (void) param;
+#ifdef UINT128_ENABLED
+    unsigned __int128 a = 18000690696906969069ull, c = 1;
+    for (unsigned int i = 0; i < log2_distance; i++) {
+        c *= a + 1;
+        a *= a;
+    }
+    obj->x = a * obj->x + c;
+#else
+    uint64_t a_lo = 18000690696906969069ull, a_hi = 0, c_lo = 1, c_hi = 0;
+    uint64_t hi, lo;
+    for (unsigned int i = 0; i < log2_distance; i++) {
+        // c *= a + 1
+        uint64_t b_lo = a_lo + 1, b_hi = a_hi + (b_lo == 0);
+        lo = unsigned_mul128(c_lo, b_lo, &hi);
+        c_hi = hi + c_lo * b_hi + c_hi * b_lo;
+        c_lo = lo;
+        // a *= a
+        lo = unsigned_mul128(a_lo, a_lo, &hi);
+        a_hi = hi + 2 * a_lo * a_hi;
+        a_lo = lo;
+    }
+    lo = unsigned_mul128(a_lo, obj->x_low, &hi);
+    hi += a_lo * obj->x_high + a_hi * obj->x_low;
+    obj->x_low = lo + c_lo;
+    obj->x_high = hi + c_hi + (obj->x_low < lo);
+#endif
+}
+
+
 static void *init_state(void)
 {
     Lcg128State *obj = intf.malloc(sizeof(Lcg128State));
@@ -25,6 +25,9 @@
  *
  * This software is provided under the Apache 2 License.
  */
+#define PRNG_FLAGS GENINFOC_FLAG_JUMPABLE
+#define PRNG_JUMP jump
+#define PRNG_PERIOD_LOG2 127
 #include "testu01th/cinterface.h"
 
 PRNG_CMODULE_PROLOG
@@ -66,6 +69,69 @@ static inline uint64_t get_bits64_raw(void *param, void *state)
 }
 
 
+/**
+ * @brief 128-bit unsigned integer for modular arithmetics.
+ */
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} MwcU128;
+
+/**
+ * @brief Returns (x + y) mod m, x and y must be less than m.
+ */
+static inline MwcU128 mwc_addmod(MwcU128 x, MwcU128 y, MwcU128 m)
+{
+    MwcU128 s;
+    s.lo = x.lo + y.lo;
+    s.hi = x.hi + y.hi + (s.lo < x.lo);
+    int carry = (s.hi < x.hi) || (s.hi == x.hi && s.lo < x.lo);
+    if (carry || s.hi > m.hi || (s.hi == m.hi && s.lo >= m.lo)) {
+        uint64_t borrow = s.lo < m.lo;
+        s.lo -= m.lo;
+        s.hi -= m.hi + borrow;
+    }
+    return s;
+}
+
+/**
+ * @brief Returns (x * y) mod m, x must be less than m.
+ */
+static MwcU128 mwc_mulmod(MwcU128 x, MwcU128 y, MwcU128 m)
+{
+    MwcU128 r = {0, 0};
+    for (int i = 127; i >= 0; i--) {
+        r = mwc_addmod(r, r, m);
+        uint64_t w = (i >= 64) ? y.hi : y.lo;
+        if ((w >> (i & 63)) & 1) {
+            r = mwc_addmod(r, x, m);
+        }
+    }
+    return r;
+}
+
+/**
+ * @brief Jump by 2^log2_distance steps. MWC is equivalent to LCG
+ * s -> A*s mod m where s = c*2^64 + x and m = A*2^64 - 1, so the state
+ * is multiplied by A^(2^log2_distance) mod m.
+ */
+static void jump(void *param, void *state, unsigned int log2_distance)
+{
+    static const uint64_t MWC_A1 = 0xffebb71d94fcdaf9;
+    MWC128XState *obj = state;
+    MwcU128 m = {0xFFFFFFFFFFFFFFFF, MWC_A1 - 1};
+    MwcU128 a = {MWC_A1, 0}, s = {obj->x, obj->c};
+    (void) param;
+    for (unsigned int i = 0; i < log2_distance; i++) {
+        a = mwc_mulmod(a, a, m);
+    }
+    s = mwc_mulmod(s, a, m);
+    obj->x = s.lo;
+    obj->c = s.hi;
+    Interleaved32Buffer_init(&obj->i32buf);
+}
+
+
 static void *init_state(void)
 {
     MWC128XState *obj = intf.malloc(sizeof(MWC128XState));
@@ -60,6 +60,7 @@ static void PhiloxState_init(PhiloxState *obj, const uint64_t *key)
         obj->key[i] = key[i];
         obj->ctr[i] = 0;
     }
+    obj->pos = Nw;
 }
 
 static inline void philox_bumpkey(uint64_t *key)
@@ -216,6 +217,34 @@ static void get_array64(void *param, void *state, uint64_t *out, size_t len)
 }
 
 
+/**
+ * @brief Jump by 2^log2_distance outputs: each block contains Nw = 4
+ * outputs, so the 128-bit counter is increased by 2^(log2_distance - 2).
+ */
+static void jump(void *param, void *state, unsigned int log2_distance)
+{
+    PhiloxState *obj = state;
+    if (log2_distance < 2) {
+        for (size_t i = 0; i < (1u << log2_distance); i++) {
+            (void) get_bits64(param, state);
+        }
+        return;
+    }
+    unsigned int sh = log2_distance - 2;
+    if (sh < 64) {
+        uint64_t inc = 1ull << sh;
+        obj->ctr[0] += inc;
+        if (obj->ctr[0] < inc) obj->ctr[1]++;
+    } else if (sh < 128) {
+        obj->ctr[1] += 1ull << (sh - 64);
+    }
+    // Rest of the current block is taken from the new block
+    if (obj->pos < Nw) {
+        PhiloxState_block10(obj);
+    }
+}
+
+
 unsigned long EXPORT get_bits32(void *param, void *state)
 {
 
@@ -230,17 +259,26 @@ static double get_u01(void *param, void *state)
 }
 
 
-static void *init_state(void)
+static void *init_state_seeded(const uint64_t *seed, size_t nwords)
 {
     uint64_t k[Nw];
     PhiloxState *obj = intf.malloc(sizeof(PhiloxState));
     for (size_t i = 0; i < Nw; i++) {
-        k[i] = intf.get_seed64();
+        k[i] = (i < nwords) ? seed[i] : 0;
     }
     PhiloxState_init(obj, k);
     return (void *) obj;
 }
 
+static void *init_state(void)
+{
+    uint64_t k[Nw];
+    for (size_t i = 0; i < Nw; i++) {
+        k[i] = intf.get_seed64();
+    }
+    return init_state_seeded(k, Nw);
+}
+
 
 static void delete_state(void *param, void *state)
 {
@@ -249,7 +287,7 @@ static void delete_state(void *param, void *state)
 }
 
 
-int EXPORT gen_getinfo(GenInfoC *gi)
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size)
 {
     static const char name[] = "Philox4x64x10";
     gi->name = name;
@@ -260,5 +298,21 @@ int EXPORT gen_getinfo(GenInfoC *gi)
     gi->get_bits64 = get_bits64;
     gi->get_array64 = get_array64;
     gi->run_self_test = run_self_test;
+    if (GENINFOC_HAS_FIELD(size, init_state_seeded)) {
+        gi->init_state_seeded = init_state_seeded;
+    }
+    if (GENINFOC_HAS_FIELD(size, jump)) {
+        gi->jump = jump;
+    }
+    if (GENINFOC_HAS_FIELD(size, period_log2)) {
+        gi->period_log2 = 130; // 128-bit counter, 4 outputs per block
+    }
+    GenInfoC_set_flags(gi, size, GENINFOC_FLAG_NATIVE64 | GENINFOC_FLAG_COUNTER |
+        GENINFOC_FLAG_JUMPABLE);
     return 1;
 }
+
+int EXPORT gen_getinfo(GenInfoC *gi)
+{
+    return gen_getinfo2(gi, GENINFOC_BASE_SIZE);
+}
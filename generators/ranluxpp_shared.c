@@ -242,7 +242,7 @@ static int run_self_test(void)
  *
  * The default option is u64.
  */
-int EXPORT gen_getinfo(GenInfoC *gi)
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size)
 {
     gi->init_state = init_state;
     gi->delete_state = delete_state;
@@ -250,10 +250,12 @@ int EXPORT gen_getinfo(GenInfoC *gi)
     if (!intf.strcmp(gi->options, "u32")) {
         gi->name = "RANLUX++:u32";
         gi->get_u01 = get_u01_from32;
+        GenInfoC_set_flags(gi, size, 0);
     } else {
         gi->name = "RANLUX++:u64";
         gi->get_u01 = get_u01;
         gi->get_bits64 = get_bits64;
+        GenInfoC_set_flags(gi, size, GENINFOC_FLAG_NATIVE64);
         // Warning in the case of unknown option.
         if (intf.strcmp(gi->options, "u64") &&
             intf.strcmp(gi->options, "")) {
@@ -263,3 +265,8 @@ int EXPORT gen_getinfo(GenInfoC *gi)
     gi->run_self_test = run_self_test;
     return 1;
 }
+
+int EXPORT gen_getinfo(GenInfoC *gi)
+{
+    return gen_getinfo2(gi, GENINFOC_BASE_SIZE);
+}
@@ -58,7 +58,7 @@ static void delete_state(void *param, void *state)
 }
 
 
-int EXPORT gen_getinfo(GenInfoC *gi)
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size)
 {
     static const char name[] = "seed64";
     gi->name = name;
@@ -67,5 +67,11 @@ int EXPORT gen_getinfo(GenInfoC *gi)
     gi->get_u01 = get_u01;
     gi->get_bits32 = get_bits32;
     gi->get_bits64 = get_bits64;
+    GenInfoC_set_flags(gi, size, GENINFOC_FLAG_NATIVE64);
     return 1;
 }
+
+int EXPORT gen_getinfo(GenInfoC *gi)
+{
+    return gen_getinfo2(gi, GENINFOC_BASE_SIZE);
+}
@@ -24,6 +24,7 @@
  *
  * This software is provided under the Apache 2 License.
  */
+#define PRNG_FLAGS (GENINFOC_FLAG_VECTORIZED | GENINFOC_FLAG_COUNTER)
 #include "testu01th/cinterface.h"
 #include <x86intrin.h>
 
@@ -27,6 +27,7 @@
  *
  * This software is provided under the Apache 2 License.
  */
+#define PRNG_FLAGS (GENINFOC_FLAG_COUNTER)
 #include "testu01th/cinterface.h"
 
 PRNG_CMODULE_PROLOG
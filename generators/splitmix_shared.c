@@ -2,12 +2,9 @@
 #include "testu01th/splitmix_gen.h"
 #include <stdio.h>
 
-static GenInfoC gi;
-
 int EXPORT gen_initlib(CallerAPI *intf)
 {
     (void) intf;
-    splitmix_get_geninfo(&gi);
     return 1;
 }
 
@@ -16,8 +13,12 @@ int EXPORT gen_closelib()
     return 1;
 }
 
-int EXPORT gen_getinfo(GenInfoC *gi_out)
+int EXPORT gen_getinfo(GenInfoC *gi)
 {
-    *gi_out = gi;
-    return 1;
+    return splitmix_get_geninfo(gi, GENINFOC_BASE_SIZE);
+}
+
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size)
+{
+    return splitmix_get_geninfo(gi, size);
 }
@@ -16,6 +16,10 @@
  *
  * This software is provided under the Apache 2 License.
  */
+#define PRNG_FLAGS (GENINFOC_FLAG_COUNTER | GENINFOC_FLAG_JUMPABLE)
+#define PRNG_INIT_STATE_SEEDED init_state_seeded
+#define PRNG_JUMP jump
+#define PRNG_PERIOD_LOG2 64
 #include "testu01th/cinterface.h"
 
 PRNG_CMODULE_PROLOG
@@ -42,12 +46,31 @@ static inline uint64_t get_bits64_raw(void *param, void *state)
     return t ^ ((x * x + y) >> 32); // Round 5
 }
 
-static void *init_state(void)
+/**
+ * @brief Jump by 2^log2_distance outputs (the period is 2^64).
+ */
+static void jump(void *param, void *state, unsigned int log2_distance)
+{
+    Squares64State *obj = state;
+    (void) param;
+    if (log2_distance < 64) {
+        obj->ctr += 1ull << log2_distance;
+    }
+    Interleaved32Buffer_init(&obj->i32buf);
+}
+
+static void *init_state_seeded(const uint64_t *seed, size_t nwords)
 {
     Squares64State *obj = intf.malloc(sizeof(Squares64State));
-    obj->ctr = intf.get_seed64();
+    obj->ctr = (nwords > 0) ? seed[0] : 0;
     Interleaved32Buffer_init(&obj->i32buf);
     return (void *) obj;
 }
 
+static void *init_state(void)
+{
+    uint64_t seed = intf.get_seed64();
+    return init_state_seeded(&seed, 1);
+}
+
 MAKE_UINT64_INTERLEAVED32_PRNG("Squares64", Squares64State, NULL)
@@ -36,6 +36,10 @@
  * In scientific publications which used this software, a reference to it
  * would be appreciated.
  */
+#define PRNG_FLAGS (GENINFOC_FLAG_COUNTER | GENINFOC_FLAG_JUMPABLE)
+#define PRNG_INIT_STATE_SEEDED init_state_seeded
+#define PRNG_JUMP jump
+#define PRNG_PERIOD_LOG2 130
 #include "testu01th/cinterface.h"
 
 #define Nw 4
@@ -64,6 +68,7 @@ static void Tf256State_init(Tf256State *obj, const uint64_t *k)
         obj->p[i] = 0;
         obj->k[Nw] ^= obj->k[i];
     }
+    obj->pos = Nw;
     Interleaved32Buffer_init(&obj->i32buf);
 }
 
@@ -249,16 +254,54 @@ static inline uint64_t get_bits64_raw(void *param, void *state)
 }
 
 
-static void *init_state(void)
+/**
+ * @brief Jump by 2^log2_distance outputs: each block contains Nw = 4
+ * outputs, so the 128-bit counter is increased by 2^(log2_distance - 2).
+ */
+static void jump(void *param, void *state, unsigned int log2_distance)
+{
+    Tf256State *obj = state;
+    Interleaved32Buffer_init(&obj->i32buf);
+    if (log2_distance < 2) {
+        for (size_t i = 0; i < (1u << log2_distance); i++) {
+            (void) get_bits64_raw(param, state);
+        }
+        return;
+    }
+    unsigned int sh = log2_distance - 2;
+    if (sh < 64) {
+        uint64_t inc = 1ull << sh;
+        obj->p[0] += inc;
+        if (obj->p[0] < inc) obj->p[1]++;
+    } else if (sh < 128) {
+        obj->p[1] += 1ull << (sh - 64);
+    }
+    // Rest of the current block is taken from the new block
+    if (obj->pos < Nw) {
+        Tf256State_block20(obj);
+    }
+}
+
+
+static void *init_state_seeded(const uint64_t *seed, size_t nwords)
 {
     uint64_t k[Nw];
     Tf256State *obj = intf.malloc(sizeof(Tf256State));
     for (size_t i = 0; i < Nw; i++) {
-        k[i] = intf.get_seed64();
+        k[i] = (i < nwords) ? seed[i] : 0;
     }
     Tf256State_init(obj, k);
     return (void *) obj;
 }
 
+static void *init_state(void)
+{
+    uint64_t k[Nw];
+    for (size_t i = 0; i < Nw; i++) {
+        k[i] = intf.get_seed64();
+    }
+    return init_state_seeded(k, Nw);
+}
+
 
 MAKE_UINT64_INTERLEAVED32_PRNG("Threefry4x64x20", Tf256State, run_self_test)
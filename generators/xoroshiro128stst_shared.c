@@ -11,6 +11,10 @@
  * This software is provided under the Apache 2 License.
  */
 
+#define PRNG_FLAGS GENINFOC_FLAG_JUMPABLE
+#define PRNG_INIT_STATE_SEEDED init_state_seeded
+#define PRNG_JUMP jump
+#define PRNG_PERIOD_LOG2 127
 #include "testu01th/cinterface.h"
 
 PRNG_CMODULE_PROLOG
@@ -39,15 +43,68 @@ static inline uint64_t get_bits64_raw(void *param, void *state)
 	return result;
 }
 
-static void *init_state(void)
+/**
+ * @brief Multiplies the 128x128 matrix over GF(2) by the vector.
+ * @param m  Matrix columns.
+ */
+static inline void gf2_mul_vec(uint64_t (*m)[2], const uint64_t *v, uint64_t *out)
+{
+    out[0] = 0; out[1] = 0;
+    for (int j = 0; j < 128; j++) {
+        if ((v[j >> 6] >> (j & 63)) & 1) {
+            out[0] ^= m[j][0];
+            out[1] ^= m[j][1];
+        }
+    }
+}
+
+/**
+ * @brief Jump by 2^log2_distance outputs. The transition function
+ * is linear over GF(2): its matrix is squared log2_distance times
+ * and applied to the state.
+ */
+static void jump(void *param, void *state, unsigned int log2_distance)
+{
+    PrngState *obj = state;
+    uint64_t m[128][2], m2[128][2], s[2];
+    (void) param;
+    // Columns of the matrix are the images of unit vectors
+    for (int j = 0; j < 128; j++) {
+        PrngState e;
+        e.s[0] = 0; e.s[1] = 0;
+        e.s[j >> 6] = 1ull << (j & 63);
+        (void) get_bits64_raw(NULL, &e);
+        m[j][0] = e.s[0]; m[j][1] = e.s[1];
+    }
+    for (unsigned int i = 0; i < log2_distance; i++) {
+        for (int j = 0; j < 128; j++) {
+            gf2_mul_vec(m, m[j], m2[j]);
+        }
+        for (int j = 0; j < 128; j++) {
+            m[j][0] = m2[j][0]; m[j][1] = m2[j][1];
+        }
+    }
+    gf2_mul_vec(m, obj->s, s);
+    obj->s[0] = s[0]; obj->s[1] = s[1];
+}
+
+static void *init_state_seeded(const uint64_t *seed, size_t nwords)
 {
     const uint64_t phi = 0x9E3779B97F4A7C15ull; // Golden ratio
     PrngState *obj = intf.malloc(sizeof(PrngState));
-    obj->s[0] = intf.get_seed64();
-    obj->s[1] = intf.get_seed64();
+    obj->s[0] = (nwords > 0) ? seed[0] : 0;
+    obj->s[1] = (nwords > 1) ? seed[1] : 0;
     if (obj->s[0] == 0) obj->s[0] = phi;
     if (obj->s[1] == 0) obj->s[1] = phi;
     return (void *) obj;
 }
 
+static void *init_state(void)
+{
+    uint64_t seed[2];
+    seed[0] = intf.get_seed64();
+    seed[1] = intf.get_seed64();
+    return init_state_seeded(seed, 2);
+}
+
 MAKE_UINT64_UPTO32_PRNG("xoroshiro128**", NULL)
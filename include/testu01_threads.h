@@ -23,4 +23,10 @@
 #include "testu01th/generators.h"
 #include "testu01th/dummy_module.h"
 #include "testu01th/speedtest.h"
+#include "testu01th/speed_report.h"
+#include "testu01th/perf_counters.h"
+#include "testu01th/stream_writer.h"
+#include "testu01th/file_dump.h"
+#include "testu01th/mapped_file.h"
+#include "testu01th/fanout_reader.h"
 #endif
@@ -15,6 +15,10 @@
  * - `int EXPORT gen_closelib()` (run before unloading the library)
  * - `int EXPORT gen_getinfo(GenInfoC *gi)` (fills GenInfoC structure
  *   with function pointers for the used PRNG)
+ *
+ * The optional `int EXPORT gen_getinfo2(GenInfoC *gi, size_t size)` also
+ * fills the extended fields of GenInfoC that fit into `size` bytes; it is
+ * used instead of `gen_getinfo` if it is exported.
  * 
  * This file is designed for both C and C++ programs. Please, don't add
  * anything C++-specific here!
@@ -33,6 +37,7 @@
 #ifndef __TESTU01_CINTERFACE
 #define __TESTU01_CINTERFACE
 #include <stdint.h>
+#include <stddef.h>
 #include <time.h>
 
 ///////////////////////////
@@ -94,16 +99,35 @@ typedef void (*GetArray32CallbackC)(void *param, void *state, uint32_t *out, siz
 typedef void (*GetArray64CallbackC)(void *param, void *state, uint64_t *out, size_t len);
 typedef uint32_t (*GetSum32CallbackC)(void *param, void *state, size_t len);
 typedef uint64_t (*GetSum64CallbackC)(void *param, void *state, size_t len);
+typedef void (*GetArrayU01CallbackC)(void *param, void *state, double *out, size_t len);
 typedef void *(*InitStateCallbackC)(void);
+typedef void *(*InitStateSeededCallbackC)(const uint64_t *seed, size_t nwords);
+typedef void (*JumpCallbackC)(void *param, void *state, unsigned int log2_distance);
 typedef void (*DeleteStateCallbackC)(void *param, void *state);
 typedef uint64_t (*GetSeed64CallbackC)(void);
 typedef int (*SelfTestCallbackC)(void);
 
+/*
+ * Capability flags of the PRNG module (GenInfoC.flags field). They are
+ * hints that help the caller to select the fastest path of generation.
+ */
+#define GENINFOC_FLAG_NATIVE64   0x1 ///< get_bits64 returns native 64-bit outputs
+#define GENINFOC_FLAG_VECTORIZED 0x2 ///< Outputs are made in blocks, get_array32/64 are the fastest path
+#define GENINFOC_FLAG_COUNTER    0x4 ///< Counter-based generator (e.g. a block cipher in CTR mode)
+#define GENINFOC_FLAG_JUMPABLE   0x8 ///< Generator supports jumps (the `jump` callback)
+#define GENINFOC_FLAG_THREADSAFE 0x10 ///< No global mutable data: states may be used from different threads
+
 /**
  * @brief Keeps the information for initialization and destruction
  * of PRNG objects. Can be considered as UniformGenerator class equivalent
  * for pure C. "Callbacks" are functions that are similar to virtual methods
  * in C++.
+ * @details The layout up to `run_self_test` is the original one and is
+ * never changed. New fields are appended after it and are filled only by
+ * the optional `gen_getinfo2` entry point that receives the size of the
+ * caller's structure (see `GENINFOC_HAS_FIELD`). `gen_getinfo` must fill
+ * only the original fields (`GENINFOC_BASE_SIZE`): old callers don't know
+ * about the new ones.
  */
 typedef struct {
     const char *name; ///< Generator name
@@ -118,8 +142,51 @@ typedef struct {
     GetSum32CallbackC get_sum32; ///< Return the sum of 32-bit pseudorandom numbers
     GetSum64CallbackC get_sum64; ///< Return the sum of 64-bit pseudorandom numbers
     SelfTestCallbackC run_self_test; ///< Run the internal self-test
+    // Extended fields (filled only by gen_getinfo2)
+    GetArrayU01CallbackC get_array_u01; ///< Fill the double array buffer with numbers from [0;1)
+    uint64_t flags; ///< Capability flags (GENINFOC_FLAG_...)
+    InitStateSeededCallbackC init_state_seeded; ///< Initialize the PRNG state from the given seed
+    JumpCallbackC jump; ///< Skip 2^log2_distance outputs
+    unsigned int period_log2; ///< log2 of the period in native outputs (0 - unknown)
 } GenInfoC;
 
+/**
+ * @brief Size of the original part of GenInfoC that is filled by `gen_getinfo`.
+ */
+#define GENINFOC_BASE_SIZE offsetof(GenInfoC, get_array_u01)
+
+/**
+ * @brief Number of 64-bit words passed by the caller to `init_state_seeded`.
+ * The module uses as many of them as it needs; if it needs more, the rest
+ * should be filled with zeros.
+ */
+#define GENINFOC_SEED_NWORDS 4
+
+/*
+ * The `jump` callback advances the state as if 2^log2_distance outputs were
+ * generated. Outputs are native outputs of the generator, i.e. get_bits64
+ * calls for 64-bit generators and get_bits32 calls for 32-bit generators;
+ * buffered 32-bit halves of 64-bit outputs are discarded. Jumps allow to
+ * split one sequence into non-overlapping substreams (streams).
+ */
+
+/**
+ * @brief Checks if the field is inside the GenInfoC structure of the given
+ * size provided by the caller, i.e. if it may be written by the module.
+ */
+#define GENINFOC_HAS_FIELD(size, field) \
+    (offsetof(GenInfoC, field) + sizeof(((GenInfoC *) 0)->field) <= (size))
+
+/**
+ * @brief Sets the capability flags if the caller's structure has them.
+ */
+static inline void GenInfoC_set_flags(GenInfoC *gi, size_t size, uint64_t flags)
+{
+    if (GENINFOC_HAS_FIELD(size, flags)) {
+        gi->flags = flags;
+    }
+}
+
 /**
  * @brief Keeps pointers to the caller API that are used for PRNG modules.
  * Some functions are intentionally duplicating the standard library to
@@ -153,6 +220,7 @@ int DllMainCRTStartup(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved) {
 typedef int (*GenInitLibFunc)(CallerAPI *intf);
 typedef int (*GenCloseLibFunc)(void);
 typedef int (*GenGetInfoFunc)(GenInfoC *gi);
+typedef int (*GenGetInfo2Func)(GenInfoC *gi, size_t size);
 
 /**
  * @brief Keeps pointers to the external C module functions, required
@@ -162,6 +230,7 @@ typedef struct {
     GenInitLibFunc gen_initlib;
     GenCloseLibFunc gen_closelib;
     GenGetInfoFunc gen_getinfo;
+    GenGetInfo2Func gen_getinfo2; ///< Optional (may be NULL)
 } GenCModule;
 
 #ifdef __cplusplus
@@ -170,6 +239,7 @@ extern "C" {
 
 
 void GenInfoC_init(GenInfoC *obj);
+int GenCModule_getinfo(const GenCModule *mod, GenInfoC *gi);
 
 /**
  * @brief Conversion of unsigned (pseudorandom) 64-bit integer
@@ -230,8 +300,18 @@ int run_bigcrush(const GenInfoC *gi);
 int EXPORT gen_initlib(CallerAPI *intf);
 int EXPORT gen_closelib(void);
 int EXPORT gen_getinfo(GenInfoC *gi);
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size);
 
 
+/**
+ * @brief `gen_getinfo` that fills only the original fields of GenInfoC
+ * by means of `gen_getinfo2`; used by the MAKE_..._PRNG macros.
+ */
+#define PRNG_GETINFO_BASE \
+int EXPORT gen_getinfo(GenInfoC *gi) { \
+    return gen_getinfo2(gi, GENINFOC_BASE_SIZE); \
+}
+
 /**
  * @brief Default prolog of PRNG C module that contains default entry point
  * and default `gen_initlib` and `gen_closelib` functions.
@@ -249,6 +329,43 @@ int EXPORT gen_closelib() \
 }
 
 
+/**
+ * @brief Additional capability flags for the MAKE_..._PRNG macros.
+ * The module may define it before including this header, e.g.
+ * `#define PRNG_FLAGS GENINFOC_FLAG_COUNTER`.
+ */
+#ifndef PRNG_FLAGS
+#define PRNG_FLAGS 0
+#endif
+
+/**
+ * @brief Optional `init_state_seeded` function for the MAKE_..._PRNG macros.
+ * The module may define it before including this header, e.g.
+ * `#define PRNG_INIT_STATE_SEEDED init_state_seeded`.
+ */
+#ifndef PRNG_INIT_STATE_SEEDED
+#define PRNG_INIT_STATE_SEEDED NULL
+#endif
+
+/**
+ * @brief Optional `jump` function for the MAKE_..._PRNG macros. The module
+ * may define it before including this header, e.g. `#define PRNG_JUMP jump`
+ * (GENINFOC_FLAG_JUMPABLE should be added to PRNG_FLAGS).
+ */
+#ifndef PRNG_JUMP
+#define PRNG_JUMP NULL
+#endif
+
+/**
+ * @brief Optional log2 of the period (rounded down) for the MAKE_..._PRNG
+ * macros, e.g. `#define PRNG_PERIOD_LOG2 64`. It limits the number and
+ * length of substreams made by jumps; 0 means "unknown".
+ */
+#ifndef PRNG_PERIOD_LOG2
+#define PRNG_PERIOD_LOG2 0
+#endif
+
+
 /**
  * @brief  Some default boilerplate code for scalar PRNG that returns
  * unsigned 32-bit numbers.
@@ -277,10 +394,14 @@ EXPORT uint32_t get_sum32(void *param, void *state, size_t len) { \
         sum += get_bits32_raw(param, state); \
     return sum; \
 } \
+EXPORT void get_array_u01(void *param, void *state, double *out, size_t len) { \
+    for (size_t i = 0; i < len; i++) \
+        out[i] = uint32_to_udouble(get_bits32_raw(param, state)); \
+} \
 static void delete_state(void *param, void *state) {\
     (void) param; intf.free(state); \
 } \
-int EXPORT gen_getinfo(GenInfoC *gi) { \
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size) { \
     gi->name = prng_name; \
     gi->init_state = init_state; \
     gi->delete_state = delete_state; \
@@ -289,8 +410,18 @@ int EXPORT gen_getinfo(GenInfoC *gi) { \
     gi->get_array32 = get_array32; \
     gi->get_sum32 = get_sum32; \
     gi->run_self_test = selftest_func; \
+    if (GENINFOC_HAS_FIELD(size, get_array_u01)) \
+        gi->get_array_u01 = get_array_u01; \
+    if (GENINFOC_HAS_FIELD(size, init_state_seeded)) \
+        gi->init_state_seeded = PRNG_INIT_STATE_SEEDED; \
+    if (GENINFOC_HAS_FIELD(size, jump)) \
+        gi->jump = PRNG_JUMP; \
+    if (GENINFOC_HAS_FIELD(size, period_log2)) \
+        gi->period_log2 = PRNG_PERIOD_LOG2; \
+    GenInfoC_set_flags(gi, size, PRNG_FLAGS); \
     return 1; \
-}
+} \
+PRNG_GETINFO_BASE
 
 
 /**
@@ -331,10 +462,14 @@ EXPORT uint64_t get_sum64(void *param, void *state, size_t len) { \
         sum += get_bits64_raw(param, state); \
     return sum; \
 } \
+EXPORT void get_array_u01(void *param, void *state, double *out, size_t len) { \
+    for (size_t i = 0; i < len; i++) \
+        out[i] = uint64_to_udouble(get_bits64_raw(param, state)); \
+} \
 static void delete_state(void *param, void *state) {\
     (void) param; intf.free(state); \
 } \
-int EXPORT gen_getinfo(GenInfoC *gi) { \
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size) { \
     gi->name = prng_name; \
     gi->init_state = init_state; \
     gi->delete_state = delete_state; \
@@ -345,8 +480,18 @@ int EXPORT gen_getinfo(GenInfoC *gi) { \
     gi->get_sum32 = get_sum32; \
     gi->get_sum64 = get_sum64; \
     gi->run_self_test = selftest_func; \
+    if (GENINFOC_HAS_FIELD(size, get_array_u01)) \
+        gi->get_array_u01 = get_array_u01; \
+    if (GENINFOC_HAS_FIELD(size, init_state_seeded)) \
+        gi->init_state_seeded = PRNG_INIT_STATE_SEEDED; \
+    if (GENINFOC_HAS_FIELD(size, jump)) \
+        gi->jump = PRNG_JUMP; \
+    if (GENINFOC_HAS_FIELD(size, period_log2)) \
+        gi->period_log2 = PRNG_PERIOD_LOG2; \
+    GenInfoC_set_flags(gi, size, GENINFOC_FLAG_NATIVE64 | (PRNG_FLAGS)); \
     return 1; \
-}
+} \
+PRNG_GETINFO_BASE
 // end of MAKE_UINT64_UPTO32_PRNG macros
 
 
@@ -415,10 +560,23 @@ EXPORT uint64_t get_sum64(void *param, void *state, size_t len) { \
         sum += get_bits64_raw(param, state); \
     return sum; \
 } \
+EXPORT void get_array_u01(void *param, void *state, double *out, size_t len) { \
+    Type *obj = state; \
+    size_t i = 0; \
+    for (; i < len && obj->i32buf.pos != 2; i++) \
+        out[i] = uint32_to_udouble(get_bits32(param, state)); \
+    for (; i + 1 < len; i += 2) { \
+        uint64_t x = get_bits64_raw(param, state); \
+        out[i] = uint32_to_udouble((uint32_t) x); \
+        out[i + 1] = uint32_to_udouble((uint32_t) (x >> 32)); \
+    } \
+    for (; i < len; i++) \
+        out[i] = uint32_to_udouble(get_bits32(param, state)); \
+} \
 static void delete_state(void *param, void *state) {\
     (void) param; intf.free(state); \
 } \
-int EXPORT gen_getinfo(GenInfoC *gi) { \
+int EXPORT gen_getinfo2(GenInfoC *gi, size_t size) { \
     gi->name = prng_name; \
     gi->init_state = init_state; \
     gi->delete_state = delete_state; \
@@ -429,8 +587,18 @@ int EXPORT gen_getinfo(GenInfoC *gi) { \
     gi->get_sum32 = get_sum32; \
     gi->get_sum64 = get_sum64; \
     gi->run_self_test = selftest_func; \
+    if (GENINFOC_HAS_FIELD(size, get_array_u01)) \
+        gi->get_array_u01 = get_array_u01; \
+    if (GENINFOC_HAS_FIELD(size, init_state_seeded)) \
+        gi->init_state_seeded = PRNG_INIT_STATE_SEEDED; \
+    if (GENINFOC_HAS_FIELD(size, jump)) \
+        gi->jump = PRNG_JUMP; \
+    if (GENINFOC_HAS_FIELD(size, period_log2)) \
+        gi->period_log2 = PRNG_PERIOD_LOG2; \
+    GenInfoC_set_flags(gi, size, GENINFOC_FLAG_NATIVE64 | (PRNG_FLAGS)); \
     return 1; \
-}
+} \
+PRNG_GETINFO_BASE
 // end of MAKE_UINT64_INTERLEAVED32_PRNG macros
 
 #ifdef __cplusplus
@@ -12,6 +12,7 @@ extern "C" {
 #endif
 
 int dummy_gen_getinfo(GenInfoC *gi);
+int dummy_gen_getinfo2(GenInfoC *gi, size_t size);
 GenCModule dummy_init_cmodule();
 
 #ifdef __cplusplus
@@ -30,7 +30,9 @@
 #include <stdint.h>
 #include <vector>
 #include <thread>
-#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
 #include <iostream>
 
 
@@ -40,9 +42,15 @@ enum EntropyMethod
 {
     ENTROPY_TIME, ///< Seed is from system time.
     ENTROPY_RDTSC, ///< Seed is from from RDTSC instruction and system time.
-    ENTROPY_RDSEED ///< Hardware RNG in CPU is used.
+    ENTROPY_RDSEED, ///< Hardware RNG in CPU is used.
+    ENTROPY_RDRAND, ///< Output of DRBG in CPU (RDRAND instruction) is used.
+    ENTROPY_GETRANDOM, ///< Entropy from the OS (getrandom system call).
+    ENTROPY_FIXED ///< No entropy: the same seeds at each run (for debugging).
 };
 
+bool parse_entropy_method(const std::string &name, EntropyMethod &method);
+const char *entropy_method_name(EntropyMethod method);
+
 /**
  * @brief Generates seeds for PRNGs using some entropy sources: current time
  * in seconds, RDTSC instruction and RDSEED built-in hardware RNG. Everything
@@ -54,7 +62,8 @@ enum EntropyMethod
  * @details. It uses the next algorithm of generation of seeds:
  *
  * - RND(x) function is defined as RND(SplitMixHash(x) ^ RDSEED) where
- *   RDSEED is RDSEED instruction, hardware RNG in CPU.
+ *   RDSEED is RDSEED instruction, hardware RNG in CPU (one value is used
+ *   for the whole batch of seeds, see below).
  * - Internal counter CTR is "Weyl sequence" from SplitMix.
  * - Output function is XXTEA(RND(CTR)) where XXTEA is block cipher with
  *   64-bit block and 128-bit key.
@@ -65,27 +74,59 @@ enum EntropyMethod
  * hardware sources of entropy except time are excluded --- it will return
  * high-quality pseudorandom seeds.
  *
+ * The source XORed with the hashed counter is selected by EntropyMethod:
+ * RDSEED, RDRAND, getrandom or RDTSC. Availability of RDSEED and RDRAND is
+ * checked by CPUID, and the number of retries of these instructions is
+ * bounded: if they fail (e.g. under heavy load or in virtual machines) then
+ * RDRAND or RDTSC is used instead, so seeding never blocks.
+ *
  * Usage of XXTEA over RDSEED is also intended to exclude any biases.
+ *
+ * Seeds are generated without locks: each thread reserves a batch of
+ * `SEEDS_BATCH` values of the counter by one atomic operation and encrypts
+ * them in its own buffer (with one RDSEED call per batch). Returned seeds
+ * are saved to the append-only log with preallocated storage; the log
+ * should be read only when all threads that request seeds are finished.
+ *
+ * Seeds may be also made deterministic for the calling thread (see
+ * `SetThreadSeed`): it is used for reproducible runs of tests, when each
+ * test gets its own seed derived from the master seed (see `DeriveSeed`).
  */
 class Entropy
 {
-    std::mutex mut;
+    static constexpr size_t SEEDS_LOG_MAX = 1048576; ///< Capacity of the log.
+    EntropyMethod method; ///< Source of entropy.
     uint32_t key[4]; ///< XXTEA key
-    uint64_t state; ///< Internal PRNG state
-    
-    uint64_t MixHash(uint64_t z) const;
+    std::atomic<uint64_t> state; ///< Internal PRNG state (Weyl sequence)
+    uint64_t instance_id; ///< Identifies batches of this object in threads.
+    std::unique_ptr<uint64_t[]> seeds_log; ///< Log of returned seeds.
+    std::atomic<size_t> nseeds; ///< Number of returned seeds.
+
+    static uint64_t MixHash(uint64_t z);
     uint64_t Xxtea(const uint64_t inp) const;
-    uint64_t NextState();
-    uint64_t MixRdSeed(const uint64_t x) const;
+    uint64_t MixHwEntropy(const uint64_t x) const;
+    void FillBatch(uint64_t *out, size_t len);
+    void Init();
 
 public:
-    std::vector<uint64_t> seeds_log;
+    static constexpr size_t SEEDS_BATCH = 64; ///< Seeds reserved by a thread at once.
 
     Entropy();
+    Entropy(EntropyMethod method_);
+    void SetMethod(EntropyMethod method_);
+    inline EntropyMethod GetMethod() const { return method; }
+    static EntropyMethod DetectMethod();
+    static bool HasRdSeed();
+    static bool HasRdRand();
     bool XxteaTest();
     uint64_t Seed64();
-    inline size_t GetNSeeds() const { return seeds_log.size(); }
+    size_t GetNSeeds() const;
+    inline uint64_t GetLoggedSeed(size_t ind) const { return seeds_log[ind]; }
     static uint64_t CpuClock();
+    static uint64_t DeriveSeed(uint64_t master_seed, uint64_t a, uint64_t b);
+    static void SetThreadSeed(uint64_t seed);
+    static void ResetThreadSeed();
+    static bool NextThreadSeed(uint64_t &seed);
 };
 
 } // namespace testu01_threads
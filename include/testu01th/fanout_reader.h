@@ -0,0 +1,139 @@
+/**
+ * @file fanout_reader.h
+ * @brief Fan-out buffering of the input stream (e.g. stdin): the reader
+ * thread reads large blocks and hands them to generators of different
+ * worker threads. Allows to run multi-threaded batteries on piped data.
+ * 64-bit words and doubles are converted to 32-bit words by the reader.
+ * @copyright (c) 2024 Alexey L. Voskov, Lomonosov Moscow State University.
+ * alvoskov@gmail.com
+ *
+ * All rights reserved.
+ *
+ * This software is provided under the Apache 2 License.
+ *
+ * In scientific publications which used this software, a reference to it
+ * would be appreciated.
+ */
+#ifndef __FANOUT_READER_H
+#define __FANOUT_READER_H
+#include "testu01_mt.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace testu01_threads {
+
+/**
+ * @brief Format of the input stream and its decomposition to 32-bit
+ * words that are sent to TestU01.
+ */
+enum InputFormat
+{
+    INPUT_U32, ///< 32-bit words as is.
+    INPUT_HIGH32, ///< Higher halves of 64-bit words.
+    INPUT_LOW32, ///< Lower halves of 64-bit words.
+    INPUT_INTERLEAVED32, ///< Both halves of 64-bit words, the lower one first.
+    INPUT_REVERSED32, ///< 32-bit words (or halves of 64-bit words) with reversed bits.
+    INPUT_DOUBLE ///< Doubles from [0;1), upper 32 bits of the fraction.
+};
+
+bool parse_input_format(const std::string &name, InputFormat &format);
+const char *input_format_name(InputFormat format);
+size_t input_word_size(InputFormat format);
+size_t decode_input_block(InputFormat format, uint32_t *buf, size_t nwords);
+
+/**
+ * @brief Reads the stream by large blocks in its own thread and hands
+ * them to consumers in the order of arrival.
+ * @details Blocks are kept in a fixed set of slots, so the memory is
+ * bounded: if all slots are filled or held by consumers, the reader waits
+ * (and the writer to the pipe is blocked too). Each block is given to
+ * exactly one consumer, i.e. consumers get disjoint contiguous segments
+ * of the stream. The consumer holds one block at a time and returns it
+ * before taking the next one. Blocks are converted to 32-bit words
+ * by the reader thread (see `decode_input_block`).
+ */
+class FanOutReader
+{
+    /**
+     * @brief Slot for one block of the stream.
+     */
+    class Block
+    {
+    public:
+        std::vector<uint32_t> data;
+        size_t len; ///< Number of read words.
+        Block() : len(0) {}
+    };
+
+    FILE *fp; ///< Input stream.
+    InputFormat format; ///< Format of input words.
+    std::vector<Block> blocks;
+    std::deque<size_t> free_slots; ///< Slots that may be filled by the reader.
+    std::deque<size_t> filled_slots; ///< Filled slots in the order of arrival.
+    std::mutex mut;
+    std::condition_variable cv_free;
+    std::condition_variable cv_filled;
+    std::thread reader;
+    bool eof; ///< End of the stream is reached.
+    bool stop; ///< Stop request for the reader.
+    uint64_t nwords; ///< Number of read words.
+
+    void ReaderFunc();
+
+public:
+    FanOutReader(FILE *fp_, size_t nblocks, size_t block_size,
+        InputFormat format_ = INPUT_U32);
+    ~FanOutReader();
+    FanOutReader(const FanOutReader &) = delete;
+    FanOutReader &operator=(const FanOutReader &) = delete;
+    const uint32_t *Acquire(size_t &slot, size_t &len);
+    void Release(size_t slot);
+    uint64_t GetNWords();
+    inline InputFormat GetFormat() const { return format; }
+};
+
+
+/**
+ * @brief Generator that serves 32-bit words from blocks given by the
+ * fan-out reader. When the block is exhausted the next block in the order
+ * of arrival is taken. The program is terminated if the stream is ended:
+ * TestU01 tests cannot be interrupted.
+ */
+class FanOutGenerator : public UniformGenerator
+{
+    std::shared_ptr<FanOutReader> reader;
+    const uint32_t *data; ///< Current block (nullptr - no block).
+    size_t slot; ///< Slot of the current block.
+    size_t len; ///< Number of words in the current block.
+    size_t pos; ///< Index of the next word.
+
+    static constexpr double INV32 = 1.0 / (static_cast<uint64_t>(1) << 32);
+
+    void NextBlock();
+
+public:
+    FanOutGenerator(std::shared_ptr<FanOutReader> reader_);
+    ~FanOutGenerator();
+
+    inline uint32_t GetBits32() override
+    {
+        if (pos == len) {
+            NextBlock();
+        }
+        return data[pos++];
+    }
+
+    inline double GetU01() override { return GetBits32() * INV32; }
+    uint64_t GetBits64() override;
+    void GetArray32(uint32_t *out, size_t n) override;
+};
+
+} // namespace testu01_threads
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * @file file_dump.h
+ * @brief Length-limited binary dumps of PRNG output to files: several
+ * generator threads write disjoint regions of the file, interrupted dumps
+ * may be resumed from the checkpoint.
+ * @copyright (c) 2024 Alexey L. Voskov, Lomonosov Moscow State University.
+ * alvoskov@gmail.com
+ *
+ * All rights reserved.
+ *
+ * This software is provided under the Apache 2 License.
+ *
+ * In scientific publications which used this software, a reference to it
+ * would be appreciated.
+ */
+#ifndef __FILE_DUMP_H
+#define __FILE_DUMP_H
+#include "stream_writer.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace testu01_threads {
+
+/**
+ * @brief Writes exactly 2^k bytes of the generator output to the file.
+ * @details The file is divided into `nthreads` regions, each region is
+ * filled by its own generator thread by large page-aligned blocks written
+ * by `pwrite` (with `O_DIRECT` on Linux if the file system supports it).
+ *
+ * If the generator supports jumps then all generators are initialized by
+ * the same seed and moved to the beginning of their regions, so the file
+ * is one contiguous sequence of outputs and doesn't depend on the number
+ * of threads. Jumps are counted in native outputs of the generator, so
+ * they are used only if the output word of the format is the native output
+ * (see `SetNativeWordSize`). Otherwise each region is an independent
+ * sequence with the seed derived from the master seed.
+ *
+ * The progress of regions is saved to the checkpoint file (`filename.ckpt`)
+ * every `checkpoint_interval` seconds after flushing the data to the disk.
+ * Generator states are not saved directly: they are restored by seeding
+ * and jumping (or skipping outputs) to the saved position. The checkpoint
+ * is removed after the successful end of the dump.
+ */
+class FileDump
+{
+    GenFactoryFunc create_gen; ///< Factory of generators.
+    StreamFormat format; ///< Output format.
+    std::string filename; ///< Output file name.
+    std::string gen_name; ///< Generator name (for checking of checkpoints).
+    unsigned int size_log2; ///< log2 of the file size in bytes.
+    size_t nthreads; ///< Number of generator threads (regions).
+    size_t buffer_size; ///< Size of one block, bytes.
+    size_t native_size; ///< Size of the native output, bytes (0 - unknown).
+    uint64_t seed; ///< Master seed.
+    bool jumpable; ///< Generator supports jumps.
+    bool direct; ///< Try to use O_DIRECT.
+    double checkpoint_interval; ///< Seconds between checkpoints.
+    int fd; ///< Output file descriptor.
+    std::vector<uint64_t> begin; ///< Offsets of regions.
+    std::vector<uint64_t> end; ///< Ends of regions.
+    std::unique_ptr<std::atomic<uint64_t>[]> done; ///< Written bytes of regions.
+    std::atomic<bool> failed;
+    size_t nfinished; ///< Number of finished regions.
+    std::mutex mut;
+    std::condition_variable cv;
+
+    void SplitRegions();
+    bool OpenFile(bool resume);
+    std::shared_ptr<UniformGenerator> CreateGenerator(size_t region);
+    void RegionFunc(std::shared_ptr<UniformGenerator> gen, size_t region);
+    bool WriteAt(const uint8_t *buf, size_t len, uint64_t offset);
+    bool Sync();
+    bool SaveCheckpoint();
+    bool LoadCheckpoint();
+
+public:
+    static constexpr size_t PAGE_SIZE = StreamWriter::PAGE_SIZE; ///< Alignment of blocks.
+
+    FileDump(GenFactoryFunc create_gen_, StreamFormat format_,
+        const std::string &filename_);
+    void SetSizeLog2(unsigned int log2_bytes) { size_log2 = log2_bytes; }
+    void SetNThreads(size_t n) { nthreads = (n > 0) ? n : 1; }
+    void SetBufferSize(size_t bytes);
+    void SetNativeWordSize(size_t bytes) { native_size = bytes; }
+    void SetSeed(uint64_t seed_) { seed = seed_; }
+    void SetDirectIO(bool enabled) { direct = enabled; }
+    void SetCheckpointInterval(double sec) { checkpoint_interval = sec; }
+    std::string GetCheckpointName() const { return filename + ".ckpt"; }
+    bool Run(bool resume);
+};
+
+} // namespace testu01_threads
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file mapped_file.h
+ * @brief Generator that reads pre-generated binary data from the file
+ * mapped to memory. Allows to run multi-threaded batteries on stored data.
+ * @copyright (c) 2024 Alexey L. Voskov, Lomonosov Moscow State University.
+ * alvoskov@gmail.com
+ *
+ * All rights reserved.
+ *
+ * This software is provided under the Apache 2 License.
+ *
+ * In scientific publications which used this software, a reference to it
+ * would be appreciated.
+ */
+#ifndef __MAPPED_FILE_H
+#define __MAPPED_FILE_H
+#include "testu01_mt.h"
+#include <string>
+#include <memory>
+#include <atomic>
+
+namespace testu01_threads {
+
+/**
+ * @brief Read-only file mapped to memory. The mapping is advised to be
+ * read sequentially (and to use huge pages if possible on Linux).
+ * Shared by all generators that read the file.
+ */
+class MappedFile
+{
+    std::string filename;
+    const uint8_t *data; ///< Mapped data.
+    uint64_t size; ///< File size, bytes.
+#if defined(_WIN32) || defined(_WIN64)
+    void *file_handle;
+    void *map_handle;
+#endif
+    std::atomic<uint64_t> nwraps; ///< How many times the data was reused.
+
+public:
+    MappedFile(const std::string &filename_);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    inline bool IsOpen() const { return data != nullptr; }
+    inline const std::string &GetName() const { return filename; }
+    inline const uint8_t *GetData() const { return data; }
+    inline uint64_t GetSize() const { return size; }
+    inline void AddWrap() { nwraps++; }
+    inline uint64_t GetNWraps() const { return nwraps; }
+};
+
+
+/**
+ * @brief Serves 32-bit outputs directly from the mapped file (as
+ * little-endian uint32_t words) without copying. Jumps just move the
+ * position, so tests of the multi-threaded battery may read disjoint
+ * regions of the file (see `TestsPull::SetSampleRegions`). The reading
+ * wraps around at the end of the file: the reuse of data is reported
+ * by the file object. If the region is set (see `SetRegion`) then the
+ * generator never reads beyond its end: it restarts the region and counts
+ * the overrun instead of reading the region of the next test.
+ */
+class MappedFileGenerator : public UniformGenerator
+{
+    std::shared_ptr<MappedFile> file;
+    const uint32_t *data; ///< Words of the file.
+    uint64_t nwords; ///< Number of words in the file.
+    uint64_t pos; ///< Index of the next word.
+    uint64_t region_begin; ///< Index of the first word of the region.
+    uint64_t region_len; ///< Length of the region (0 - no region).
+    uint64_t region_left; ///< Words left in the region.
+    uint64_t noverruns; ///< Number of restarts of the region.
+
+    static constexpr double INV32 = 1.0 / (static_cast<uint64_t>(1) << 32);
+
+    void RestartRegion();
+
+public:
+    MappedFileGenerator(std::shared_ptr<MappedFile> file_);
+
+    inline uint32_t GetBits32() override
+    {
+        if (region_left == 0) {
+            RestartRegion();
+        }
+        region_left--;
+        if (pos == nwords) {
+            pos = 0;
+            file->AddWrap();
+        }
+        return data[pos++];
+    }
+
+    inline double GetU01() override { return GetBits32() * INV32; }
+    uint64_t GetBits64() override;
+    void GetArray32(uint32_t *out, size_t len) override;
+    bool Jump(unsigned int log2_distance) override;
+    bool SetRegion(uint64_t offset, uint64_t len) override;
+    uint64_t GetRegionOverruns() const override { return noverruns; }
+};
+
+} // namespace testu01_threads
+
+#endif
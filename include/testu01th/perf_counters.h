@@ -0,0 +1,93 @@
+/**
+ * @file perf_counters.h
+ * @brief Hardware performance counters (cycles, instructions, cache and
+ * branch misses) of the calling thread. Uses `perf_event_open` on Linux;
+ * on other systems, or if perf events are not permitted, counters are
+ * silently disabled.
+ * @copyright (c) 2024 Alexey L. Voskov, Lomonosov Moscow State University.
+ * alvoskov@gmail.com
+ *
+ * All rights reserved.
+ *
+ * This software is provided under the Apache 2 License.
+ *
+ * In scientific publications which used this software, a reference to it
+ * would be appreciated.
+ */
+#ifndef __PERF_COUNTERS_H
+#define __PERF_COUNTERS_H
+#include <cstdint>
+#include <string>
+
+namespace testu01_threads {
+
+/**
+ * @brief Types of collected hardware events.
+ */
+enum PerfCounterType
+{
+    PERF_CYCLES, ///< CPU cycles (at the current frequency).
+    PERF_INSTRUCTIONS, ///< Retired instructions.
+    PERF_L1D_MISSES, ///< L1 data cache read misses.
+    PERF_LLC_MISSES, ///< Last level cache misses.
+    PERF_BRANCH_MISSES, ///< Mispredicted branches.
+    PERF_NCOUNTERS
+};
+
+const char *perf_counter_name(PerfCounterType type);
+
+/**
+ * @brief Values of hardware counters. Some events may be absent on the
+ * given CPU (e.g. cache events in virtual machines): they are excluded
+ * by the mask.
+ */
+class PerfCounterValues
+{
+    double values[PERF_NCOUNTERS];
+    unsigned int mask; ///< Bit i is set if the counter i was measured.
+
+public:
+    PerfCounterValues() : values(), mask(0) {}
+    inline bool IsEmpty() const { return mask == 0; }
+    inline bool Has(PerfCounterType type) const { return (mask >> type) & 1; }
+    inline double Get(PerfCounterType type) const { return values[type]; }
+    inline void Set(PerfCounterType type, double value)
+    {
+        values[type] = value;
+        mask |= 1u << type;
+    }
+    double GetIPC() const;
+    void Scale(double k);
+    PerfCounterValues operator-(const PerfCounterValues &obj) const;
+    PerfCounterValues &operator+=(const PerfCounterValues &obj);
+    std::string ToString() const;
+};
+
+
+/**
+ * @brief Hardware counters of the calling thread. Counters must be started
+ * and stopped by the thread that created them. Only user space events are
+ * counted, so the default `perf_event_paranoid` setting (2) is enough.
+ * Events are not grouped: if the CPU has less hardware counters than events
+ * then the kernel multiplexes them and values are extrapolated. If counters
+ * cannot be opened then `Stop` returns empty values.
+ */
+class PerfCounters
+{
+    int fds[PERF_NCOUNTERS]; ///< Event descriptors (-1 - not opened).
+    int nopened; ///< Number of opened events.
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+    inline bool IsEnabled() const { return nopened > 0; }
+    void Start();
+    PerfCounterValues Stop();
+    static bool IsAvailable();
+};
+
+} // namespace testu01_threads
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * @file runtime_db.h
+ * @brief A small on-disk database with measured running times of tests
+ * from the batteries. Used by the dispatcher for ordering of tests and
+ * for prediction of the battery running time.
+ * @copyright (c) 2024 Alexey L. Voskov, Lomonosov Moscow State University.
+ * alvoskov@gmail.com
+ *
+ * All rights reserved.
+ *
+ * This software is provided under the Apache 2 License.
+ *
+ * In scientific publications which used this software, a reference to it
+ * would be appreciated.
+ */
+#ifndef __RUNTIME_DB_H
+#define __RUNTIME_DB_H
+#include "perf_counters.h"
+#include <string>
+#include <map>
+#include <mutex>
+
+namespace testu01_threads {
+
+/**
+ * @brief Averaged running time of one test for the given battery,
+ * generator and host.
+ */
+class RuntimeRecord
+{
+public:
+    double wall_sec; ///< Mean elapsed (wall) time, seconds.
+    double cpu_sec; ///< Mean CPU time of the thread, seconds.
+    size_t nruns; ///< Number of measurements.
+    PerfCounterValues perf; ///< Mean hardware counters (see PerfCounters).
+    size_t nperf; ///< Number of measurements with hardware counters.
+
+    RuntimeRecord() : wall_sec(0.0), cpu_sec(0.0), nruns(0), nperf(0) {}
+};
+
+
+/**
+ * @brief Persistent database of tests running times. Keys are
+ * (battery, test number, generator name, host name) tuples. The test
+ * number is the 1-based position of the test in the battery: test IDs
+ * are not unique (e.g. variants of OPSO or DNA in pseudoDIEHARD share
+ * the same ID).
+ * @details The database is stored as a text file with tab-separated
+ * columns: battery, test number, generator, host, wall time, CPU time and
+ * number of runs; then mean hardware counters (`-` if not measured) and
+ * number of runs with counters. Files without counters columns are also
+ * accepted. Lines that begin with `#` are comments. All methods
+ * are thread-safe.
+ *
+ * The file may be shared by concurrent runs: `Save` re-reads it, merges
+ * the measurements made since the previous save and replaces the file
+ * atomically (the new contents are written to the temporary file that
+ * is renamed). Saves of different processes are serialized by the
+ * exclusive lock of the `<file>.lock` file.
+ */
+class RuntimeHistory
+{
+    std::string filename; ///< Name of the file with the database.
+    std::string host; ///< Name of the current host.
+    std::map<std::string, RuntimeRecord> records; ///< Database contents.
+    std::map<std::string, RuntimeRecord> updates; ///< Measurements not saved yet.
+    mutable std::mutex mut;
+
+    std::string MakeKey(const std::string &battery, int test_no,
+        const std::string &gen_name, const std::string &host_name) const;
+    bool ReadFile(std::map<std::string, RuntimeRecord> &out) const;
+    static void AddRecord(RuntimeRecord &dst, const RuntimeRecord &src);
+
+public:
+    RuntimeHistory(const std::string &filename_);
+    bool Load();
+    bool Save();
+    bool Find(const std::string &battery, int test_no,
+        const std::string &gen_name, RuntimeRecord &rec) const;
+    void Update(const std::string &battery, int test_no,
+        const std::string &gen_name, double wall_sec, double cpu_sec,
+        const PerfCounterValues &perf = PerfCounterValues());
+    inline const std::string &GetHost() const { return host; }
+    static std::string GetHostName();
+    static double GetThreadCpuTime();
+};
+
+} // namespace testu01_threads
+
+#endif
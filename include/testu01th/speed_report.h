@@ -0,0 +1,56 @@
+/**
+ * @file speed_report.h
+ * @brief Machine-readable results of speed tests (JSON and CSV) and their
+ * comparison with the baseline for tracking of performance regressions.
+ * @copyright (c) 2024 Alexey L. Voskov, Lomonosov Moscow State University.
+ * alvoskov@gmail.com
+ *
+ * All rights reserved.
+ *
+ * This software is provided under the Apache 2 License.
+ *
+ * In scientific publications which used this software, a reference to it
+ * would be appreciated.
+ */
+#ifndef __SPEED_REPORT_H
+#define __SPEED_REPORT_H
+#include "perf_counters.h"
+#include <string>
+#include <vector>
+
+namespace testu01_threads {
+
+/**
+ * @brief Speed of one generator interface (u01, u32, u64, array32, ...)
+ * for the given number of simultaneously running threads. Times are
+ * corrected for the overhead of calls.
+ */
+class SpeedRecord
+{
+public:
+    std::string module; ///< Module name, e.g. "chacha_avx" (may be empty).
+    std::string generator; ///< Generator name.
+    std::string interface; ///< Interface name, e.g. "u32" or "array64".
+    size_t nthreads; ///< Number of threads.
+    double ns_per_call; ///< Median time of one call in one thread, ns.
+    double ns_mad; ///< MAD of the time of one call, ns.
+    double ns_ci_low; ///< Lower bound of the 95% CI of the median, ns.
+    double ns_ci_high; ///< Upper bound of the 95% CI of the median, ns.
+    double cpb; ///< CPU ticks per byte in one thread.
+    double gb_per_sec; ///< Total throughput of all threads, 10^9 bytes/s.
+    PerfCounterValues perf; ///< Corrected hardware counters per call (optional).
+
+    SpeedRecord() : nthreads(1), ns_per_call(0.0), ns_mad(0.0),
+        ns_ci_low(0.0), ns_ci_high(0.0), cpb(0.0), gb_per_sec(0.0) {}
+    std::string GetKey() const;
+};
+
+bool save_speed_json(const std::string &filename, const std::vector<SpeedRecord> &records);
+bool save_speed_csv(const std::string &filename, const std::vector<SpeedRecord> &records);
+bool load_speed_json(const std::string &filename, std::vector<SpeedRecord> &records);
+size_t compare_speed(const std::vector<SpeedRecord> &baseline,
+    const std::vector<SpeedRecord> &current, double threshold);
+
+} // namespace testu01_threads
+
+#endif
@@ -15,11 +15,91 @@
 #ifndef __SPEEDTEST_H
 #define __SPEEDTEST_H
 #include "testu01_mt.h"
+#include "speed_report.h"
+#include <vector>
 
 namespace testu01_threads {
 
-void test_battery_speed(const testu01_threads::GenFactoryFunc &create_gen,
-    const GenInfoC &geninfo);
+/**
+ * @brief Function that calls the generator interface `niter` times.
+ */
+typedef size_t (*RunBlockFunc)(std::shared_ptr<UniformGenerator> &objptr, size_t niter);
+
+/**
+ * @brief Robust statistics of repeated measurements: median, median
+ * absolute deviation (MAD) and distribution-free 95% confidence interval
+ * of the median (from order statistics).
+ */
+class SpeedStats
+{
+public:
+    double median;
+    double mad;
+    double ci_low;
+    double ci_high;
+    size_t n; ///< Number of measurements.
+
+    SpeedStats() : median(0.0), mad(0.0), ci_low(0.0), ci_high(0.0), n(0) {}
+    static SpeedStats Compute(std::vector<double> x);
+};
+
+/**
+ * @brief Results of the speed measurement of one generator interface.
+ * "Corrected" values are differences between the generator and the "dummy"
+ * PRNG runs made in the same repetition.
+ */
+class SpeedMeasurement
+{
+public:
+    SpeedStats ns; ///< Nanoseconds per call.
+    SpeedStats ns_dummy; ///< Nanoseconds per call for the "dummy" PRNG.
+    SpeedStats ns_corr; ///< Corrected nanoseconds per call.
+    SpeedStats ticks; ///< CPU ticks per call.
+    SpeedStats ticks_dummy; ///< CPU ticks per call for the "dummy" PRNG.
+    SpeedStats ticks_corr; ///< Corrected CPU ticks per call.
+    PerfCounterValues perf; ///< Corrected hardware counters per call.
+    size_t niter; ///< Calls per repetition.
+
+    SpeedMeasurement() : niter(0) {}
+};
+
+/**
+ * @brief Timing harness for the speed test.
+ * @details The generator is warmed up (it also calibrates the number of
+ * calls per repetition), then K repetitions are made. Each repetition
+ * runs both the generator and the "dummy" PRNG (that estimates overhead
+ * of calls); their order is alternated to cancel drifts of the CPU
+ * frequency. Time is measured by the CPU time stamp counter converted
+ * to nanoseconds by the ratio calibrated with `std::chrono::steady_clock`.
+ * Hardware counters (see PerfCounters) may be collected during the same
+ * runs; they are summed over repetitions.
+ */
+class SpeedHarness
+{
+    size_t nrepeats; ///< Number of repetitions (K).
+    double sample_ms; ///< Minimal duration of one repetition, ms.
+    double warmup_ms; ///< Duration of the warm-up, ms.
+    bool perf; ///< Collect hardware counters.
+
+public:
+    SpeedHarness() : nrepeats(15), sample_ms(20.0), warmup_ms(100.0), perf(false) {}
+    void SetNRepeats(size_t n) { nrepeats = (n > 0) ? n : 1; }
+    void SetSampleTime(double ms) { sample_ms = ms; }
+    void SetWarmupTime(double ms) { warmup_ms = ms; }
+    void SetPerfCounters(bool enabled) { perf = enabled; }
+    size_t GetNRepeats() const { return nrepeats; }
+    double GetSampleTime() const { return sample_ms; }
+    static double GetTicksPerNs();
+    size_t Calibrate(std::shared_ptr<UniformGenerator> &gen, RunBlockFunc func) const;
+    SpeedMeasurement Measure(const GenFactoryFunc &create_gen,
+        const GenFactoryFunc &create_dummy, RunBlockFunc func) const;
+};
+
+std::vector<SpeedRecord> test_battery_speed(const testu01_threads::GenFactoryFunc &create_gen,
+    const GenInfoC &geninfo, const SpeedHarness &harness = SpeedHarness());
+std::vector<SpeedRecord> test_battery_speed_mt(const testu01_threads::GenFactoryFunc &create_gen,
+    const GenInfoC &geninfo, std::shared_ptr<ThreadPool> pool,
+    const SpeedHarness &harness = SpeedHarness());
 
 } // namespace testu01_threads
 
@@ -10,7 +10,7 @@ typedef struct {
 #ifdef __cplusplus
 extern "C" {
 #endif
-int splitmix_get_geninfo(GenInfoC *gi);
+int splitmix_get_geninfo(GenInfoC *gi, size_t size);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,119 @@
+/**
+ * @file stream_writer.h
+ * @brief Streaming of PRNG output to files and pipes (e.g. to PractRand):
+ * several generator threads fill a ring of large aligned buffers that are
+ * written by a dedicated writer thread.
+ * @copyright (c) 2024 Alexey L. Voskov, Lomonosov Moscow State University.
+ * alvoskov@gmail.com
+ *
+ * All rights reserved.
+ *
+ * This software is provided under the Apache 2 License.
+ *
+ * In scientific publications which used this software, a reference to it
+ * would be appreciated.
+ */
+#ifndef __STREAM_WRITER_H
+#define __STREAM_WRITER_H
+#include "testu01_mt.h"
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace testu01_threads {
+
+/**
+ * @brief Format of the output stream, i.e. the generator function
+ * used for filling of buffers.
+ */
+enum StreamFormat
+{
+    STREAM_BITS32, ///< GetBits32 calls (32-bit outputs).
+    STREAM_ARRAY32, ///< GetArray32 calls (vectorized 32-bit outputs).
+    STREAM_BITS64, ///< GetBits64 calls (64-bit outputs).
+    STREAM_ARRAY64 ///< GetArray64 calls (vectorized 64-bit outputs).
+};
+
+void fill_stream_buffer(UniformGenerator &gen, StreamFormat format,
+    uint8_t *buf, size_t len);
+size_t stream_word_size(StreamFormat format);
+
+/**
+ * @brief Writes the output of the generator to the file descriptor (e.g.
+ * stdout). Generation and writing are made in different threads.
+ * @details The stream is divided into blocks of `buffer_size` bytes. Block
+ * `k` is filled by the generator thread `k mod nthreads` in the slot
+ * `k mod nslots` of the ring of buffers, the writer (the thread that
+ * called `Run`) writes blocks in the order of their indexes. So for one generator thread it is the
+ * usual double (or multiple) buffering, and for several threads the
+ * output is made by interleaved blocks of several generators. Generators
+ * of different threads either have independent seeds or are the
+ * non-overlapping substreams of one sequence (see `SetStreams`).
+ *
+ * Buffers are aligned to the memory page. Writing stops after `limit`
+ * bytes (if it is set) or if the file descriptor is closed (e.g. PractRand
+ * finished).
+ *
+ * On Linux buffers are given to the pipe by `vmsplice` without copying
+ * (if the output is a pipe and zero-copy mode is not disabled). The pipe
+ * keeps references to the pages, so the buffer is returned to generators
+ * only when the amount of data written after it exceeds the pipe capacity.
+ * Other outputs are written by `write`.
+ */
+class StreamWriter
+{
+    /**
+     * @brief Slot of the ring of buffers.
+     */
+    class Slot
+    {
+    public:
+        std::vector<uint8_t> storage; ///< Memory for the aligned buffer.
+        uint8_t *buf; ///< Aligned buffer.
+        size_t len; ///< Number of filled bytes.
+        uint64_t seq; ///< Index of the block expected in this slot.
+        bool ready; ///< The block is filled and may be written.
+
+        Slot() : buf(nullptr), len(0), seq(0), ready(false) {}
+    };
+
+    GenFactoryFunc create_gen; ///< Factory of generators.
+    StreamFormat format; ///< Output format.
+    size_t nthreads; ///< Number of generator threads.
+    size_t nslots; ///< Number of buffers (0 - two per thread).
+    size_t buffer_size; ///< Size of one buffer, bytes.
+    uint64_t limit; ///< Number of bytes to write (0 - no limit).
+    unsigned int streams_log2; ///< log2 of the substream length (0 - no jumps).
+    uint64_t streams_seed; ///< Common seed of substreams.
+    bool zerocopy; ///< Use vmsplice for pipes (Linux only).
+    std::vector<Slot> slots;
+    std::mutex mut;
+    std::condition_variable cv;
+    std::atomic<bool> stop;
+
+    std::shared_ptr<UniformGenerator> CreateGenerator(size_t thread_id);
+    void GeneratorFunc(std::shared_ptr<UniformGenerator> gen, size_t thread_id,
+        uint64_t nblocks);
+    uint64_t GetBlockSize(uint64_t seq, uint64_t nblocks) const;
+    void ReleaseSlot(uint64_t seq);
+    size_t SetupZeroCopy(int fd);
+    static bool WriteAll(int fd, const uint8_t *buf, size_t len);
+    static bool SpliceAll(int fd, const uint8_t *buf, size_t len);
+
+public:
+    static constexpr size_t PAGE_SIZE = 4096; ///< Alignment of buffers.
+
+    StreamWriter(GenFactoryFunc create_gen_, StreamFormat format_);
+    void SetNThreads(size_t n) { nthreads = (n > 0) ? n : 1; }
+    void SetNBuffers(size_t n) { nslots = n; }
+    void SetBufferSize(size_t bytes);
+    void SetLimit(uint64_t nbytes) { limit = nbytes; }
+    void SetStreams(unsigned int log2_distance, uint64_t seed);
+    void SetZeroCopy(bool enabled) { zerocopy = enabled; }
+    uint64_t Run(int fd);
+};
+
+} // namespace testu01_threads
+
+#endif
@@ -26,6 +26,7 @@ extern "C" {
 #endif
 #include "bbattery.h"
 #include "fbar.h"
+#include "fdist.h"
 #include "gofw.h"
 #include "gofs.h"
 #include "smultin.h"
@@ -58,12 +59,15 @@ constexpr size_t ELEMENTS_PER_BLOCK = 1024;
 #include "cinterface.h"
 #include "dummy_module.h"
 #include "entropy.h"
+#include "runtime_db.h"
+#include "thread_pool.h"
 #include <string>
 #include <functional>
 #include <memory>
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <algorithm>
 
 
@@ -97,6 +101,13 @@ public:
     virtual void GetArray64(uint64_t *out, size_t len);
     virtual uint32_t GetSum32(size_t len);
     virtual uint64_t GetSum64(size_t len);
+    virtual bool Jump(unsigned int log2_distance);
+    virtual bool SetRegion(uint64_t offset, uint64_t len);
+    /** @brief Number of reads beyond the region end (see `SetRegion`). */
+    virtual uint64_t GetRegionOverruns() const { return 0; }
+    /** @brief log2 of the period in outputs (0 - unknown), limits substreams. */
+    virtual unsigned int GetPeriodLog2() const { return 0; }
+    bool SetStream(uint64_t stream, unsigned int log2_distance);
 };
 
 
@@ -167,6 +178,8 @@ public:
     {
         return gen_module.get_sum64(gen.param, gen.state, len);
     }
+    bool Jump(unsigned int log2_distance) override;
+    unsigned int GetPeriodLog2() const override { return gen_module.period_log2; }
     virtual ~UniformGeneratorC()
     {
         gen_module.delete_state(gen.param, gen.state);
@@ -174,6 +187,107 @@ public:
 };
 
 
+/**
+ * @brief A variant of UniformGeneratorC with block buffering: TestU01
+ * `GetBits`/`GetU01` calls are served from the buffer that is refilled
+ * by the vectorized functions of the C module.
+ * @details If the module supplies `get_array32` then the output is the
+ * same as for UniformGeneratorC. Otherwise `get_array64` is used and each
+ * 64-bit value is split into two 32-bit values (lower half first), so
+ * TestU01 has an access to all bits. In both cases `GetU01` is made from
+ * one 32-bit value unless the module supplies `get_array_u01`: then
+ * `GetU01` calls are served from a separate buffer of doubles filled by
+ * this function. Buffers are aligned to the cache line; each object
+ * (i.e. each thread) has its own buffers.
+ */
+class UniformGeneratorCBuffered : public UniformGenerator
+{
+    static void WrExternGen(void *junk2) { (void) junk2; }
+    std::string name;
+    const GenInfoC gen_module;
+    void *state; ///< PRNG state from the C module.
+    std::vector<uint64_t> storage; ///< Memory for the aligned buffer.
+    uint32_t *buf32; ///< Buffer for `get_array32` output.
+    uint64_t *buf64; ///< Buffer for `get_array64` output.
+    double *bufu01; ///< Buffer for `get_array_u01` output (optional).
+    size_t pos; ///< Position of the next 32-bit element (of ELEMENTS_PER_BLOCK).
+    size_t pos_u01; ///< Position of the next double.
+    UniformGeneratorCBuffered(const UniformGeneratorCBuffered &obj) = delete;
+    UniformGeneratorCBuffered &operator=(const UniformGeneratorCBuffered &obj) = delete;
+
+    void Refill();
+    void RefillU01();
+
+    static inline uint32_t Next32(UniformGeneratorCBuffered *obj)
+    {
+        if (obj->pos == ELEMENTS_PER_BLOCK) {
+            obj->Refill();
+        }
+        size_t i = obj->pos++;
+        if (obj->buf32 != nullptr) {
+            return obj->buf32[i];
+        } else {
+            return (uint32_t) (obj->buf64[i >> 1] >> ((i & 1) << 5));
+        }
+    }
+
+    static unsigned long GetBitsBuf(void *param, void *state)
+    {
+        (void) state;
+        return Next32(static_cast<UniformGeneratorCBuffered *>(param));
+    }
+
+    static double GetU01Buf(void *param, void *state)
+    {
+        (void) state;
+        return uint32_to_udouble(Next32(static_cast<UniformGeneratorCBuffered *>(param)));
+    }
+
+    static double GetU01BufArray(void *param, void *state)
+    {
+        (void) state;
+        UniformGeneratorCBuffered *obj = static_cast<UniformGeneratorCBuffered *>(param);
+        if (obj->pos_u01 == ELEMENTS_PER_BLOCK / 2) {
+            obj->RefillU01();
+        }
+        return obj->bufu01[obj->pos_u01++];
+    }
+
+public:
+    UniformGeneratorCBuffered(const GenInfoC *gi);
+    static bool IsSupported(const GenInfoC *gi);
+    const std::string &GetName() { return name; }
+    double GetU01() override { return gen.GetU01(gen.param, gen.state); }
+    uint32_t GetBits32() override { return Next32(this); }
+    uint64_t GetBits64() override
+    {
+        return gen_module.get_bits64(nullptr, state);
+    }
+    void GetArray32(uint32_t *out, size_t len) override
+    {
+        return gen_module.get_array32(nullptr, state, out, len);
+    }
+    void GetArray64(uint64_t *out, size_t len) override
+    {
+        return gen_module.get_array64(nullptr, state, out, len);
+    }
+    uint32_t GetSum32(size_t len) override
+    {
+        return gen_module.get_sum32(nullptr, state, len);
+    }
+    uint64_t GetSum64(size_t len) override
+    {
+        return gen_module.get_sum64(nullptr, state, len);
+    }
+    bool Jump(unsigned int log2_distance) override;
+    unsigned int GetPeriodLog2() const override { return gen_module.period_log2; }
+    virtual ~UniformGeneratorCBuffered()
+    {
+        gen_module.delete_state(nullptr, state);
+    }
+};
+
+
 /**
  * @brief Keeps the p value obtained for the test. Supports comparison
  * operator `<` that is important for `std::sort`.
@@ -210,6 +324,8 @@ class BatteryIO
 public:
     BatteryIO(std::shared_ptr<UniformGenerator> gobj) : gen(gobj) {}
     inline unif01_Gen *Gen() const { return gen.get()->GetPtr(); }
+    inline void SetGenerator(std::shared_ptr<UniformGenerator> gobj) { gen = gobj; }
+    inline std::shared_ptr<UniformGenerator> GetGenerator() const { return gen; }
 
     /**
      * @brief Adds the result of statistical test to the battery.
@@ -232,6 +348,41 @@ public:
 };
 
 
+/**
+ * @brief Seed of the test (or of its shard) derived from the master seed.
+ * Allows to replay the test alone.
+ */
+class TestSeedRecord
+{
+public:
+    int id; ///< Test ID.
+    size_t shard; ///< Shard index.
+    size_t nshards; ///< Number of shards of the test.
+    uint64_t seed; ///< Seed of the generator.
+    uint64_t stream; ///< Substream index (if streams are used).
+
+    TestSeedRecord(int id_, size_t shard_, size_t nshards_, uint64_t seed_,
+        uint64_t stream_ = 0)
+        : id(id_), shard(shard_), nshards(nshards_), seed(seed_), stream(stream_) {}
+};
+
+
+/**
+ * @brief Hardware counters measured during the run of the test or shard
+ * (see TestsPull::SetPerfCounters).
+ */
+class TestPerfRecord
+{
+public:
+    int id; ///< Test ID.
+    size_t shard; ///< Shard index.
+    PerfCounterValues perf; ///< Counters of the worker thread.
+
+    TestPerfRecord(int id_, size_t shard_, const PerfCounterValues &perf_)
+        : id(id_), shard(shard_), perf(perf_) {}
+};
+
+
 /**
  * @brief Array of p-values obtained from different tests from all threads
  * + TestU01 report.
@@ -241,9 +392,16 @@ class BatteryResults
 public:
     std::vector<std::vector<PValueRecord>> pvalues; ///< results[thread][test_ind]
     std::string report;
-
-    BatteryResults() {}
-    BatteryResults(size_t nthreads) : pvalues(nthreads) {}
+    bool seeded; ///< true if each test had its own seed (see TestsPull::SetSeed)
+    uint64_t seed; ///< Master seed.
+    size_t nshards; ///< Maximal number of shards used for splitting of tests.
+    unsigned int streams_log2; ///< log2 of the substream length (0 - no streams).
+    std::vector<TestSeedRecord> test_seeds; ///< Seeds of tests and shards.
+    std::vector<TestPerfRecord> test_perf; ///< Hardware counters of tests and shards.
+
+    BatteryResults() : seeded(false), seed(0), nshards(0), streams_log2(0) {}
+    BatteryResults(size_t nthreads)
+        : pvalues(nthreads), seeded(false), seed(0), nshards(0), streams_log2(0) {}
     std::string ToString() const;
 };
 
@@ -264,21 +422,127 @@ typedef std::function<void(TestDescr &, BatteryIO &)> TestCbFunc;
  */
 typedef std::function<std::shared_ptr<UniformGenerator>()> GenFactoryFunc;
 
+/**
+ * @brief Function that splits the test into `nshards` independent
+ * sub-runs (shards) with smaller number of replications. Each shard
+ * may be run in its own thread with its own generator; the shard that
+ * finishes the last merges the statistics and saves the final p-value.
+ * The function may return less shards than requested.
+ *
+ * Tests with one replication (N = 1) may be split into chunks, i.e. shards
+ * that process non-overlapping substreams of the same sequence (see
+ * `TestCbInfo::SetChunked`). Such shards are run only for generators that
+ * support jumps: each chunk gets the same seed and its own substream.
+ * Merged results of chunks are valid but differ from the serial run.
+ * Each shard is returned with its own estimates of cost and consumed
+ * outputs (see TestCbInfo).
+ */
+class TestCbInfo;
+typedef std::function<std::vector<TestCbInfo>(size_t nshards)> TestSplitFunc;
+
+
+/**
+ * @brief Test callback together with an a priori estimate of its
+ * computational cost. Returned by the `*_cb` functions that make
+ * callbacks for tests.
+ * @details The cost is measured in "generator calls", i.e. the number
+ * of pseudorandom numbers consumed by the test plus the equivalent amount
+ * of work made by the test itself (sorting, hashing, FFT, Berlekamp-Massey
+ * algorithm etc.). It is used only for relative comparison of tests.
+ * The memory estimate is the peak size of tables allocated by the test
+ * (for one replication); 0 means that memory consumption is negligible.
+ *
+ * The number of words is an upper bound of outputs consumed by the test
+ * (see `TestsPull::SetSampleRegions`); it is not related to the cost.
+ * Tests that consume a random number of outputs (Gap, CouponCollector,
+ * SumCollector etc.) use a bound that is exceeded with negligible
+ * probability. By default it is equal to the cost.
+ */
+class TestCbInfo
+{
+public:
+    TestCbFunc func; ///< Callback that runs the test.
+    double cost; ///< Estimated cost (in generator calls).
+    TestSplitFunc split; ///< Splits the test into shards (optional).
+    size_t max_shards; ///< Maximal number of shards (1 - cannot be split).
+    double mem; ///< Estimated peak memory, bytes.
+    bool chunked; ///< Shards are segments of one stream (require jumps).
+    double words; ///< Upper bound of consumed outputs.
+
+    TestCbInfo(TestCbFunc f, double cost_)
+        : func(f), cost(cost_), split(nullptr), max_shards(1), mem(0.0),
+        chunked(false), words(cost_) {}
+    TestCbInfo(TestCbFunc f, double cost_, TestSplitFunc split_, size_t max_shards_)
+        : func(f), cost(cost_), split(split_), max_shards(max_shards_), mem(0.0),
+        chunked(false), words(cost_) {}
+    inline TestCbInfo &SetMem(double bytes) { mem = bytes; return *this; }
+    inline TestCbInfo &SetWords(double n) { words = n; return *this; }
+    inline TestCbInfo &SetChunked() { chunked = true; return *this; }
+};
+
 
 class TestDescr
 {
     int id;
     std::string name;
+    size_t index; ///< Position of the test in the battery.
     std::function<void (TestDescr &td, BatteryIO &io)> pvalue_func;
+    double cost; ///< Estimated cost, see TestCbInfo. 0 means "unknown".
+    double words; ///< Upper bound of consumed outputs, see TestCbInfo.
+    uint64_t region_len; ///< Length of the sample region (see TestsPull).
+    TestSplitFunc split_func; ///< Splits the test into shards (optional).
+    size_t max_shards; ///< Maximal number of shards.
+    double shard_weight; ///< Fraction of the whole test made by this shard.
+    size_t shard_id; ///< Shard index.
+    size_t nshards; ///< Number of shards of the test.
+    double mem; ///< Estimated peak memory, bytes (0 - negligible).
+    uint64_t seed; ///< Seed of the generator (see TestsPull::SetSeed).
+    uint64_t stream; ///< Substream index (see TestsPull::SetStreams).
+    bool chunked; ///< Shards are segments of one stream (see TestCbInfo).
 
 public:
     inline int GetId() const { return id; }
     inline const std::string &GetName() const { return name; }
+    inline size_t GetIndex() const { return index; }
+    inline void SetIndex(size_t val) { index = val; }
+    inline double GetCost() const { return cost; }
+    inline void SetCost(double val) { cost = val; }
+    inline double GetWords() const { return words; }
+    inline void SetWords(double val) { words = val; }
+    inline uint64_t GetRegionLength() const { return region_len; }
+    inline void SetRegionLength(uint64_t val) { region_len = val; }
+    inline size_t GetMaxShards() const { return max_shards; }
+    inline double GetShardWeight() const { return shard_weight; }
+    inline size_t GetShardId() const { return shard_id; }
+    inline size_t GetNShards() const { return nshards; }
+    inline bool IsChunked() const { return chunked; }
+    inline uint64_t GetSeed() const { return seed; }
+    inline void SetSeed(uint64_t val) { seed = val; }
+    inline uint64_t GetStream() const { return stream; }
+    inline void SetStream(uint64_t val) { stream = val; }
+    inline double GetMem() const { return mem; }
+    inline void SetMem(double bytes) { mem = bytes; }
     inline void Run(BatteryIO &io) { pvalue_func(*this, io); }
+    std::vector<TestDescr> Split(size_t nshards) const;
+
+    TestDescr(int testid, const std::string &testname, TestCbFunc f,
+        double cost_ = 0.0, double words_ = 0.0)
+    : id(testid),
+        name(testname), index(0), pvalue_func(f), cost(cost_),
+        words((words_ > 0.0) ? words_ : cost_), region_len(0),
+        split_func(nullptr), max_shards(1), shard_weight(1.0),
+        shard_id(0), nshards(1), mem(0.0), seed(0), stream(0),
+        chunked(false)
+    {
+    }
 
-    TestDescr(int testid, const std::string &testname, TestCbFunc f)
+    TestDescr(int testid, const std::string &testname, const TestCbInfo &cb)
     : id(testid),
-        name(testname), pvalue_func(f)
+        name(testname), index(0), pvalue_func(cb.func), cost(cb.cost), words(cb.words),
+        region_len(0),
+        split_func(cb.split), max_shards(cb.max_shards), shard_weight(1.0),
+        shard_id(0), nshards(1), mem(cb.mem), seed(0), stream(0),
+        chunked(cb.chunked)
     {
     }
 };
@@ -286,20 +550,127 @@ public:
 
 
 
+/**
+ * @brief Memory budget for tests that are run simultaneously: a test
+ * waits until its memory estimate fits into the limit. The test that
+ * needs more than the limit waits until all other tests finish and then
+ * runs alone. `AcquireFirst` selects the first test of the list that
+ * fits, so the worker waits only when no test fits. Thread-safe.
+ */
+class MemoryBudget
+{
+    std::mutex mut;
+    std::condition_variable cv;
+    double limit; ///< Memory limit, bytes (0 - no limit).
+    double used; ///< Memory reserved by running tests, bytes.
+
+public:
+    MemoryBudget(double limit_ = 0.0) : limit(limit_), used(0.0) {}
+    inline double GetLimit() const { return limit; }
+    inline void SetLimit(double limit_) { limit = limit_; }
+    double Acquire(double bytes);
+    size_t AcquireFirst(const std::vector<double> &bytes,
+        std::vector<bool> &taken, double &reserved);
+    void Release(double bytes);
+};
+
+
+/**
+ * @brief Dispatcher of tests: runs tests from the list in several threads.
+ * @details Tests are sorted by their estimated cost and dispatched in the
+ * longest-processing-time-first (LPT) order: it prevents the situation
+ * when the longest test is started at the end of the battery and all other
+ * cores are idle. If the runtime history is attached then the measured
+ * running times from the previous runs are used instead of the cost model,
+ * and the measured times of the current run are added to the history.
+ * Tests with many replications (N > 1) may be split into shards that are
+ * run in different threads, see TestSplitFunc; long tests with one
+ * replication are split into chunks if the generator supports jumps.
+ * Tests are run as tasks
+ * of the persistent thread pool (see ThreadPool) that may be shared by
+ * several batteries. Each task takes the first test that wasn't started
+ * yet. If the memory limit is set, it is the first test whose memory
+ * estimate fits into the limit: tests that don't fit are skipped until
+ * the memory is released (see MemoryBudget).
+ *
+ * If the master seed is set (see `SetSeed`) then each test (and each
+ * shard) gets its own generator seeded by the seed derived from the master
+ * seed, test ID and shard index. Results of such test don't depend on the
+ * order of tests and number of threads, so the test may be replayed alone.
+ *
+ * If streams are enabled (see `SetStreams`) and the generator supports
+ * jumps then all generators are initialized by the same seed and moved
+ * to non-overlapping substreams of one sequence: each worker gets its own
+ * substream, or each test and shard if the master seed is set. Substreams
+ * of tests are numbered densely by the position of the test in the battery
+ * and the shard index; workers get substreams after them. If all substreams
+ * don't fit into the period of the generator, they are shortened.
+ *
+ * For finite sources such as stored files (see `SetSampleRegions`) each
+ * test and shard gets its own generator moved to the beginning of its own
+ * contiguous region (see `UniformGenerator::SetRegion`). Regions follow
+ * each other in the order of test IDs, their lengths are upper bounds
+ * of consumed outputs (see TestCbInfo). Tests that read beyond their
+ * regions and regions that don't fit into the source are reported.
+ *
+ * If hardware counters are enabled (see `SetPerfCounters`) then each
+ * worker measures cycles, instructions, cache and branch misses of its
+ * tests; they are saved to the results and to the runtime history.
+ */
 class TestsPull
 {
     std::vector<TestDescr> tests;
-    std::mutex get_mutex;
-    size_t pos;
+    std::shared_ptr<ThreadPool> pool; ///< Pool of worker threads.
+    std::shared_ptr<RuntimeHistory> history; ///< Runtime history (optional).
+    std::string history_battery; ///< Battery name for the history keys.
+    std::string history_gen; ///< Generator name for the history keys.
+    double calls_per_sec; ///< Cost units per second (0 - unknown).
+    MemoryBudget budget; ///< Memory budget for simultaneously run tests.
+    bool seeded; ///< Each test has its own seed derived from `seed`.
+    uint64_t seed; ///< Master seed.
+    size_t nshards; ///< Maximal number of shards (0 - number of threads).
+    unsigned int streams_log2; ///< log2 of the substream length (0 - no streams).
+    bool regions; ///< Tests read contiguous regions of one sequence.
+    uint64_t regions_limit; ///< Length of the source for regions (0 - unlimited).
+    bool perf; ///< Collect hardware counters of tests.
+    std::vector<PerfCounterValues> tests_perf; ///< Hardware counters of tests.
+    std::vector<uint64_t> tests_overruns; ///< Reads beyond the regions of tests.
+    std::vector<double> tests_mem; ///< Memory estimates of tests.
+    std::vector<bool> tests_taken; ///< Tests taken by tasks (see MemoryBudget).
+    GenFactoryFunc create_gen; ///< Factory of generators for seeded tests.
+
+    static const unsigned int CHUNK_LOG2 = 40; ///< log2 of the chunk substream length.
+
+    std::shared_ptr<UniformGenerator> CreateGenerator(uint64_t gen_seed,
+        uint64_t stream, uint64_t region_len = 0);
 
     size_t GetNThreads() const;
-    static void ThreadFunc(TestsPull &pull, BatteryIO &io, int thread_id);
+    uint64_t SetRegions();
+    void RunTestTask(BatteryIO &io, int thread_id);
+    void SortTests();
+    void SplitTests(size_t nthreads, bool jumpable);
+    void ApplyHistory();
+    double GetMakespan(size_t nthreads) const;
+    void PrintSchedule(size_t nthreads) const;
 
 
 public:
-    TestsPull() {}
+    TestsPull() : calls_per_sec(0.0), seeded(false), seed(0), nshards(0),
+        streams_log2(0), regions(false), regions_limit(0), perf(false) {}
     TestsPull(const std::vector<TestDescr> &obj);
-    const TestDescr *Get(std::string &pos_msg);
+    void SetHistory(std::shared_ptr<RuntimeHistory> hist, const std::string &battery);
+    void SetThreadPool(std::shared_ptr<ThreadPool> pool_) { pool = pool_; }
+    void SetMemLimit(double bytes) { budget.SetLimit(bytes); }
+    void SetSeed(uint64_t master_seed) { seeded = true; seed = master_seed; }
+    void SetNShards(size_t n) { nshards = n; }
+    void SetStreams(unsigned int log2_distance) { streams_log2 = log2_distance; }
+    /**
+     * @brief Enables sample regions.
+     * @param nwords  Length of the source in outputs (0 - unlimited).
+     */
+    void SetSampleRegions(bool enabled, uint64_t nwords = 0)
+        { regions = enabled; regions_limit = nwords; }
+    void SetPerfCounters(bool enabled) { perf = enabled; }
 
     BatteryResults Run(std::function<std::shared_ptr<UniformGenerator>()> create_gen,
         const std::string &battery_name);
@@ -318,9 +689,28 @@ protected:
     GenFactoryFunc create_gen;
     std::string battery_name;
     std::string generator_name;
+    std::shared_ptr<RuntimeHistory> history;
+    std::shared_ptr<ThreadPool> pool;
+    double mem_limit; ///< Memory limit for tests, bytes (0 - no limit).
+    bool seeded; ///< Use the master seed (see TestsPull::SetSeed).
+    uint64_t seed; ///< Master seed.
+    size_t nshards; ///< Maximal number of shards (0 - number of threads).
+    unsigned int streams_log2; ///< log2 of the substream length (0 - no streams).
+    bool regions; ///< Tests read contiguous regions (see TestsPull).
+    uint64_t regions_limit; ///< Length of the source for regions (0 - unlimited).
+    bool perf; ///< Collect hardware counters of tests (see TestsPull).
 
 public:
     TestsBattery(GenFactoryFunc genf);
+    void SetHistory(std::shared_ptr<RuntimeHistory> hist) { history = hist; }
+    void SetThreadPool(std::shared_ptr<ThreadPool> pool_) { pool = pool_; }
+    void SetMemLimit(double bytes) { mem_limit = bytes; }
+    void SetSeed(uint64_t master_seed) { seeded = true; seed = master_seed; }
+    void SetNShards(size_t n) { nshards = n; }
+    void SetStreams(unsigned int log2_distance) { streams_log2 = log2_distance; }
+    void SetSampleRegions(bool enabled, uint64_t nwords = 0)
+        { regions = enabled; regions_limit = nwords; }
+    void SetPerfCounters(bool enabled) { perf = enabled; }
     BatteryResults Run() const;
     BatteryResults RunTest(int id) const;
 };
@@ -333,43 +723,43 @@ void prng_array32_to_file(std::shared_ptr<UniformGenerator> genptr);
 void prng_bits64_to_file(std::shared_ptr<UniformGenerator> genptr);
 void prng_array64_to_file(std::shared_ptr<UniformGenerator> genptr);
 
-TestCbFunc svaria_AppearanceSpacings_cb(long N, long Q, long K, int r, int s, int L);
-TestCbFunc sstring_AutoCor_cb(long N, long n, int r, int s, int d);
-TestCbFunc smarsa_BirthdaySpacings_cb(long N, long n, int r, long d, int t, int p);
-TestCbFunc smarsa_CollisionOver_cb(long N, long n, int r, long d, int t);
-TestCbFunc sknuth_CollisionPermut_cb(long N, long n, int r, int t);
-TestCbFunc sknuth_CouponCollector_cb(long N, long n, int r, int d);
-TestCbFunc snpair_ClosePairs_cb(long N, long n, int r, int k, int p, int m, const std::string &mess, bool flag);
-TestCbFunc snpair_ClosePairsNP_cb(long N, long n, int r, int k, int p, int m);
-TestCbFunc snpair_ClosePairsBitMatch_cb(long N, long n, int r, int t);
-TestCbFunc smarsa_Dna_cb(int i);
-TestCbFunc sspectral_Fourier3_cb(long N, int k, int r, int s);
-TestCbFunc sknuth_Gap_cb(long N, long n, int r, double Alpha, double Beta);
-TestCbFunc smarsa_GCD_cb(long N, long n, int r, int s);
-TestCbFunc sstring_HammingCorr_cb(long N, long n, int r, int s, int L);
-TestCbFunc sstring_HammingIndep_cb(long N, long n, int r, int s, int L, int d);
-TestCbFunc sstring_HammingWeight2_cb(long N, int r, int s, long L, long K);
-TestCbFunc scomp_LempelZiv_cb(long N, int t, int r, int s);
-TestCbFunc scomp_LinearComp_cb(long N, long n, int r, int s);
-TestCbFunc sstring_LongestHeadRun_cb(long N, long n, int r, int s, long L);
-TestCbFunc smarsa_MatrixRank_cb(long N, long n, int r, int s, int L, int k);
-TestCbFunc sknuth_MaxOft_cb(long N, long n, int r, int d, int t);
-TestCbFunc smarsa_Opso_cb(long N, int r, int p);
-TestCbFunc smarsa_Oqso_cb(int i);
-TestCbFunc sstring_PeriodsInStrings_cb(long N, long n, int r, int s);
-TestCbFunc sknuth_Permutation_cb(long N, long n, int r, int t);
-TestCbFunc smarsa_RandomWalk1_cb(long N, long n, int r, int s,
+TestCbInfo svaria_AppearanceSpacings_cb(long N, long Q, long K, int r, int s, int L);
+TestCbInfo sstring_AutoCor_cb(long N, long n, int r, int s, int d);
+TestCbInfo smarsa_BirthdaySpacings_cb(long N, long n, int r, long d, int t, int p);
+TestCbInfo smarsa_CollisionOver_cb(long N, long n, int r, long d, int t);
+TestCbInfo sknuth_CollisionPermut_cb(long N, long n, int r, int t);
+TestCbInfo sknuth_CouponCollector_cb(long N, long n, int r, int d);
+TestCbInfo snpair_ClosePairs_cb(long N, long n, int r, int k, int p, int m, const std::string &mess, bool flag);
+TestCbInfo snpair_ClosePairsNP_cb(long N, long n, int r, int k, int p, int m);
+TestCbInfo snpair_ClosePairsBitMatch_cb(long N, long n, int r, int t);
+TestCbInfo smarsa_Dna_cb(int i);
+TestCbInfo sspectral_Fourier3_cb(long N, int k, int r, int s);
+TestCbInfo sknuth_Gap_cb(long N, long n, int r, double Alpha, double Beta);
+TestCbInfo smarsa_GCD_cb(long N, long n, int r, int s);
+TestCbInfo sstring_HammingCorr_cb(long N, long n, int r, int s, int L);
+TestCbInfo sstring_HammingIndep_cb(long N, long n, int r, int s, int L, int d);
+TestCbInfo sstring_HammingWeight2_cb(long N, int r, int s, long L, long K);
+TestCbInfo scomp_LempelZiv_cb(long N, int t, int r, int s);
+TestCbInfo scomp_LinearComp_cb(long N, long n, int r, int s);
+TestCbInfo sstring_LongestHeadRun_cb(long N, long n, int r, int s, long L);
+TestCbInfo smarsa_MatrixRank_cb(long N, long n, int r, int s, int L, int k);
+TestCbInfo sknuth_MaxOft_cb(long N, long n, int r, int d, int t);
+TestCbInfo smarsa_Opso_cb(long N, int r, int p);
+TestCbInfo smarsa_Oqso_cb(int i);
+TestCbInfo sstring_PeriodsInStrings_cb(long N, long n, int r, int s);
+TestCbInfo sknuth_Permutation_cb(long N, long n, int r, int t);
+TestCbInfo smarsa_RandomWalk1_cb(long N, long n, int r, int s,
     long L0, long L1, const std::string &mess);
-TestCbFunc sknuth_Run_cb(long N, long n, int r, bool Up);
-TestCbFunc sstring_Run_cb(long N, long n, int r, int s);
-TestCbFunc svaria_SampleCorr_cb(long N, long n, int r, int k);
-TestCbFunc svaria_SampleProd_cb(long N, long n, int r, int t);
-TestCbFunc svaria_SampleMean_cb(long N, long n, int r);
-TestCbFunc smarsa_Savir2_cb(long N, long n, int r, long m, int t);
-TestCbFunc smarsa_SerialOver_cb(long N, long n, int r, long d, int t);
-TestCbFunc sknuth_SimpPoker_cb(long N, long n, int r, int d, int k);
-TestCbFunc svaria_SumCollector_cb(long N, long n, int r, double g);
-TestCbFunc svaria_WeightDistrib_cb(long N, long n, int r, long k,
+TestCbInfo sknuth_Run_cb(long N, long n, int r, bool Up);
+TestCbInfo sstring_Run_cb(long N, long n, int r, int s);
+TestCbInfo svaria_SampleCorr_cb(long N, long n, int r, int k);
+TestCbInfo svaria_SampleProd_cb(long N, long n, int r, int t);
+TestCbInfo svaria_SampleMean_cb(long N, long n, int r);
+TestCbInfo smarsa_Savir2_cb(long N, long n, int r, long m, int t);
+TestCbInfo smarsa_SerialOver_cb(long N, long n, int r, long d, int t);
+TestCbInfo sknuth_SimpPoker_cb(long N, long n, int r, int d, int k);
+TestCbInfo svaria_SumCollector_cb(long N, long n, int r, double g);
+TestCbInfo svaria_WeightDistrib_cb(long N, long n, int r, long k,
     double alpha, double beta);
 
 } // namespace testu01_threads
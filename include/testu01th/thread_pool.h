@@ -0,0 +1,178 @@
+/**
+ * @file thread_pool.h
+ * @brief Persistent pool of worker threads with per-worker queues
+ * of tasks and work stealing. Used by the tests dispatcher instead of
+ * creating new threads for each battery. Workers may be pinned to CPUs
+ * or NUMA nodes.
+ * @copyright (c) 2024 Alexey L. Voskov, Lomonosov Moscow State University.
+ * alvoskov@gmail.com
+ *
+ * All rights reserved.
+ *
+ * This software is provided under the Apache 2 License.
+ *
+ * In scientific publications which used this software, a reference to it
+ * would be appreciated.
+ */
+#ifndef __THREAD_POOL_H
+#define __THREAD_POOL_H
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+
+namespace testu01_threads {
+
+/**
+ * @brief Policy of binding of worker threads to CPUs.
+ */
+enum AffinityPolicy
+{
+    AFFINITY_NONE, ///< Threads are not pinned (the OS scheduler decides).
+    AFFINITY_COMPACT, ///< Worker i is pinned to CPU i (fills node by node).
+    AFFINITY_SCATTER, ///< Workers are pinned to CPUs of different nodes in turn.
+    AFFINITY_NODE ///< Workers are split between nodes and pinned to the whole node.
+};
+
+bool parse_affinity_policy(const std::string &name, AffinityPolicy &policy);
+
+/**
+ * @brief CPUs grouped by NUMA nodes. Obtained from
+ * `/sys/devices/system/node` on Linux; on other systems (or if
+ * this information is not available) all CPUs belong to one node.
+ */
+class CpuTopology
+{
+public:
+    std::vector<std::vector<int>> nodes; ///< CPUs indexes for each node.
+
+    static CpuTopology Detect();
+    size_t GetNCpus() const;
+    std::vector<int> GetWorkerCpus(size_t worker_id, size_t nworkers,
+        AffinityPolicy policy) const;
+};
+
+/**
+ * @brief Task for the thread pool. The argument is the index of
+ * the worker that runs the task, it may be used for access to
+ * per-worker data (e.g. generators) without locks.
+ */
+typedef std::function<void(size_t worker_id)> PoolTask;
+
+/**
+ * @brief Group of tasks of the thread pool: counts its unfinished tasks,
+ * so the task may wait for its own sub-tasks without waiting for all tasks
+ * of the pool (see `ThreadPool::Wait(TaskGroup &)`). The group must live
+ * until its tasks are finished.
+ */
+class TaskGroup
+{
+    friend class ThreadPool;
+    std::atomic<size_t> npending; ///< Tasks of the group in queues or running.
+    std::atomic<size_t> nqueued; ///< Tasks of the group in queues.
+
+public:
+    TaskGroup() : npending(0), nqueued(0) {}
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+    inline size_t GetNPending() const { return npending; }
+};
+
+/**
+ * @brief Persistent pool of worker threads with work stealing.
+ * @details Each worker has its own queue of tasks. The worker takes
+ * tasks from the front of its own queue; if it is empty, the worker
+ * steals the task from the front of other workers' queues. Tasks
+ * are taken from the front because the dispatcher submits tests in the
+ * longest-first order. `Wait()` waits for all tasks of the pool, so it
+ * must not be called from tasks. Tasks may submit sub-tasks as a group
+ * (see TaskGroup) and wait for them by `Wait(group)`: the waiting worker
+ * runs queued tasks of this group instead of sleeping, so the pool is not
+ * blocked even if all workers are waiting for their sub-tasks. Only tasks
+ * of the same group are taken: other tasks could use the same per-worker
+ * data as the waiting task.
+ *
+ * Pinned tasks (see `SubmitPinned`) are never stolen: they are used for
+ * initialization of per-worker data such as generators, so their memory
+ * is first touched by the thread (and on the NUMA node) that will use it.
+ *
+ * Only the first `nactive` workers take tasks, so the same pool may be
+ * used for batteries with different number of threads. The pool runs
+ * one group of tasks at a time: `SetNActive` must not be called while
+ * tasks are being processed.
+ */
+class ThreadPool
+{
+    /**
+     * @brief Queue of tasks of one worker.
+     */
+    class QueuedTask
+    {
+    public:
+        PoolTask func;
+        TaskGroup *group; ///< Group of the task (optional).
+        QueuedTask(PoolTask func_ = nullptr, TaskGroup *group_ = nullptr)
+            : func(std::move(func_)), group(group_) {}
+    };
+
+    class WorkerQueue
+    {
+    public:
+        std::mutex mut;
+        std::deque<QueuedTask> tasks; ///< Tasks that may be stolen.
+        std::deque<PoolTask> pinned; ///< Tasks only for this worker.
+        std::atomic<size_t> npinned;
+        WorkerQueue() : npinned(0) {}
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex mut; ///< Protects sleeping/waking up of workers.
+    std::condition_variable cv_work; ///< New tasks or stop request.
+    std::condition_variable cv_done; ///< All tasks are finished.
+    std::atomic<size_t> nqueued; ///< Tasks in queues.
+    std::atomic<size_t> npending; ///< Tasks in queues or running.
+    std::atomic<size_t> nactive; ///< Number of workers that take tasks.
+    std::atomic<size_t> next_queue; ///< For round-robin submission.
+    bool stop;
+    AffinityPolicy affinity; ///< CPU affinity of workers.
+    CpuTopology topology;
+
+    bool TryPop(size_t id, QueuedTask &task, const TaskGroup *group = nullptr);
+    bool TrySteal(size_t id, QueuedTask &task, const TaskGroup *group = nullptr);
+    void RunTask(size_t id, QueuedTask &task);
+    void Push(QueuedTask task, size_t worker_id);
+    void WorkerFunc(size_t id);
+    void PinWorker(size_t id);
+
+public:
+    ThreadPool(size_t nthreads = 0, AffinityPolicy affinity_ = AFFINITY_NONE);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    inline size_t GetNThreads() const { return threads.size(); }
+    inline size_t GetNActive() const { return nactive; }
+    void SetNActive(size_t n);
+    void Submit(PoolTask task, size_t worker_id);
+    void Submit(PoolTask task);
+    void Submit(const std::vector<PoolTask> &tasks);
+    void Submit(TaskGroup &group, PoolTask task);
+    void Submit(TaskGroup &group, const std::vector<PoolTask> &tasks);
+    void SubmitPinned(PoolTask task, size_t worker_id);
+    void Wait();
+    void Wait(TaskGroup &group);
+    inline AffinityPolicy GetAffinity() const { return affinity; }
+    inline const CpuTopology &GetTopology() const { return topology; }
+
+    static std::shared_ptr<ThreadPool> GetGlobal();
+};
+
+} // namespace testu01_threads
+
+#endif
@@ -8,7 +8,7 @@ using namespace testu01_threads;
 
 /**
  * @brief Initialize the structure with information about PRNG
- * with empty values (pointers to empty strings and nullptrs)
+ * with empty values (pointers to empty strings and nullptrs).
  */
 void GenInfoC_init(GenInfoC *obj)
 {
@@ -24,6 +24,25 @@ void GenInfoC_init(GenInfoC *obj)
     obj->get_sum32 = nullptr;
     obj->get_sum64 = nullptr;
     obj->run_self_test = nullptr;
+    obj->get_array_u01 = nullptr;
+    obj->flags = 0;
+    obj->init_state_seeded = nullptr;
+    obj->jump = nullptr;
+    obj->period_log2 = 0;
+}
+
+/**
+ * @brief Fills the structure initialized by `GenInfoC_init` by the module.
+ * Uses `gen_getinfo2` if the module exports it; otherwise the extended
+ * fields of the structure keep their empty values.
+ */
+int GenCModule_getinfo(const GenCModule *mod, GenInfoC *gi)
+{
+    if (mod->gen_getinfo2 != nullptr) {
+        return mod->gen_getinfo2(gi, sizeof(GenInfoC));
+    } else {
+        return mod->gen_getinfo(gi);
+    }
 }
 
 /**
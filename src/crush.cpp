@@ -130,14 +130,14 @@ CrushBattery::CrushBattery(GenFactoryFunc genf)
         sknuth_Run(io.Gen(), res, 1, 500 * MILLION, 0, TRUE);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteChi2(res);
-    });
+    }, 500.0 * MILLION, 500.0 * MILLION + 1);
 
     tests.emplace_back(++j2, "Run of U01, r = 15", [] (TestDescr &td, BatteryIO &io) {
         sres_Chi2 *res = sres_CreateChi2();
         sknuth_Run(io.Gen(), res, 1, 500 * MILLION, 15, FALSE);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteChi2(res);
-    });
+    }, 500.0 * MILLION, 500.0 * MILLION + 1);
 
     // Run of Permutation
     tests.emplace_back(++j2, "Permutation, r = 0",
@@ -152,14 +152,14 @@ CrushBattery::CrushBattery(GenFactoryFunc genf)
         sknuth_CollisionPermut(io.Gen(), res, 5, 10 * MILLION, 0, 13);
         io.Add(td.GetId(), td.GetName(), res->Pois->pVal2);
         sknuth_DeleteRes2(res);
-    });
+    }, 2.0 * 5 * 10 * MILLION * 13, 5.0 * 10 * MILLION * 13);
 
     tests.emplace_back(++j2, "CollisionPermut, r = 15", [] (TestDescr &td, BatteryIO &io) {
         sknuth_Res2 *res = sknuth_CreateRes2 ();
         sknuth_CollisionPermut (io.Gen(), res, 5, 10 * MILLION, 15, 13);
         io.Add(td.GetId(), td.GetName(), res->Pois->pVal2);
         sknuth_DeleteRes2(res);
-    });
+    }, 2.0 * 5 * 10 * MILLION * 13, 5.0 * 10 * MILLION * 13);
 
     // MaxOft tests
     tests.emplace_back(++j2, "MaxOft, t = 5",
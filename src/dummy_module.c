@@ -58,6 +58,16 @@ static void dummy_get_array64(void *param, void *state, uint64_t *out, size_t le
 }
 
 
+static void dummy_get_array_u01(void *param, void *state, double *out, size_t len)
+{
+    (void) param;
+    (void) state;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = 0.0;
+    }
+}
+
+
 static uint32_t dummy_get_sum32(void *param, void *state, size_t len)
 {
     uint32_t data[] = {9338, 34516, 60623, 45281,
@@ -99,7 +109,7 @@ static void dummy_delete_state(void *param, void *state)
 }
 
 
-int dummy_gen_getinfo(GenInfoC *gi)
+int dummy_gen_getinfo2(GenInfoC *gi, size_t size)
 {
     gi->name = "Dummy";
     gi->init_state = dummy_init_state;
@@ -112,16 +122,27 @@ int dummy_gen_getinfo(GenInfoC *gi)
     gi->get_sum32 = dummy_get_sum32;
     gi->get_sum64 = dummy_get_sum64;
     gi->run_self_test = NULL;
+    if (GENINFOC_HAS_FIELD(size, get_array_u01)) {
+        gi->get_array_u01 = dummy_get_array_u01;
+    }
+    GenInfoC_set_flags(gi, size, GENINFOC_FLAG_NATIVE64 | GENINFOC_FLAG_THREADSAFE);
     return 1;
 }
 
 
+int dummy_gen_getinfo(GenInfoC *gi)
+{
+    return dummy_gen_getinfo2(gi, GENINFOC_BASE_SIZE);
+}
+
+
 GenCModule dummy_init_cmodule()
 {
     GenCModule dummy_cmodule;
     dummy_cmodule.gen_initlib = dummy_initlib;
     dummy_cmodule.gen_closelib = dummy_closelib;
     dummy_cmodule.gen_getinfo = dummy_gen_getinfo;
+    dummy_cmodule.gen_getinfo2 = dummy_gen_getinfo2;
     return dummy_cmodule;
 }
 
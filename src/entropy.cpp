@@ -3,13 +3,53 @@
 
 #if (defined(WIN32) || defined(WIN64)) && !defined(__MINGW32__) && !defined(__MINGW64__)
 #include <intrin.h>
+#include <immintrin.h>
 #pragma intrinsic(__rdtsc)
+#define TARGET_ATTR(x)
 #else
 #include <x86intrin.h>
+#include <cpuid.h>
+#define TARGET_ATTR(x) __attribute__((target(x)))
+#endif
+
+#if defined(__linux__)
+#include <sys/random.h>
 #endif
 
 using namespace testu01_threads;
 
+/**
+ * @brief Converts the method name (rdseed, rdrand, rdtsc, getrandom, time,
+ * fixed) to the EntropyMethod value.
+ * @return true if the name is valid, false otherwise.
+ */
+bool testu01_threads::parse_entropy_method(const std::string &name,
+    EntropyMethod &method)
+{
+    static const EntropyMethod methods[] = {ENTROPY_TIME, ENTROPY_RDTSC,
+        ENTROPY_RDSEED, ENTROPY_RDRAND, ENTROPY_GETRANDOM, ENTROPY_FIXED};
+    for (EntropyMethod m : methods) {
+        if (name == entropy_method_name(m)) {
+            method = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *testu01_threads::entropy_method_name(EntropyMethod method)
+{
+    switch (method) {
+    case ENTROPY_TIME: return "time";
+    case ENTROPY_RDTSC: return "rdtsc";
+    case ENTROPY_RDSEED: return "rdseed";
+    case ENTROPY_RDRAND: return "rdrand";
+    case ENTROPY_GETRANDOM: return "getrandom";
+    case ENTROPY_FIXED: return "fixed";
+    }
+    return "unknown";
+}
+
 static inline uint64_t ror64(uint64_t x, uint64_t r)
 {
     return (x << r) | (x >> (64 - r));
@@ -18,7 +58,7 @@ static inline uint64_t ror64(uint64_t x, uint64_t r)
 /**
  * @brief rrmxmx hash from modified SplitMix PRNG.
  */
-uint64_t Entropy::MixHash(uint64_t z) const
+uint64_t Entropy::MixHash(uint64_t z)
 {
     static uint64_t const M = 0x9fb21c651e98df25ULL;    
     z ^= ror64(z, 49) ^ ror64(z, 24);
@@ -61,24 +101,141 @@ uint64_t Entropy::Xxtea(const uint64_t inp) const
 }
 
 /**
- * @brief XORs input with output of hardware RNG in CPU (rdseed).
+ * @brief Checks if the CPU supports RDSEED instruction (by CPUID).
+ */
+bool Entropy::HasRdSeed()
+{
+#if (defined(WIN32) || defined(WIN64)) && !defined(__MINGW32__) && !defined(__MINGW64__)
+    int regs[4];
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 18)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ebx & (1 << 18)) != 0;
+#endif
+}
+
+/**
+ * @brief Checks if the CPU supports RDRAND instruction (by CPUID).
  */
-uint64_t Entropy::MixRdSeed(const uint64_t x) const
+bool Entropy::HasRdRand()
 {
+#if (defined(WIN32) || defined(WIN64)) && !defined(__MINGW32__) && !defined(__MINGW64__)
+    int regs[4];
+    __cpuid(regs, 1);
+    return (regs[2] & (1 << 30)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ecx & (1 << 30)) != 0;
+#endif
+}
+
+/**
+ * @brief Returns the best entropy source supported by the CPU and the OS.
+ */
+EntropyMethod Entropy::DetectMethod()
+{
+    if (HasRdSeed()) {
+        return ENTROPY_RDSEED;
+    } else if (HasRdRand()) {
+        return ENTROPY_RDRAND;
+    }
+#if defined(__linux__)
+    return ENTROPY_GETRANDOM;
+#else
+    return ENTROPY_RDTSC;
+#endif
+}
+
+/**
+ * @brief RDSEED instruction with bounded number of retries: it may fail
+ * many times in a row if the hardware entropy source is exhausted.
+ */
+TARGET_ATTR("rdseed") static bool rdseed64(uint64_t &out)
+{
+    constexpr int nretries = 128;
     long long unsigned int rd;
-    while (!_rdseed64_step(&rd)) {}
-    return x ^ rd;
+    for (int i = 0; i < nretries; i++) {
+        if (_rdseed64_step(&rd)) {
+            out = rd;
+            return true;
+        }
+        _mm_pause();
+    }
+    return false;
 }
 
+/**
+ * @brief RDRAND instruction with 10 retries (as recommended by Intel).
+ */
+TARGET_ATTR("rdrnd") static bool rdrand64(uint64_t &out)
+{
+    constexpr int nretries = 10;
+    long long unsigned int rd;
+    for (int i = 0; i < nretries; i++) {
+        if (_rdrand64_step(&rd)) {
+            out = rd;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Obtains 64 bits from the OS entropy pool without blocking.
+ */
+static bool getrandom64(uint64_t &out)
+{
+#if defined(__linux__)
+    return getrandom(&out, sizeof(out), GRND_NONBLOCK) == (ssize_t) sizeof(out);
+#else
+    (void) out;
+    return false;
+#endif
+}
 
 /**
- * @brief Generates the next state and returns it in the hashed form.
- * It is essentially SplitMix PRNG that will be used as an input of XXTEA.
+ * @brief XORs input with output of the selected entropy source. If it
+ * fails or is not supported then RDRAND or RDTSC is used instead.
  */
-uint64_t Entropy::NextState()
+uint64_t Entropy::MixHwEntropy(const uint64_t x) const
 {
-    state += 0x9E3779B97F4A7C15;
-    return MixRdSeed(MixHash(state));
+    static const bool has_rdseed = HasRdSeed(), has_rdrand = HasRdRand();
+    uint64_t rd;
+    if (method == ENTROPY_TIME || method == ENTROPY_FIXED) {
+        return x;
+    } else if (method == ENTROPY_RDSEED && has_rdseed && rdseed64(rd)) {
+        return x ^ rd;
+    } else if (method == ENTROPY_GETRANDOM && getrandom64(rd)) {
+        return x ^ rd;
+    } else if (method != ENTROPY_RDTSC && has_rdrand && rdrand64(rd)) {
+        return x ^ rd;
+    }
+    return x ^ MixHash(CpuClock());
+}
+
+
+/**
+ * @brief Generates the batch of seeds. The range of counter values is
+ * reserved by one atomic operation, so threads don't wait each other.
+ * Counter values are hashed (it is essentially SplitMix PRNG), XORed with
+ * one RDSEED output and encrypted by XXTEA.
+ */
+void Entropy::FillBatch(uint64_t *out, size_t len)
+{
+    constexpr uint64_t GOLDEN = 0x9E3779B97F4A7C15;
+    uint64_t ctr = state.fetch_add(GOLDEN * len, std::memory_order_relaxed);
+    uint64_t rd = MixHwEntropy(0);
+    for (size_t i = 0; i < len; i++) {
+        ctr += GOLDEN;
+        out[i] = Xxtea(MixHash(ctr) ^ rd);
+    }
 }
 
 
@@ -105,32 +262,158 @@ bool Entropy::XxteaTest()
 }
 
 
+/**
+ * @brief Counter of Entropy objects: thread-local batches of seeds
+ * are bound to the object by its ID, not by its address.
+ */
+static std::atomic<uint64_t> entropy_ninstances(0);
+
 Entropy::Entropy()
+    : method(DetectMethod()), instance_id(++entropy_ninstances),
+    seeds_log(new uint64_t[SEEDS_LOG_MAX]), nseeds(0)
 {
-    uint64_t seed0 = MixRdSeed(MixHash(time(NULL)));
-    uint64_t seed1 = MixRdSeed(MixHash(~seed0));
-    seed1 ^= MixRdSeed(MixHash(CpuClock()));
+    Init();
+}
+
+Entropy::Entropy(EntropyMethod method_)
+    : method(method_), instance_id(++entropy_ninstances),
+    seeds_log(new uint64_t[SEEDS_LOG_MAX]), nseeds(0)
+{
+    Init();
+}
+
+/**
+ * @brief Makes XXTEA key and the initial counter value.
+ */
+void Entropy::Init()
+{
+    uint64_t t = (method == ENTROPY_FIXED) ? 0 : (uint64_t) time(NULL);
+    uint64_t seed0 = MixHwEntropy(MixHash(t));
+    uint64_t seed1 = MixHwEntropy(MixHash(~seed0));
+    if (method != ENTROPY_TIME && method != ENTROPY_FIXED) {
+        seed1 ^= MixHwEntropy(MixHash(CpuClock()));
+    }
     key[0] = (uint32_t) seed0; key[1] = seed0 >> 32;
     key[2] = (uint32_t) seed1; key[3] = seed1 >> 32;
-    state = time(NULL);
+    state = t;
 //    printf("%X %X %X %X\n", key[0], key[1], key[2], key[3]);
 }
 
 /**
- * @brief Thread-safe function for returning seed.
- * @details It is a very slow function.
+ * @brief Changes the source of entropy and reinitializes the generator.
+ * Must not be called while other threads request seeds.
+ */
+void Entropy::SetMethod(EntropyMethod method_)
+{
+    method = method_;
+    instance_id = ++entropy_ninstances; // Drop batches made by the old key
+    Init();
+}
+
+/**
+ * @brief Batch of seeds reserved by the thread (see Entropy::FillBatch).
+ */
+class SeedsBatch
+{
+public:
+    uint64_t owner; ///< ID of the Entropy object (0 - empty batch).
+    size_t pos; ///< Index of the next seed.
+    uint64_t seeds[Entropy::SEEDS_BATCH];
+};
+
+static thread_local SeedsBatch seeds_batch = {0, Entropy::SEEDS_BATCH, {0}};
+
+/**
+ * @brief Thread-safe and lock-free function for returning seed.
+ * @details Seeds are taken from the batch of the calling thread; the new
+ * batch is made when it is exhausted. If the deterministic seeds are
+ * enabled for the calling thread (see `SetThreadSeed`) then they are
+ * returned instead (and not saved to the log).
  */
 uint64_t Entropy::Seed64()
 {
-    std::lock_guard<std::mutex> guard(mut);
-    uint64_t seed = Xxtea(NextState());
-    if (seeds_log.size() < 1048576) {
-        seeds_log.push_back(seed);
+    uint64_t thread_seed;
+    if (NextThreadSeed(thread_seed)) {
+        return thread_seed;
+    }
+    SeedsBatch &b = seeds_batch;
+    if (b.owner != instance_id || b.pos >= SEEDS_BATCH) {
+        FillBatch(b.seeds, SEEDS_BATCH);
+        b.owner = instance_id;
+        b.pos = 0;
+    }
+    uint64_t seed = b.seeds[b.pos++];
+    size_t ind = nseeds.fetch_add(1, std::memory_order_relaxed);
+    if (ind < SEEDS_LOG_MAX) {
+        seeds_log[ind] = seed;
     }
     return seed;
 }
 
+/**
+ * @brief Returns the number of seeds in the log. Must be called only
+ * when all threads that request seeds are finished.
+ */
+size_t Entropy::GetNSeeds() const
+{
+    size_t n = nseeds.load();
+    return (n < SEEDS_LOG_MAX) ? n : SEEDS_LOG_MAX;
+}
+
 uint64_t Entropy::CpuClock()
 {
     return __rdtsc();
 }
+
+/**
+ * @brief Derives the seed for the test from the master seed, e.g.
+ * `a` is the test ID and `b` is the shard index. Seeds for different
+ * (a, b) pairs are independent.
+ */
+uint64_t Entropy::DeriveSeed(uint64_t master_seed, uint64_t a, uint64_t b)
+{
+    uint64_t z = MixHash(master_seed + 0x9E3779B97F4A7C15);
+    z = MixHash(z ^ (a * 0xD1B54A32D192ED03));
+    return MixHash(z ^ (b * 0x8CB92BA72F3D8DD7));
+}
+
+/**
+ * @brief Deterministic seeds for the calling thread (SplitMix
+ * with rrmxmx output function).
+ */
+static thread_local bool thread_seed_active = false;
+static thread_local uint64_t thread_seed_state = 0;
+
+/**
+ * @brief Enables the deterministic stream of seeds for the calling thread:
+ * `Seed64` will return outputs of SplitMix PRNG initialized by `seed`.
+ * Used for reproducible initialization of generators.
+ */
+void Entropy::SetThreadSeed(uint64_t seed)
+{
+    thread_seed_active = true;
+    thread_seed_state = seed;
+}
+
+/**
+ * @brief Disables the deterministic stream of seeds for the calling thread.
+ */
+void Entropy::ResetThreadSeed()
+{
+    thread_seed_active = false;
+}
+
+/**
+ * @brief Returns the next seed from the deterministic stream of the
+ * calling thread.
+ * @return false if the stream is not enabled (see `SetThreadSeed`).
+ */
+bool Entropy::NextThreadSeed(uint64_t &seed)
+{
+    if (!thread_seed_active) {
+        return false;
+    }
+    thread_seed_state += 0x9E3779B97F4A7C15;
+    seed = MixHash(thread_seed_state);
+    return true;
+}
@@ -0,0 +1,335 @@
+#include "testu01th/fanout_reader.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace testu01_threads;
+
+/**
+ * @brief Converts the decomposition name (u32, high32, low32, interleaved32,
+ * reversed32, double) to the InputFormat value.
+ * @return true if the name is valid, false otherwise.
+ */
+bool testu01_threads::parse_input_format(const std::string &name, InputFormat &format)
+{
+    if (name == "u32") {
+        format = INPUT_U32;
+    } else if (name == "high32") {
+        format = INPUT_HIGH32;
+    } else if (name == "low32") {
+        format = INPUT_LOW32;
+    } else if (name == "interleaved32") {
+        format = INPUT_INTERLEAVED32;
+    } else if (name == "reversed32") {
+        format = INPUT_REVERSED32;
+    } else if (name == "double") {
+        format = INPUT_DOUBLE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *testu01_threads::input_format_name(InputFormat format)
+{
+    switch (format) {
+    case INPUT_U32: return "u32";
+    case INPUT_HIGH32: return "high32";
+    case INPUT_LOW32: return "low32";
+    case INPUT_INTERLEAVED32: return "interleaved32";
+    case INPUT_REVERSED32: return "reversed32";
+    case INPUT_DOUBLE: return "double";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Returns the size of one input word, bytes.
+ */
+size_t testu01_threads::input_word_size(InputFormat format)
+{
+    return (format == INPUT_HIGH32 || format == INPUT_LOW32 ||
+        format == INPUT_DOUBLE) ? sizeof(uint64_t) : sizeof(uint32_t);
+}
+
+/**
+ * @brief Takes one half of each 64-bit word: `shift` is 0 for lower halves
+ * and 32 for higher halves. Made in place.
+ */
+static size_t decode_halves(uint32_t *buf, size_t nwords, int shift)
+{
+    const uint64_t *in = reinterpret_cast<const uint64_t *>(buf);
+    size_t i = 0;
+#if defined(__AVX2__)
+    // Two vectors of 64-bit words are packed into one vector of halves;
+    // the output never overtakes the input, so it is safe in place.
+    for (; i + 8 <= nwords; i += 8) {
+        __m256 a = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) (in + i)));
+        __m256 b = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) (in + i + 4)));
+        __m256 h = (shift == 0) ? _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)) :
+            _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256i out = _mm256_permute4x64_epi64(_mm256_castps_si256(h), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *) (buf + i), out);
+    }
+#endif
+    for (; i < nwords; i++) {
+        buf[i] = (uint32_t) (in[i] >> shift);
+    }
+    return nwords;
+}
+
+/**
+ * @brief Reverses bits in each 32-bit word. Made in place.
+ */
+static size_t decode_reversed(uint32_t *buf, size_t nwords)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    // Bytes are reversed by the shuffle, bits in bytes - by the nibble table
+    const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+        11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4,
+        11, 10, 9, 8, 15, 14, 13, 12);
+    const __m256i nibble_rev = _mm256_setr_epi8(0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+        0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF, 0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+        0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF);
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    for (; i + 8 <= nwords; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (buf + i));
+        x = _mm256_shuffle_epi8(x, bswap);
+        __m256i lo = _mm256_shuffle_epi8(nibble_rev, _mm256_and_si256(x, mask));
+        __m256i hi = _mm256_shuffle_epi8(nibble_rev,
+            _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+        x = _mm256_or_si256(_mm256_slli_epi16(lo, 4), hi);
+        _mm256_storeu_si256((__m256i *) (buf + i), x);
+    }
+#endif
+    for (; i < nwords; i++) {
+        uint32_t x = buf[i];
+        x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+        x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+        x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+        x = ((x >> 8) & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+        buf[i] = (x >> 16) | (x << 16);
+    }
+    return nwords;
+}
+
+/**
+ * @brief Converts doubles from [0;1) to upper 32 bits of their fractions.
+ * Values outside [0;1) are converted to 0. Made in place.
+ */
+static size_t decode_doubles(uint32_t *buf, size_t nwords)
+{
+    const double *in = reinterpret_cast<const double *>(buf);
+    for (size_t i = 0; i < nwords; i++) {
+        double x = in[i] * 4294967296.0;
+        buf[i] = (x >= 0.0 && x < 4294967296.0) ? (uint32_t) (int64_t) x : 0;
+    }
+    return nwords;
+}
+
+/**
+ * @brief Converts the block of input words to 32-bit words in place.
+ * @param buf     Buffer with input words.
+ * @param nwords  Number of input words.
+ * @return Number of 32-bit output words.
+ */
+size_t testu01_threads::decode_input_block(InputFormat format, uint32_t *buf, size_t nwords)
+{
+    switch (format) {
+    case INPUT_HIGH32: return decode_halves(buf, nwords, 32);
+    case INPUT_LOW32: return decode_halves(buf, nwords, 0);
+    case INPUT_REVERSED32: return decode_reversed(buf, nwords);
+    case INPUT_DOUBLE: return decode_doubles(buf, nwords);
+    case INPUT_U32:
+    case INPUT_INTERLEAVED32:
+        break;
+    }
+    return nwords;
+}
+
+///////////////////////////////////////////////
+///// FanOutReader class implementation /////
+///////////////////////////////////////////////
+
+/**
+ * @brief Starts the reader thread.
+ * @param fp_         Input stream (e.g. stdin in the binary mode).
+ * @param nblocks     Number of slots for blocks.
+ * @param block_size  Size of one block, bytes (rounded to 64-bit words).
+ * @param format_     Format of input words.
+ */
+FanOutReader::FanOutReader(FILE *fp_, size_t nblocks, size_t block_size,
+    InputFormat format_)
+    : fp(fp_), format(format_), blocks(std::max<size_t>(nblocks, 1)),
+    eof(false), stop(false), nwords(0)
+{
+    size_t block_words = std::max<size_t>(block_size / sizeof(uint64_t), 1) * 2;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].data.resize(block_words);
+        free_slots.push_back(i);
+    }
+    reader = std::thread(&FanOutReader::ReaderFunc, this);
+}
+
+/**
+ * @brief Stops the reader thread. It finishes after the end of
+ * the current `fread` call.
+ */
+FanOutReader::~FanOutReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stop = true;
+    }
+    cv_free.notify_all();
+    reader.join();
+}
+
+/**
+ * @brief Reader thread: fills free slots until the end of the stream.
+ */
+void FanOutReader::ReaderFunc()
+{
+    while (true) {
+        size_t slot;
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            cv_free.wait(lock, [this] { return stop || !free_slots.empty(); });
+            if (stop) {
+                return;
+            }
+            slot = free_slots.front();
+            free_slots.pop_front();
+        }
+        Block &b = blocks[slot];
+        size_t wsize = input_word_size(format);
+        size_t nread = fread(b.data.data(), wsize, b.data.size() * sizeof(uint32_t) / wsize, fp);
+        b.len = decode_input_block(format, b.data.data(), nread);
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            nwords += b.len;
+            if (b.len > 0) {
+                filled_slots.push_back(slot);
+            } else {
+                free_slots.push_back(slot);
+            }
+            eof = (nread < b.data.size() * sizeof(uint32_t) / wsize);
+        }
+        cv_filled.notify_all();
+        if (eof) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Takes the next block in the order of arrival; waits if it is
+ * not read yet.
+ * @param[out] slot  Slot of the block (for `Release`).
+ * @param[out] len   Number of words in the block.
+ * @return Pointer to the block or nullptr if the stream is ended.
+ */
+const uint32_t *FanOutReader::Acquire(size_t &slot, size_t &len)
+{
+    std::unique_lock<std::mutex> lock(mut);
+    cv_filled.wait(lock, [this] { return eof || !filled_slots.empty(); });
+    if (filled_slots.empty()) {
+        return nullptr;
+    }
+    slot = filled_slots.front();
+    filled_slots.pop_front();
+    len = blocks[slot].len;
+    return blocks[slot].data.data();
+}
+
+/**
+ * @brief Returns the block to the reader.
+ */
+void FanOutReader::Release(size_t slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        free_slots.push_back(slot);
+    }
+    cv_free.notify_one();
+}
+
+/**
+ * @brief Returns the number of words read from the stream.
+ */
+uint64_t FanOutReader::GetNWords()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    return nwords;
+}
+
+//////////////////////////////////////////////////
+///// FanOutGenerator class implementation /////
+//////////////////////////////////////////////////
+
+FanOutGenerator::FanOutGenerator(std::shared_ptr<FanOutReader> reader_)
+    : UniformGenerator((reader_->GetFormat() == INPUT_U32) ? std::string("stdin32") :
+        std::string("stdin64 ") + input_format_name(reader_->GetFormat())),
+    reader(reader_), data(nullptr),
+    slot(0), len(0), pos(0)
+{
+}
+
+FanOutGenerator::~FanOutGenerator()
+{
+    if (data != nullptr) {
+        reader->Release(slot);
+    }
+}
+
+/**
+ * @brief Returns the exhausted block and takes the next one. Terminates
+ * the program at the end of the stream.
+ */
+void FanOutGenerator::NextBlock()
+{
+    if (data != nullptr) {
+        reader->Release(slot);
+    }
+    data = reader->Acquire(slot, len);
+    pos = 0;
+    if (data == nullptr) {
+        fprintf(stderr, "=====> The input stream is ended after %llu words: "
+            "the battery cannot be finished\n",
+            (unsigned long long) reader->GetNWords());
+        fflush(stdout);
+        std::_Exit(1);
+    }
+}
+
+/**
+ * @brief Returns two consecutive 32-bit words of the stream
+ * (the first one is the lower half).
+ */
+uint64_t FanOutGenerator::GetBits64()
+{
+    uint64_t lo = GetBits32();
+    return lo | ((uint64_t) GetBits32() << 32);
+}
+
+/**
+ * @brief Copies the words of the stream to the buffer by large blocks.
+ */
+void FanOutGenerator::GetArray32(uint32_t *out, size_t n)
+{
+    while (n > 0) {
+        if (pos == len) {
+            NextBlock();
+        }
+        size_t k = std::min(n, len - pos);
+        memcpy(out, data + pos, k * sizeof(uint32_t));
+        out += k;
+        n -= k;
+        pos += k;
+    }
+}
@@ -0,0 +1,401 @@
+#include "testu01th/file_dump.h"
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace testu01_threads;
+
+///////////////////////////////////////////
+///// FileDump class implementation /////
+///////////////////////////////////////////
+
+FileDump::FileDump(GenFactoryFunc create_gen_, StreamFormat format_,
+    const std::string &filename_)
+    : create_gen(create_gen_), format(format_), filename(filename_),
+    size_log2(30), nthreads(1), buffer_size(16 * 1048576), native_size(0), seed(0),
+    jumpable(false), direct(true), checkpoint_interval(60.0), fd(-1),
+    failed(false), nfinished(0)
+{
+}
+
+/**
+ * @brief Sets the size of one block; it is rounded up to the size
+ * of the memory page (required by `O_DIRECT`).
+ */
+void FileDump::SetBufferSize(size_t bytes)
+{
+    if (bytes < PAGE_SIZE) {
+        bytes = PAGE_SIZE;
+    }
+    buffer_size = (bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+}
+
+/**
+ * @brief Splits the file into `nthreads` regions. Boundaries of regions
+ * are aligned to the memory page, the last region may be shorter.
+ */
+void FileDump::SplitRegions()
+{
+    uint64_t total = 1ull << size_log2;
+    uint64_t len = (total / nthreads + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    begin.clear();
+    end.clear();
+    for (uint64_t pos = 0; pos < total; pos += len) {
+        begin.push_back(pos);
+        end.push_back(std::min(pos + len, total));
+    }
+    done.reset(new std::atomic<uint64_t>[begin.size()]);
+    for (size_t i = 0; i < begin.size(); i++) {
+        done[i] = 0;
+    }
+}
+
+/**
+ * @brief Opens the output file and sets its size. `O_DIRECT` is used
+ * if it is enabled and supported by the file system.
+ */
+bool FileDump::OpenFile(bool resume)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    int flags = _O_WRONLY | _O_CREAT | _O_BINARY | (resume ? 0 : _O_TRUNC);
+    fd = _open(filename.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+    int flags = O_WRONLY | O_CREAT | (resume ? 0 : O_TRUNC);
+    fd = -1;
+#if defined(O_DIRECT)
+    if (direct) {
+        fd = open(filename.c_str(), flags | O_DIRECT, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "O_DIRECT is not supported, buffered output will be used\n");
+        }
+    }
+#endif
+    if (fd < 0) {
+        fd = open(filename.c_str(), flags, 0644);
+    }
+#endif
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open the file %s: %s\n", filename.c_str(), strerror(errno));
+        return false;
+    }
+    // The file is resized in advance: regions are written in parallel
+#if defined(_WIN32) || defined(_WIN64)
+    int ans = _chsize_s(fd, (__int64) (1ull << size_log2));
+#else
+    int ans = ftruncate(fd, (off_t) (1ull << size_log2));
+#endif
+    if (ans != 0) {
+        fprintf(stderr, "Cannot resize the file %s\n", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Creates the generator for the region and moves it to the current
+ * position of the region (if jumps are supported). The byte offset is
+ * converted to the number of output words that are native outputs of the
+ * generator (see `Run`), i.e. the units of jumps. Otherwise each region
+ * has an independent generator: skipping of already written outputs
+ * is made by `RegionFunc`.
+ */
+std::shared_ptr<UniformGenerator> FileDump::CreateGenerator(size_t region)
+{
+    if (!jumpable) {
+        Entropy::SetThreadSeed(Entropy::DeriveSeed(seed, region, 0));
+        auto gen = create_gen();
+        Entropy::ResetThreadSeed();
+        return gen;
+    }
+    Entropy::SetThreadSeed(seed);
+    auto gen = create_gen();
+    Entropy::ResetThreadSeed();
+    gen->SetStream((begin[region] + done[region]) / stream_word_size(format), 0);
+    return gen;
+}
+
+/**
+ * @brief Writes the whole buffer to the given position of the file.
+ * @return false in the case of error (e.g. the disk is full).
+ */
+bool FileDump::WriteAt(const uint8_t *buf, size_t len, uint64_t offset)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    // There is no pwrite: seek and write are made under the lock
+    std::lock_guard<std::mutex> lock(mut);
+    if (_lseeki64(fd, (__int64) offset, SEEK_SET) < 0) {
+        return false;
+    }
+#endif
+    while (len > 0) {
+#if defined(_WIN32) || defined(_WIN64)
+        unsigned int chunk = (len > 0x40000000) ? 0x40000000 : (unsigned int) len;
+        int n = _write(fd, buf, chunk);
+#else
+        ssize_t n = pwrite(fd, buf, len, (off_t) offset);
+#endif
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= (size_t) n;
+        offset += (uint64_t) n;
+    }
+    return true;
+}
+
+/**
+ * @brief Flushes the written data to the disk.
+ */
+bool FileDump::Sync()
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return _commit(fd) == 0;
+#elif defined(__APPLE__)
+    return fsync(fd) == 0;
+#else
+    return fdatasync(fd) == 0;
+#endif
+}
+
+/**
+ * @brief Generator thread: fills the region by blocks from its current
+ * position to its end.
+ */
+void FileDump::RegionFunc(std::shared_ptr<UniformGenerator> gen, size_t region)
+{
+    std::vector<uint8_t> storage(buffer_size + PAGE_SIZE + sizeof(uint64_t));
+    uintptr_t addr = reinterpret_cast<uintptr_t>(storage.data());
+    addr = (addr + PAGE_SIZE - 1) & ~((uintptr_t) PAGE_SIZE - 1);
+    uint8_t *buf = reinterpret_cast<uint8_t *>(addr);
+    uint64_t pos = begin[region] + done[region];
+    if (!jumpable) {
+        // Regeneration of outputs written before the checkpoint
+        for (uint64_t skip = done[region]; skip > 0 && !failed; ) {
+            size_t len = (size_t) std::min<uint64_t>(skip, buffer_size);
+            fill_stream_buffer(*gen, format, buf, len);
+            skip -= len;
+        }
+    }
+    while (pos < end[region] && !failed) {
+        size_t len = (size_t) std::min<uint64_t>(buffer_size, end[region] - pos);
+        fill_stream_buffer(*gen, format, buf, len);
+        if (!WriteAt(buf, len, pos)) {
+            fprintf(stderr, "Cannot write to the file %s: %s\n",
+                filename.c_str(), strerror(errno));
+            failed = true;
+            break;
+        }
+        pos += len;
+        done[region].store(pos - begin[region], std::memory_order_release);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        nfinished++;
+    }
+    cv.notify_all();
+}
+
+/**
+ * @brief Saves the progress of regions to the checkpoint file. The data
+ * is flushed to the disk before saving, so the checkpoint never refers
+ * to the data that may be lost. The file is replaced atomically.
+ */
+bool FileDump::SaveCheckpoint()
+{
+    std::vector<uint64_t> snapshot(begin.size());
+    for (size_t i = 0; i < begin.size(); i++) {
+        snapshot[i] = done[i].load(std::memory_order_acquire);
+    }
+    if (!Sync()) {
+        fprintf(stderr, "Cannot flush the file %s\n", filename.c_str());
+        return false;
+    }
+    std::string ckpt_name = GetCheckpointName(), tmp_name = ckpt_name + ".tmp";
+    std::ofstream outfile(tmp_name, std::ios::out | std::ios::trunc);
+    if (!outfile.is_open()) {
+        return false;
+    }
+    char buf[128];
+    snprintf(buf, 128, "0x%16.16llX", (unsigned long long) seed);
+    outfile << "testu01th_dump_checkpoint 1" << std::endl;
+    outfile << "generator " << gen_name << std::endl;
+    outfile << "word_bits " << 8 * stream_word_size(format) << std::endl;
+    outfile << "size_log2 " << size_log2 << std::endl;
+    outfile << "seed " << buf << std::endl;
+    outfile << "jumpable " << (jumpable ? 1 : 0) << std::endl;
+    outfile << "regions " << begin.size() << std::endl;
+    for (size_t i = 0; i < begin.size(); i++) {
+        outfile << "region " << i << " " << begin[i] << " " << end[i]
+            << " " << snapshot[i] << std::endl;
+    }
+    outfile.close();
+    if (outfile.fail()) {
+        return false;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    std::remove(ckpt_name.c_str());
+#endif
+    return std::rename(tmp_name.c_str(), ckpt_name.c_str()) == 0;
+}
+
+/**
+ * @brief Loads the checkpoint: seed and regions are taken from it. The
+ * generator, output format and size must be the same as in the checkpoint.
+ */
+bool FileDump::LoadCheckpoint()
+{
+    std::ifstream infile(GetCheckpointName());
+    if (!infile.is_open()) {
+        fprintf(stderr, "Cannot open the checkpoint %s\n", GetCheckpointName().c_str());
+        return false;
+    }
+    std::string line, name;
+    unsigned int word_bits = 0, log2 = 0, jmp = 0;
+    size_t nregions = 0;
+    unsigned long long ckpt_seed = 0;
+    std::vector<uint64_t> ckpt_done;
+    begin.clear();
+    end.clear();
+    while (std::getline(infile, line)) {
+        unsigned long long b, e, d;
+        size_t ind;
+        if (line.compare(0, 10, "generator ") == 0) {
+            name = line.substr(10);
+        } else if (sscanf(line.c_str(), "word_bits %u", &word_bits) == 1 ||
+            sscanf(line.c_str(), "size_log2 %u", &log2) == 1 ||
+            sscanf(line.c_str(), "seed %llx", &ckpt_seed) == 1 ||
+            sscanf(line.c_str(), "jumpable %u", &jmp) == 1 ||
+            sscanf(line.c_str(), "regions %zu", &nregions) == 1) {
+            continue;
+        } else if (sscanf(line.c_str(), "region %zu %llu %llu %llu", &ind, &b, &e, &d) == 4) {
+            if (ind != begin.size() || b > e || d > e - b || d % PAGE_SIZE != 0) {
+                fprintf(stderr, "Invalid region %d in the checkpoint\n", (int) ind);
+                return false;
+            }
+            begin.push_back(b);
+            end.push_back(e);
+            ckpt_done.push_back(d);
+        }
+    }
+    if (name != gen_name || word_bits != 8 * stream_word_size(format) ||
+        log2 != size_log2 || (jmp != 0) != jumpable ||
+        nregions == 0 || nregions != begin.size()) {
+        fprintf(stderr, "The checkpoint doesn't match the generator or the dump settings\n");
+        return false;
+    }
+    seed = ckpt_seed;
+    done.reset(new std::atomic<uint64_t>[nregions]);
+    for (size_t i = 0; i < nregions; i++) {
+        done[i] = ckpt_done[i];
+    }
+    return true;
+}
+
+/**
+ * @brief Runs generator threads and writes the file. Prints the progress
+ * and the achieved speed to stderr.
+ * @param resume  Continue the dump from the checkpoint: the seed and the
+ * number of regions are taken from it.
+ * @return true if the whole file was written.
+ */
+bool FileDump::Run(bool resume)
+{
+    if (size_log2 < 12 || size_log2 > 62) {
+        fprintf(stderr, "File size must be from 2^12 to 2^62 bytes\n");
+        return false;
+    }
+    // The probe generator is used only to detect support of jumps
+    {
+        Entropy::SetThreadSeed(seed);
+        auto probe = create_gen();
+        Entropy::ResetThreadSeed();
+        jumpable = probe->Jump(0);
+        gen_name = probe->GetName();
+    }
+    if (jumpable && native_size != stream_word_size(format)) {
+        // E.g. 32-bit words of the 64-bit generator: the position in the
+        // file cannot be converted to the number of native outputs
+        fprintf(stderr, "=====> Output words are not native outputs of the generator: "
+            "jumps are not used\n");
+        jumpable = false;
+    }
+    if (resume) {
+        if (!LoadCheckpoint()) {
+            return false;
+        }
+    } else {
+        SplitRegions();
+    }
+    if (!OpenFile(resume)) {
+        return false;
+    }
+    uint64_t total = 1ull << size_log2, nbytes_start = 0;
+    for (size_t i = 0; i < begin.size(); i++) {
+        nbytes_start += done[i];
+    }
+    fprintf(stderr, "=====> Dump to %s: 2^%u bytes, %d regions, %s%s\n",
+        filename.c_str(), size_log2, (int) begin.size(),
+        jumpable ? "one contiguous sequence" : "independent sequences",
+        resume ? " (resumed)" : "");
+    failed = false;
+    nfinished = 0;
+    std::vector<std::shared_ptr<UniformGenerator>> gens;
+    for (size_t i = 0; i < begin.size(); i++) {
+        gens.push_back(CreateGenerator(i));
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < begin.size(); i++) {
+        threads.emplace_back(&FileDump::RegionFunc, this, gens[i], i);
+    }
+    auto tic = std::chrono::steady_clock::now();
+    auto interval = std::chrono::duration<double>(checkpoint_interval);
+    bool is_finished = false;
+    while (!is_finished) {
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            is_finished = cv.wait_for(lock, interval,
+                [this] { return nfinished == begin.size(); });
+        }
+        if (!SaveCheckpoint()) {
+            fprintf(stderr, "Cannot save the checkpoint %s\n", GetCheckpointName().c_str());
+        }
+        uint64_t nbytes = 0;
+        for (size_t i = 0; i < begin.size(); i++) {
+            nbytes += done[i];
+        }
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - tic).count();
+        fprintf(stderr, "=====> %.3f of %.3f GiB written (%.3f GB/s)\n",
+            nbytes / 1073741824.0, total / 1073741824.0,
+            (sec > 0.0) ? (nbytes - nbytes_start) / sec * 1.0e-9 : 0.0);
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    _close(fd);
+#else
+    close(fd);
+#endif
+    fd = -1;
+    if (failed) {
+        fprintf(stderr, "Dump is interrupted, it may be resumed by the --resume option\n");
+        return false;
+    }
+    std::remove(GetCheckpointName().c_str());
+    return true;
+}
@@ -0,0 +1,192 @@
+#include "testu01th/mapped_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace testu01_threads;
+
+/////////////////////////////////////////////
+///// MappedFile class implementation /////
+/////////////////////////////////////////////
+
+/**
+ * @brief Maps the whole file to memory (read only). If the file cannot
+ * be mapped the error is printed and `IsOpen` returns false.
+ */
+MappedFile::MappedFile(const std::string &filename_)
+    : filename(filename_), data(nullptr), size(0), nwraps(0)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    file_handle = nullptr;
+    map_handle = nullptr;
+    HANDLE fh = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    LARGE_INTEGER fsize;
+    if (fh == INVALID_HANDLE_VALUE || !GetFileSizeEx(fh, &fsize) || fsize.QuadPart == 0) {
+        fprintf(stderr, "Cannot open the file %s\n", filename.c_str());
+        if (fh != INVALID_HANDLE_VALUE) {
+            CloseHandle(fh);
+        }
+        return;
+    }
+    HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *addr = (mh != NULL) ? MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (addr == NULL) {
+        fprintf(stderr, "Cannot map the file %s to memory\n", filename.c_str());
+        if (mh != NULL) {
+            CloseHandle(mh);
+        }
+        CloseHandle(fh);
+        return;
+    }
+    file_handle = fh;
+    map_handle = mh;
+    size = (uint64_t) fsize.QuadPart;
+    data = static_cast<const uint8_t *>(addr);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "Cannot open the file %s: %s\n", filename.c_str(),
+            (fd < 0) ? strerror(errno) : "empty file");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    void *addr = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the reference to the file
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "Cannot map the file %s to memory: %s\n",
+            filename.c_str(), strerror(errno));
+        return;
+    }
+    size = (uint64_t) st.st_size;
+    data = static_cast<const uint8_t *>(addr);
+    // Advices are not critical: errors are ignored
+    madvise(addr, (size_t) size, MADV_SEQUENTIAL);
+#if defined(MADV_HUGEPAGE)
+    madvise(addr, (size_t) size, MADV_HUGEPAGE);
+#endif
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    if (data == nullptr) {
+        return;
+    }
+    if (nwraps > 0) {
+        fprintf(stderr, "=====> File %s was read %llu times beyond its end: "
+            "some data were reused\n", filename.c_str(),
+            (unsigned long long) nwraps.load());
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    UnmapViewOfFile(data);
+    CloseHandle(static_cast<HANDLE>(map_handle));
+    CloseHandle(static_cast<HANDLE>(file_handle));
+#else
+    munmap(const_cast<uint8_t *>(data), (size_t) size);
+#endif
+}
+
+//////////////////////////////////////////////////////
+///// MappedFileGenerator class implementation /////
+//////////////////////////////////////////////////////
+
+MappedFileGenerator::MappedFileGenerator(std::shared_ptr<MappedFile> file_)
+    : UniformGenerator("file " + file_->GetName()), file(file_),
+    data(reinterpret_cast<const uint32_t *>(file_->GetData())),
+    nwords(file_->GetSize() / sizeof(uint32_t)), pos(0),
+    region_begin(0), region_len(0), region_left(UINT64_MAX), noverruns(0)
+{
+}
+
+/**
+ * @brief Called at the end of the region: moves the position to the
+ * beginning of the region, so the data of other tests are not touched.
+ */
+void MappedFileGenerator::RestartRegion()
+{
+    if (region_len == 0) {
+        region_left = UINT64_MAX;
+        return;
+    }
+    pos = region_begin;
+    region_left = region_len;
+    noverruns++;
+}
+
+/**
+ * @brief Returns two consecutive 32-bit words of the file
+ * (the first one is the lower half).
+ */
+uint64_t MappedFileGenerator::GetBits64()
+{
+    uint64_t lo = GetBits32();
+    return lo | ((uint64_t) GetBits32() << 32);
+}
+
+/**
+ * @brief Copies the words of the file to the buffer by large blocks.
+ */
+void MappedFileGenerator::GetArray32(uint32_t *out, size_t len)
+{
+    while (len > 0) {
+        if (region_left == 0) {
+            RestartRegion();
+        }
+        if (pos == nwords) {
+            pos = 0;
+            file->AddWrap();
+        }
+        size_t n = (size_t) std::min<uint64_t>(len,
+            std::min(nwords - pos, region_left));
+        memcpy(out, data + pos, n * sizeof(uint32_t));
+        out += n;
+        len -= n;
+        pos += n;
+        region_left -= n;
+    }
+}
+
+/**
+ * @brief Moves the position by 2^log2_distance words (modulo the
+ * file length). The region (if any) is cancelled.
+ */
+bool MappedFileGenerator::Jump(unsigned int log2_distance)
+{
+    region_len = 0;
+    region_left = UINT64_MAX;
+    // 2^log2_distance mod nwords by repeated doubling
+    uint64_t step = 1 % nwords;
+    for (unsigned int i = 0; i < log2_distance; i++) {
+        step = (step >= nwords - step) ? step - (nwords - step) : 2 * step;
+    }
+    pos = (pos >= nwords - step) ? pos - (nwords - step) : pos + step;
+    return true;
+}
+
+/**
+ * @brief Moves the position to the word `offset` (modulo the file length)
+ * and limits the reading by `len` words (0 - no limit).
+ */
+bool MappedFileGenerator::SetRegion(uint64_t offset, uint64_t len)
+{
+    pos = offset % nwords;
+    region_begin = pos;
+    region_len = len;
+    region_left = (len > 0) ? len : UINT64_MAX;
+    noverruns = 0;
+    return true;
+}
@@ -39,7 +39,8 @@ PseudoDiehardBattery::PseudoDiehardBattery(GenFactoryFunc genf)
         sres_DeletePoisson(res);
         sres_DeleteChi2(Chi);
     };
-    tests.emplace_back(++j2, "BirthdaySpacings", BirthdaySpacings_func);
+    tests.emplace_back(++j2, "BirthdaySpacings", BirthdaySpacings_func,
+        9.0 * 500 * 512 * (1 + 9)); // 9 x 500 runs with n = 2^9 points
 
     tests.emplace_back(++j2, "MatrixRank",
         smarsa_MatrixRank_cb(1, 40000, 0, 31, 31, 31));
@@ -62,7 +63,7 @@ PseudoDiehardBattery::PseudoDiehardBattery(GenFactoryFunc genf)
         io.Add(td.GetId(), td.GetName(), res->pVal2[0][gofw_AD]);
         smultin_DeleteRes (res);
         smultin_DeleteParam (par);
-    });
+    }, 20.0 * 2097152);
 
     ++j2;
     for (int i = 22; i >= 0; i--) {
@@ -0,0 +1,226 @@
+#include "testu01th/perf_counters.h"
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+using namespace testu01_threads;
+
+const char *testu01_threads::perf_counter_name(PerfCounterType type)
+{
+    switch (type) {
+    case PERF_CYCLES: return "cycles";
+    case PERF_INSTRUCTIONS: return "instructions";
+    case PERF_L1D_MISSES: return "l1d_misses";
+    case PERF_LLC_MISSES: return "llc_misses";
+    case PERF_BRANCH_MISSES: return "branch_misses";
+    case PERF_NCOUNTERS: break;
+    }
+    return "unknown";
+}
+
+///////////////////////////////////////////////////
+///// PerfCounterValues class implementation /////
+///////////////////////////////////////////////////
+
+/**
+ * @brief Returns instructions per cycle or 0 if they are not measured.
+ */
+double PerfCounterValues::GetIPC() const
+{
+    if (!Has(PERF_CYCLES) || !Has(PERF_INSTRUCTIONS) || values[PERF_CYCLES] <= 0.0) {
+        return 0.0;
+    }
+    return values[PERF_INSTRUCTIONS] / values[PERF_CYCLES];
+}
+
+void PerfCounterValues::Scale(double k)
+{
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        values[i] *= k;
+    }
+}
+
+/**
+ * @brief Difference of counters, e.g. for correction for the overhead
+ * of calls. Only counters measured in both objects are kept.
+ */
+PerfCounterValues PerfCounterValues::operator-(const PerfCounterValues &obj) const
+{
+    PerfCounterValues out;
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        PerfCounterType type = static_cast<PerfCounterType>(i);
+        if (Has(type) && obj.Has(type)) {
+            out.Set(type, values[i] - obj.values[i]);
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief Accumulates counters; empty values are ignored.
+ */
+PerfCounterValues &PerfCounterValues::operator+=(const PerfCounterValues &obj)
+{
+    if (IsEmpty()) {
+        *this = obj;
+    } else if (!obj.IsEmpty()) {
+        mask &= obj.mask;
+        for (int i = 0; i < PERF_NCOUNTERS; i++) {
+            values[i] += obj.values[i];
+        }
+    }
+    return *this;
+}
+
+/**
+ * @brief Returns the counters as "name=value" pairs and IPC.
+ */
+std::string PerfCounterValues::ToString() const
+{
+    std::string out;
+    char buf[64];
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        PerfCounterType type = static_cast<PerfCounterType>(i);
+        if (Has(type)) {
+            snprintf(buf, 64, "%s%s=%.4g", out.empty() ? "" : ", ",
+                perf_counter_name(type), values[i]);
+            out += buf;
+        }
+    }
+    if (Has(PERF_CYCLES) && Has(PERF_INSTRUCTIONS)) {
+        snprintf(buf, 64, ", IPC=%.3f", GetIPC());
+        out += buf;
+    }
+    return out;
+}
+
+//////////////////////////////////////////////
+///// PerfCounters class implementation /////
+//////////////////////////////////////////////
+
+#if defined(__linux__)
+/**
+ * @brief Opens one event of the calling thread (user space only).
+ */
+static int open_perf_event(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+/**
+ * @brief Opens counters for the calling thread. Events that are not
+ * supported by CPU are skipped; if there are no events then counters
+ * are disabled.
+ */
+PerfCounters::PerfCounters() : nopened(0)
+{
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        fds[i] = -1;
+    }
+#if defined(__linux__)
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[PERF_NCOUNTERS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+    };
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        fds[i] = open_perf_event(events[i].type, events[i].config);
+        if (fds[i] >= 0) {
+            nopened++;
+        }
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Resets and starts all counters.
+ */
+void PerfCounters::Start()
+{
+#if defined(__linux__)
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        if (fds[i] >= 0) {
+            ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Stops counters and returns their values. Values of multiplexed
+ * counters are extrapolated to the whole measurement time. Counters
+ * that were never scheduled are absent.
+ */
+PerfCounterValues PerfCounters::Stop()
+{
+    PerfCounterValues out;
+#if defined(__linux__)
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        if (fds[i] >= 0) {
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        // value, time_enabled, time_running
+        uint64_t buf[3];
+        if (fds[i] < 0 || read(fds[i], buf, sizeof(buf)) != (ssize_t) sizeof(buf) ||
+            buf[2] == 0) {
+            continue;
+        }
+        out.Set(static_cast<PerfCounterType>(i), buf[0] * ((double) buf[1] / buf[2]));
+    }
+#endif
+    return out;
+}
+
+/**
+ * @brief Checks once if hardware counters may be used by this process.
+ * Prints the message if they are not available.
+ */
+bool PerfCounters::IsAvailable()
+{
+    static const bool available = [] () {
+        PerfCounters pc;
+        if (!pc.IsEnabled()) {
+            fprintf(stderr, "=====> Hardware performance counters are not available "
+                "(not Linux or perf events are not permitted; see "
+                "/proc/sys/kernel/perf_event_paranoid)\n");
+        }
+        return pc.IsEnabled();
+    }();
+    return available;
+}
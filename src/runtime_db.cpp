@@ -0,0 +1,343 @@
+#include "testu01th/runtime_db.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <cerrno>
+#include <time.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#endif
+
+using namespace testu01_threads;
+
+/**
+ * @brief Exclusive lock of the history file between processes: it is
+ * held while the file is re-read, merged and replaced. The lock is taken
+ * on the separate `<file>.lock` file because the history file itself is
+ * replaced by `rename`. The lock file is never removed: removing it would
+ * allow two processes to lock different files with the same name.
+ */
+class HistoryFileLock
+{
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE h;
+#else
+    int fd;
+#endif
+    bool locked;
+    HistoryFileLock(const HistoryFileLock &obj) = delete;
+    HistoryFileLock &operator=(const HistoryFileLock &obj) = delete;
+
+public:
+    HistoryFileLock(const std::string &filename) : locked(false)
+    {
+        std::string lock_name = filename + ".lock";
+#if defined(_WIN32) || defined(_WIN64)
+        h = CreateFileA(lock_name.c_str(), GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h != INVALID_HANDLE_VALUE) {
+            OVERLAPPED ov = {};
+            locked = LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov) != 0;
+        }
+#else
+        fd = open(lock_name.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd != -1) {
+            int ret;
+            while ((ret = flock(fd, LOCK_EX)) != 0 && errno == EINTR) {}
+            locked = (ret == 0);
+        }
+#endif
+    }
+
+    bool IsLocked() const { return locked; }
+
+    ~HistoryFileLock()
+    {
+#if defined(_WIN32) || defined(_WIN64)
+        if (h != INVALID_HANDLE_VALUE) {
+            if (locked) {
+                OVERLAPPED ov = {};
+                UnlockFileEx(h, 0, 1, 0, &ov);
+            }
+            CloseHandle(h);
+        }
+#else
+        if (fd != -1) {
+            close(fd); // Also releases the lock
+        }
+#endif
+    }
+};
+
+RuntimeHistory::RuntimeHistory(const std::string &filename_)
+: filename(filename_), host(GetHostName())
+{
+}
+
+/**
+ * @brief Returns the name of the current host. It is a part of the key
+ * because running times depend on hardware.
+ */
+std::string RuntimeHistory::GetHostName()
+{
+#if defined(_WIN32) || defined(_WIN64)
+    char buf[MAX_COMPUTERNAME_LENGTH + 1];
+    DWORD len = MAX_COMPUTERNAME_LENGTH + 1;
+    if (!GetComputerNameA(buf, &len)) {
+        return "unknown";
+    }
+    return std::string(buf, len);
+#else
+    char buf[256];
+    if (gethostname(buf, sizeof(buf)) != 0) {
+        return "unknown";
+    }
+    buf[sizeof(buf) - 1] = '\0';
+    return std::string(buf);
+#endif
+}
+
+/**
+ * @brief Returns CPU time consumed by the calling thread, seconds.
+ */
+double RuntimeHistory::GetThreadCpuTime()
+{
+#if defined(_WIN32) || defined(_WIN64)
+    FILETIME t_create, t_exit, t_kernel, t_user;
+    if (!GetThreadTimes(GetCurrentThread(), &t_create, &t_exit, &t_kernel, &t_user)) {
+        return 0.0;
+    }
+    ULARGE_INTEGER k, u;
+    k.LowPart = t_kernel.dwLowDateTime; k.HighPart = t_kernel.dwHighDateTime;
+    u.LowPart = t_user.dwLowDateTime; u.HighPart = t_user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) * 1.0e-7; // 100 ns units
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0.0;
+    }
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+#endif
+}
+
+
+std::string RuntimeHistory::MakeKey(const std::string &battery, int test_no,
+    const std::string &gen_name, const std::string &host_name) const
+{
+    return battery + "\t" + std::to_string(test_no) + "\t" +
+        gen_name + "\t" + host_name;
+}
+
+/**
+ * @brief Reads records from the file to the given map.
+ * @return true if the file was read, false otherwise.
+ */
+bool RuntimeHistory::ReadFile(std::map<std::string, RuntimeRecord> &out) const
+{
+    std::ifstream infile(filename);
+    if (!infile.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::vector<std::string> cols;
+        std::stringstream ss(line);
+        std::string col;
+        while (std::getline(ss, col, '\t')) {
+            cols.push_back(col);
+        }
+        if (cols.size() != 7 && cols.size() != 8 + PERF_NCOUNTERS) {
+            continue;
+        }
+        RuntimeRecord rec;
+        try {
+            rec.wall_sec = std::stod(cols[4]);
+            rec.cpu_sec = std::stod(cols[5]);
+            rec.nruns = std::stoul(cols[6]);
+            if (cols.size() > 7) {
+                for (int i = 0; i < PERF_NCOUNTERS; i++) {
+                    if (cols[7 + i] != "-") {
+                        rec.perf.Set(static_cast<PerfCounterType>(i), std::stod(cols[7 + i]));
+                    }
+                }
+                rec.nperf = std::stoul(cols[7 + PERF_NCOUNTERS]);
+            }
+            std::string key = MakeKey(cols[0], std::stoi(cols[1]), cols[2], cols[3]);
+            out[key] = rec;
+        } catch (const std::exception &) {
+            continue; // Corrupted line
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Adds measurements from `src` to `dst`: means are weighted
+ * by the numbers of runs.
+ */
+void RuntimeHistory::AddRecord(RuntimeRecord &dst, const RuntimeRecord &src)
+{
+    size_t nruns = dst.nruns + src.nruns;
+    if (nruns == 0) {
+        return;
+    }
+    dst.wall_sec = (dst.wall_sec * dst.nruns + src.wall_sec * src.nruns) / nruns;
+    dst.cpu_sec = (dst.cpu_sec * dst.nruns + src.cpu_sec * src.nruns) / nruns;
+    dst.nruns = nruns;
+    size_t nperf = dst.nperf + src.nperf;
+    if (src.nperf > 0) {
+        PerfCounterValues perf = src.perf;
+        perf.Scale((double) src.nperf / nperf);
+        dst.perf.Scale((double) dst.nperf / nperf);
+        dst.perf += perf;
+        dst.nperf = nperf;
+    }
+}
+
+/**
+ * @brief Loads the database from the file. A missing file is not
+ * an error: it means that the history is empty.
+ * @return true if the file was read, false otherwise.
+ */
+bool RuntimeHistory::Load()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    return ReadFile(records);
+}
+
+/**
+ * @brief Saves the database to the file (records for all hosts
+ * and generators). The file is re-read before saving: records written
+ * by other runs are kept and measurements of this run are added to them.
+ * The file is replaced atomically, so readers never see a partial file.
+ * Concurrent runs are serialized by the exclusive lock of `<file>.lock`:
+ * otherwise two runs could read the same file and one of them would
+ * overwrite the updates of the other one.
+ */
+bool RuntimeHistory::Save()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    HistoryFileLock file_lock(filename);
+    if (!file_lock.IsLocked()) {
+        return false;
+    }
+    std::map<std::string, RuntimeRecord> merged;
+    if (ReadFile(merged)) {
+        for (auto &u : updates) {
+            AddRecord(merged[u.first], u.second);
+        }
+    } else {
+        merged = records;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    int pid = _getpid();
+#else
+    int pid = (int) getpid();
+#endif
+    std::string tmp_name = filename + ".tmp" + std::to_string(pid);
+    std::ofstream outfile(tmp_name, std::ios::out | std::ios::trunc);
+    if (!outfile.is_open()) {
+        return false;
+    }
+    outfile << "# battery\ttest_no\tgenerator\thost\twall_sec\tcpu_sec\tnruns";
+    for (int i = 0; i < PERF_NCOUNTERS; i++) {
+        outfile << "\t" << perf_counter_name(static_cast<PerfCounterType>(i));
+    }
+    outfile << "\tnperf\n";
+    for (auto &r : merged) {
+        char buf[128];
+        snprintf(buf, 128, "\t%.6g\t%.6g\t%lu", r.second.wall_sec,
+            r.second.cpu_sec, (unsigned long) r.second.nruns);
+        outfile << r.first << buf;
+        for (int i = 0; i < PERF_NCOUNTERS; i++) {
+            PerfCounterType type = static_cast<PerfCounterType>(i);
+            if (r.second.perf.Has(type)) {
+                snprintf(buf, 128, "\t%.6g", r.second.perf.Get(type));
+            } else {
+                snprintf(buf, 128, "\t-");
+            }
+            outfile << buf;
+        }
+        outfile << "\t" << r.second.nperf << "\n";
+    }
+    outfile.close();
+    if (outfile.fail()) {
+        std::remove(tmp_name.c_str());
+        return false;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    std::remove(filename.c_str());
+#endif
+    if (std::rename(tmp_name.c_str(), filename.c_str()) != 0) {
+        std::remove(tmp_name.c_str());
+        return false;
+    }
+    records = merged;
+    updates.clear();
+    return true;
+}
+
+/**
+ * @brief Finds the averaged running time of the test on the current host.
+ * @param test_no  1-based position of the test in the battery.
+ * @return true if the record was found, false otherwise.
+ */
+bool RuntimeHistory::Find(const std::string &battery, int test_no,
+    const std::string &gen_name, RuntimeRecord &rec) const
+{
+    std::lock_guard<std::mutex> lock(mut);
+    auto it = records.find(MakeKey(battery, test_no, gen_name, host));
+    if (it == records.end()) {
+        return false;
+    }
+    rec = it->second;
+    return true;
+}
+
+/**
+ * @brief Adds the measured running time of the test on the current host
+ * to the database. The stored value is the mean of all measurements.
+ * Hardware counters (if measured) are averaged in the same way; only
+ * counters measured in all runs are kept.
+ */
+void RuntimeHistory::Update(const std::string &battery, int test_no,
+    const std::string &gen_name, double wall_sec, double cpu_sec,
+    const PerfCounterValues &perf)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    std::string key = MakeKey(battery, test_no, gen_name, host);
+    RuntimeRecord meas;
+    meas.wall_sec = wall_sec;
+    meas.cpu_sec = cpu_sec;
+    meas.nruns = 1;
+    if (!perf.IsEmpty()) {
+        meas.perf = perf;
+        meas.nperf = 1;
+    }
+    AddRecord(updates[key], meas);
+    RuntimeRecord &rec = records[key];
+    rec.nruns++;
+    rec.wall_sec += (wall_sec - rec.wall_sec) / rec.nruns;
+    rec.cpu_sec += (cpu_sec - rec.cpu_sec) / rec.nruns;
+    if (!perf.IsEmpty()) {
+        rec.nperf++;
+        if (rec.nperf == 1) {
+            rec.perf = perf;
+        } else {
+            PerfCounterValues delta = perf - rec.perf;
+            delta.Scale(1.0 / rec.nperf);
+            rec.perf += delta;
+        }
+    }
+}
@@ -17,7 +17,7 @@ SmallCrushBattery::SmallCrushBattery(GenFactoryFunc genf)
         sknuth_Collision(io.Gen(), res3, 1, 5 * MILLION, 0, 65536, 2);
         io.Add(td.GetId(), td.GetName(), res3->Pois->pVal2);
         sknuth_DeleteRes2(res3);
-    });
+    }, 2.0 * 5 * MILLION);
 
     tests.emplace_back(++j2, "Gap", // 3
         sknuth_Gap_cb(1, MILLION / 5, 22, 0.0, .00390625));
@@ -36,7 +36,7 @@ SmallCrushBattery::SmallCrushBattery(GenFactoryFunc genf)
         svaria_WeightDistrib (io.Gen(), res2, 1, MILLION / 5, 27, 256, 0.0, 0.125);
         io.Add(td.GetId(), td.GetName(), res2->pVal2[gofw_Mean]);
         sres_DeleteChi2(res2);
-    });
+    }, 256.0 * MILLION / 5);
 
     tests.emplace_back(++j2, "MatrixRank", // 9
         smarsa_MatrixRank_cb(1, 20 * THOUSAND, 20, 10, 60, 60));
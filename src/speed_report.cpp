@@ -0,0 +1,303 @@
+#include "testu01th/speed_report.h"
+#include "testu01th/runtime_db.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace testu01_threads;
+
+/**
+ * @brief Returns the key used for matching of records with the baseline.
+ */
+std::string SpeedRecord::GetKey() const
+{
+    return module + "\t" + generator + "\t" + interface + "\t" + std::to_string(nthreads);
+}
+
+/**
+ * @brief Returns the string as the JSON string literal.
+ */
+static std::string json_string(const std::string &txt)
+{
+    std::string out = "\"";
+    for (char c : txt) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char) c < 0x20) {
+            char buf[8];
+            snprintf(buf, 8, "\\u%04x", (unsigned int) c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+/**
+ * @brief Returns the string as the quoted CSV field.
+ */
+static std::string csv_string(const std::string &txt)
+{
+    std::string out = "\"";
+    for (char c : txt) {
+        out += (c == '"') ? "\"\"" : std::string(1, c);
+    }
+    return out + "\"";
+}
+
+/**
+ * @brief Returns the number with enough digits for comparisons.
+ */
+static std::string json_number(double x)
+{
+    char buf[32];
+    snprintf(buf, 32, "%.6g", x);
+    return buf;
+}
+
+/**
+ * @brief Saves the records to the JSON file: the object with the host
+ * name and the "records" array.
+ * @return true on success, false otherwise.
+ */
+bool testu01_threads::save_speed_json(const std::string &filename,
+    const std::vector<SpeedRecord> &records)
+{
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cerr << "Cannot open the file " << filename << std::endl;
+        return false;
+    }
+    out << "{\n";
+    out << "  \"host\": " << json_string(RuntimeHistory::GetHostName()) << ",\n";
+#if defined(__VERSION__)
+    out << "  \"compiler\": " << json_string(__VERSION__) << ",\n";
+#endif
+    out << "  \"records\": [";
+    for (size_t i = 0; i < records.size(); i++) {
+        const SpeedRecord &r = records[i];
+        out << ((i == 0) ? "\n" : ",\n");
+        out << "    {\"module\": " << json_string(r.module)
+            << ", \"generator\": " << json_string(r.generator)
+            << ", \"interface\": " << json_string(r.interface)
+            << ", \"threads\": " << r.nthreads
+            << ", \"ns_per_call\": " << json_number(r.ns_per_call)
+            << ", \"ns_mad\": " << json_number(r.ns_mad)
+            << ", \"ns_ci_low\": " << json_number(r.ns_ci_low)
+            << ", \"ns_ci_high\": " << json_number(r.ns_ci_high)
+            << ", \"cpb\": " << json_number(r.cpb)
+            << ", \"gb_per_sec\": " << json_number(r.gb_per_sec);
+        for (int j = 0; j < PERF_NCOUNTERS; j++) {
+            PerfCounterType type = static_cast<PerfCounterType>(j);
+            if (r.perf.Has(type)) {
+                out << ", \"" << perf_counter_name(type) << "_per_call\": "
+                    << json_number(r.perf.Get(type));
+            }
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+    return out.good();
+}
+
+/**
+ * @brief Saves the records to the CSV file with the header line.
+ * @return true on success, false otherwise.
+ */
+bool testu01_threads::save_speed_csv(const std::string &filename,
+    const std::vector<SpeedRecord> &records)
+{
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cerr << "Cannot open the file " << filename << std::endl;
+        return false;
+    }
+    out << "module,generator,interface,threads,ns_per_call,ns_mad,ns_ci_low,"
+        "ns_ci_high,cpb,gb_per_sec";
+    for (int j = 0; j < PERF_NCOUNTERS; j++) {
+        out << "," << perf_counter_name(static_cast<PerfCounterType>(j)) << "_per_call";
+    }
+    out << "\n";
+    for (auto &r : records) {
+        out << csv_string(r.module) << "," << csv_string(r.generator) << ","
+            << r.interface << ","
+            << r.nthreads << "," << json_number(r.ns_per_call) << ","
+            << json_number(r.ns_mad) << "," << json_number(r.ns_ci_low) << ","
+            << json_number(r.ns_ci_high) << "," << json_number(r.cpb) << ","
+            << json_number(r.gb_per_sec);
+        // Counters that were not measured are empty fields
+        for (int j = 0; j < PERF_NCOUNTERS; j++) {
+            PerfCounterType type = static_cast<PerfCounterType>(j);
+            out << "," << (r.perf.Has(type) ? json_number(r.perf.Get(type)) : "");
+        }
+        out << "\n";
+    }
+    return out.good();
+}
+
+/**
+ * @brief Reads the JSON string literal that starts at `pos` (at the opening
+ * quote). `pos` is moved after the closing quote.
+ */
+static std::string read_json_string(const std::string &txt, size_t &pos)
+{
+    std::string out;
+    for (pos++; pos < txt.size() && txt[pos] != '"'; pos++) {
+        if (txt[pos] == '\\' && pos + 1 < txt.size()) {
+            pos++;
+            if (txt[pos] == 'u' && pos + 4 < txt.size()) {
+                out += (char) strtol(txt.substr(pos + 1, 4).c_str(), nullptr, 16);
+                pos += 4;
+                continue;
+            }
+        }
+        out += txt[pos];
+    }
+    pos++;
+    return out;
+}
+
+/**
+ * @brief Loads the records saved by `save_speed_json`. Only the subset
+ * of JSON written by this program is supported: records are flat objects
+ * inside the top-level object, unknown keys are ignored.
+ * @return true on success, false otherwise.
+ */
+bool testu01_threads::load_speed_json(const std::string &filename,
+    std::vector<SpeedRecord> &records)
+{
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        std::cerr << "Cannot open the file " << filename << std::endl;
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string txt = ss.str();
+    std::map<std::string, std::string> fields;
+    int depth = 0;
+    for (size_t pos = 0; pos < txt.size(); ) {
+        char c = txt[pos];
+        if (c == '{') {
+            if (++depth == 2) {
+                fields.clear();
+            }
+            pos++;
+        } else if (c == '}') {
+            if (depth-- == 2 && fields.count("interface") > 0) {
+                SpeedRecord r;
+                r.module = fields["module"];
+                r.generator = fields["generator"];
+                r.interface = fields["interface"];
+                r.nthreads = strtoul(fields["threads"].c_str(), nullptr, 10);
+                r.ns_per_call = atof(fields["ns_per_call"].c_str());
+                r.ns_mad = atof(fields["ns_mad"].c_str());
+                r.ns_ci_low = atof(fields["ns_ci_low"].c_str());
+                r.ns_ci_high = atof(fields["ns_ci_high"].c_str());
+                r.cpb = atof(fields["cpb"].c_str());
+                r.gb_per_sec = atof(fields["gb_per_sec"].c_str());
+                for (int j = 0; j < PERF_NCOUNTERS; j++) {
+                    PerfCounterType type = static_cast<PerfCounterType>(j);
+                    auto it = fields.find(std::string(perf_counter_name(type)) + "_per_call");
+                    if (it != fields.end()) {
+                        r.perf.Set(type, atof(it->second.c_str()));
+                    }
+                }
+                records.push_back(r);
+            }
+            pos++;
+        } else if (c == '"') {
+            std::string key = read_json_string(txt, pos);
+            pos = txt.find_first_not_of(" \t\r\n", pos);
+            if (pos == std::string::npos || txt[pos] != ':') {
+                continue;
+            }
+            pos = txt.find_first_not_of(" \t\r\n", pos + 1);
+            if (pos == std::string::npos) {
+                break;
+            }
+            if (txt[pos] == '"') {
+                fields[key] = read_json_string(txt, pos);
+            } else if (txt[pos] != '{' && txt[pos] != '[') {
+                size_t end = txt.find_first_of(",}] \t\r\n", pos);
+                fields[key] = txt.substr(pos, end - pos);
+                pos = end;
+            }
+        } else {
+            pos++;
+        }
+    }
+    if (depth != 0) {
+        std::cerr << "Malformed JSON file " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Compares the current results with the baseline by the total
+ * throughput and prints the table. Records that are absent in one of
+ * the sets are reported but are not regressions. The baseline may contain
+ * other generators (e.g. results of `speed-all`): they are skipped.
+ * @param threshold  Relative drop of throughput treated as a regression,
+ * e.g. 0.1 for 10%.
+ * @return Number of regressions.
+ */
+size_t testu01_threads::compare_speed(const std::vector<SpeedRecord> &baseline,
+    const std::vector<SpeedRecord> &current, double threshold)
+{
+    std::map<std::string, const SpeedRecord *> base;
+    for (auto &r : baseline) {
+        base[r.GetKey()] = &r;
+    }
+    std::set<std::string> measured;
+    for (auto &r : current) {
+        measured.insert(r.module + "\t" + r.generator);
+    }
+    size_t nregressions = 0;
+    char buf[256];
+    snprintf(buf, 256, "%-24s %-16s %7s %12s %12s %8s  %s\n",
+        "Generator", "Interface", "Threads", "Base GB/s", "GB/s", "Change", "Status");
+    std::cout << buf;
+    for (auto &r : current) {
+        auto it = base.find(r.GetKey());
+        if (it == base.end()) {
+            snprintf(buf, 256, "%-24s %-16s %7d %12s %12.3f %8s  %s\n",
+                r.generator.c_str(), r.interface.c_str(), (int) r.nthreads,
+                "-", r.gb_per_sec, "-", "new");
+            std::cout << buf;
+            continue;
+        }
+        double gbs_base = it->second->gb_per_sec;
+        double change = (gbs_base > 0.0) ? r.gb_per_sec / gbs_base - 1.0 : 0.0;
+        const char *status = "ok";
+        if (change < -threshold) {
+            status = "REGRESSION";
+            nregressions++;
+        } else if (change > threshold) {
+            status = "faster";
+        }
+        snprintf(buf, 256, "%-24s %-16s %7d %12.3f %12.3f %+7.1f%%  %s\n",
+            r.generator.c_str(), r.interface.c_str(), (int) r.nthreads,
+            gbs_base, r.gb_per_sec, 100.0 * change, status);
+        std::cout << buf;
+        base.erase(it);
+    }
+    for (auto &b : base) {
+        const SpeedRecord &r = *b.second;
+        if (measured.count(r.module + "\t" + r.generator) == 0) {
+            continue;
+        }
+        snprintf(buf, 256, "%-24s %-16s %7d %12.3f %12s %8s  %s\n",
+            r.generator.c_str(), r.interface.c_str(), (int) r.nthreads,
+            r.gb_per_sec, "-", "-", "not measured");
+        std::cout << buf;
+    }
+    return nregressions;
+}
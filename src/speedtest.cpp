@@ -1,6 +1,10 @@
 #include "testu01th/speedtest.h"
 #include <iostream>
+#include <algorithm>
 #include <cmath>
+#include <chrono>
+#include <atomic>
+#include <cstdio>
 
 using namespace testu01_threads;
 
@@ -11,7 +15,7 @@ static size_t run_u01_block(std::shared_ptr<UniformGenerator> &objptr, size_t ni
     double sum = 0.0;
     auto *gen = objptr->GetPtr();
     for (size_t k = 0; k < niter; k++) {
-        sum += gen->GetU01(nullptr, gen->state);
+        sum += gen->GetU01(gen->param, gen->state);
     }
     return static_cast<size_t>(sum);
 }
@@ -21,7 +25,7 @@ static size_t run_uint32_block(std::shared_ptr<UniformGenerator> &objptr, size_t
     long unsigned int sum = 0;
     auto *gen = objptr->GetPtr();
     for (size_t k = 0; k < niter; k++) {
-        sum += gen->GetBits(nullptr, gen->state);
+        sum += gen->GetBits(gen->param, gen->state);
     }
     return static_cast<size_t>(sum);
 }
@@ -78,99 +82,307 @@ static size_t run_sum64_block(std::shared_ptr<UniformGenerator> &objptr, size_t
 }
 
 
+/**
+ * @brief Returns the factory of "dummy" PRNGs used for correction
+ * for the overhead of calls.
+ * @param buffered  Use the buffered adapter for the "dummy" PRNG.
+ */
+static GenFactoryFunc dummy_factory(bool buffered)
+{
+    static GenInfoC dummy_gen = [] () {
+        GenInfoC gi;
+        GenInfoC_init(&gi);
+        GenCModule_getinfo(&dummy_cmodule, &gi);
+        return gi;
+    }();
+    return [buffered] () -> std::shared_ptr<UniformGenerator> {
+        if (buffered) {
+            return std::shared_ptr<UniformGenerator>(new UniformGeneratorCBuffered(&dummy_gen));
+        } else {
+            return std::shared_ptr<UniformGenerator>(new UniformGeneratorC(&dummy_gen));
+        }
+    };
+}
+
+//////////////////////////////////////////////
+///// SpeedStats class implementation /////
+//////////////////////////////////////////////
 
 /**
- * @brief Keeps PRNG speed measurements results.
+ * @brief Returns the median of the sorted vector.
  */
-class SpeedResults
+static double sorted_median(const std::vector<double> &x)
 {
-public:
-    double ns_per_call; ///< Nanoseconds per call
-    double ticks_per_call; ///< Processor ticks per call
+    size_t n = x.size();
+    return (n % 2 == 1) ? x[n / 2] : 0.5 * (x[n / 2 - 1] + x[n / 2]);
+}
 
-    SpeedResults() : ns_per_call(0.0), ticks_per_call(0) {}
-};
+/**
+ * @brief Computes the median, MAD and 95% confidence interval of the
+ * median. The interval is made of order statistics with ranks
+ * n/2 -+ 1.96 sqrt(n)/2, i.e. it doesn't assume the normal distribution
+ * of measurements (timings usually have a long right tail).
+ */
+SpeedStats SpeedStats::Compute(std::vector<double> x)
+{
+    SpeedStats s;
+    s.n = x.size();
+    if (s.n == 0) {
+        return s;
+    }
+    std::sort(x.begin(), x.end());
+    s.median = sorted_median(x);
+    double hw = 0.98 * sqrt((double) s.n);
+    long lo = (long) floor(0.5 * s.n - hw) - 1, hi = (long) ceil(0.5 * s.n + hw);
+    s.ci_low = x[(size_t) std::max<long>(lo, 0)];
+    s.ci_high = x[(size_t) std::min<long>(hi, (long) s.n - 1)];
+    std::vector<double> dev(s.n);
+    for (size_t i = 0; i < s.n; i++) {
+        dev[i] = fabs(x[i] - s.median);
+    }
+    std::sort(dev.begin(), dev.end());
+    s.mad = sorted_median(dev);
+    return s;
+}
+
+////////////////////////////////////////////////
+///// SpeedHarness class implementation /////
+////////////////////////////////////////////////
 
 /**
- * @brief PRNG speed measurement for uint32 output
+ * @brief Returns the number of CPU time stamp counter ticks per nanosecond.
+ * It is calibrated once by `std::chrono::steady_clock` during 50 ms.
  */
-static SpeedResults measure_speed(GenFactoryFunc create_gen,
-    size_t (*run_block_func)(std::shared_ptr<UniformGenerator> &objptr, size_t niter))
+double SpeedHarness::GetTicksPerNs()
 {
-    auto objptr = create_gen();
-    SpeedResults results;
-    for (size_t niter = 2, ms_total = 0; ms_total < 500; niter <<= 1) {
-        auto tic = std::chrono::high_resolution_clock::now();
+    static const double ticks_per_ns = [] () {
+        auto tic = std::chrono::steady_clock::now();
         uint64_t tic_proc = Entropy::CpuClock();
-        run_block_func(objptr, niter);
+        std::chrono::steady_clock::time_point toc;
+        do {
+            toc = std::chrono::steady_clock::now();
+        } while (toc - tic < std::chrono::milliseconds(50));
         uint64_t toc_proc = Entropy::CpuClock();
-        auto toc = std::chrono::high_resolution_clock::now();
-        ms_total = std::chrono::duration_cast<std::chrono::milliseconds>(toc - tic).count();
-        results.ns_per_call = static_cast<double>(ms_total) / niter * 1e6;
-        results.ticks_per_call = static_cast<double>(toc_proc - tic_proc) / niter;
+        double ns = std::chrono::duration<double, std::nano>(toc - tic).count();
+        return (double) (toc_proc - tic_proc) / ns;
+    }();
+    return ticks_per_ns;
+}
+
+/**
+ * @brief Warms up the generator and returns the number of calls for which
+ * one repetition lasts at least `sample_ms` milliseconds. The warm-up lasts
+ * at least `warmup_ms` milliseconds: it allows the CPU to reach its
+ * working frequency and fills caches.
+ */
+size_t SpeedHarness::Calibrate(std::shared_ptr<UniformGenerator> &gen,
+    RunBlockFunc func) const
+{
+    double ticks_per_ns = GetTicksPerNs();
+    double ms_total = 0.0;
+    size_t niter = 2;
+    while (true) {
+        uint64_t tic = Entropy::CpuClock();
+        func(gen, niter);
+        double ms = (Entropy::CpuClock() - tic) / ticks_per_ns * 1.0e-6;
+        ms_total += ms;
+        if (ms < sample_ms) {
+            niter <<= 1;
+        } else if (ms_total >= warmup_ms) {
+            return niter;
+        }
     }
-    return results;
 }
 
+/**
+ * @brief Measures the generator interface with correction for the overhead
+ * of calls. Both generators are created and warmed up before measurements;
+ * each repetition runs them one after another with the same number of
+ * calls in the alternating (ABBA) order.
+ */
+SpeedMeasurement SpeedHarness::Measure(const GenFactoryFunc &create_gen,
+    const GenFactoryFunc &create_dummy, RunBlockFunc func) const
+{
+    double ticks_per_ns = GetTicksPerNs();
+    auto gen = create_gen();
+    auto dummy = create_dummy();
+    SpeedMeasurement m;
+    m.niter = Calibrate(gen, func);
+    Calibrate(dummy, func);
+    // Counters are started before and stopped after the time measurement
+    std::unique_ptr<PerfCounters> counters(
+        (perf && PerfCounters::IsAvailable()) ? new PerfCounters() : nullptr);
+    PerfCounterValues perf_gen, perf_dummy;
+    std::vector<double> ticks(nrepeats), ticks_dummy(nrepeats), ticks_corr(nrepeats);
+    std::vector<double> ns(nrepeats), ns_dummy(nrepeats), ns_corr(nrepeats);
+    for (size_t i = 0; i < nrepeats; i++) {
+        for (int j = 0; j < 2; j++) {
+            bool run_dummy = (j == (int) (i % 2));
+            auto &objptr = (run_dummy) ? dummy : gen;
+            if (counters != nullptr) {
+                counters->Start();
+            }
+            uint64_t tic = Entropy::CpuClock();
+            func(objptr, m.niter);
+            uint64_t toc = Entropy::CpuClock();
+            if (counters != nullptr) {
+                ((run_dummy) ? perf_dummy : perf_gen) += counters->Stop();
+            }
+            double t = (double) (toc - tic) / m.niter;
+            ((run_dummy) ? ticks_dummy : ticks)[i] = t;
+        }
+        ticks_corr[i] = ticks[i] - ticks_dummy[i];
+        ns[i] = ticks[i] / ticks_per_ns;
+        ns_dummy[i] = ticks_dummy[i] / ticks_per_ns;
+        ns_corr[i] = ticks_corr[i] / ticks_per_ns;
+    }
+    m.ns = SpeedStats::Compute(ns);
+    m.ns_dummy = SpeedStats::Compute(ns_dummy);
+    m.ns_corr = SpeedStats::Compute(ns_corr);
+    m.ticks = SpeedStats::Compute(ticks);
+    m.ticks_dummy = SpeedStats::Compute(ticks_dummy);
+    m.ticks_corr = SpeedStats::Compute(ticks_corr);
+    m.perf = perf_gen - perf_dummy;
+    m.perf.Scale(1.0 / ((double) m.niter * nrepeats));
+    return m;
+}
 
-static void test_speed(GenFactoryFunc create_gen,
-    const GenInfoC &geninfo,
-    size_t (*run_block_func)(std::shared_ptr<UniformGenerator> &objptr, size_t niter),
-    size_t nbits = 32)
+/**
+ * @brief Formats the statistics as "median +/- MAD [ci_low; ci_high]"
+ * divided by `scale`.
+ */
+static std::string format_stats(const SpeedStats &s, double scale = 1.0)
 {
-    GenInfoC dummy_gen;
-    dummy_cmodule.gen_getinfo(&dummy_gen);
-    auto create_dummy_gen = [&dummy_gen] () -> std::shared_ptr<UniformGenerator> {
-        return std::shared_ptr<UniformGenerator>(new UniformGeneratorC(&dummy_gen));
-    };
-    auto speed_full = measure_speed(create_gen, run_block_func);
-    auto speed_dummy = measure_speed(create_dummy_gen, run_block_func);
-    double ns_per_call_corr = speed_full.ns_per_call - speed_dummy.ns_per_call;
-    double ticks_per_call_corr = speed_full.ticks_per_call - speed_dummy.ticks_per_call;
-    double cpb_corr = ticks_per_call_corr / (nbits / 8);
-    double gb_per_sec = (double) nbits / 8.0 / (1.0e-9 * ns_per_call_corr) / pow(2.0, 30.0);
+    char buf[128];
+    snprintf(buf, 128, "%.4g +/- %.2g [%.4g; %.4g]",
+        s.median / scale, s.mad / scale, s.ci_low / scale, s.ci_high / scale);
+    return buf;
+}
+
+/**
+ * @brief PRNG speed measurement with correction for the overhead
+ * of calls (by means of the "dummy" PRNG).
+ * @param interface  Name of the interface for machine-readable results.
+ * @param buffered  If true then the buffered adapter is used for the
+ * "dummy" PRNG, i.e. `create_gen` is expected to make buffered generators.
+ */
+static SpeedRecord test_speed(GenFactoryFunc create_gen,
+    const GenInfoC &geninfo, const SpeedHarness &harness, const char *interface,
+    RunBlockFunc run_block_func, size_t nbits = 32, bool buffered = false)
+{
+    auto m = harness.Measure(create_gen, dummy_factory(buffered), run_block_func);
+    double nbytes = nbits / 8.0;
+    double gb_per_sec = nbytes / m.ns_corr.median; // Bytes/ns, i.e. 10^9 bytes/s
 
     std::cout << "Generator name: " << geninfo.name << std::endl;
-    std::cout << "Nanoseconds per call:" << std::endl;
-    std::cout << "  Raw result:                " << speed_full.ns_per_call << std::endl;        
-    std::cout << "  For empty 'dummy' PRNG:    " << speed_dummy.ns_per_call << std::endl;
-    std::cout << "  Corrected result:          " << ns_per_call_corr << std::endl;
-    std::cout << "  Corrected result (GB/sec): " << gb_per_sec << std::endl;
-    std::cout << "CPU ticks per call:" << std::endl;
-    std::cout << "  Raw result:                " << speed_full.ticks_per_call << std::endl;        
-    std::cout << "  For empty 'dummy' PRNG:    " << speed_dummy.ticks_per_call << std::endl;
-    std::cout << "  Corrected result:          " << ticks_per_call_corr << std::endl;
-    std::cout << "  Corrected result (cpB):    " << cpb_corr << std::endl;
+    std::cout << "Nanoseconds per call (median +/- MAD [95% CI]):" << std::endl;
+    std::cout << "  Raw result:                " << format_stats(m.ns) << std::endl;
+    std::cout << "  For empty 'dummy' PRNG:    " << format_stats(m.ns_dummy) << std::endl;
+    std::cout << "  Corrected result:          " << format_stats(m.ns_corr) << std::endl;
+    std::cout << "  Corrected result (GB/s):   " << gb_per_sec << " (1 GB = 10^9 bytes)" << std::endl;
+    std::cout << "CPU ticks per call (median +/- MAD [95% CI]):" << std::endl;
+    std::cout << "  Raw result:                " << format_stats(m.ticks) << std::endl;
+    std::cout << "  For empty 'dummy' PRNG:    " << format_stats(m.ticks_dummy) << std::endl;
+    std::cout << "  Corrected result:          " << format_stats(m.ticks_corr) << std::endl;
+    std::cout << "  Corrected result (cpB):    " << format_stats(m.ticks_corr, nbytes) << std::endl;
+    if (!m.perf.IsEmpty()) {
+        std::cout << "Hardware counters per call (corrected):" << std::endl;
+        std::cout << "  " << m.perf.ToString() << std::endl;
+    }
+
+    SpeedRecord rec;
+    rec.generator = geninfo.name;
+    rec.interface = interface;
+    rec.ns_per_call = m.ns_corr.median;
+    rec.ns_mad = m.ns_corr.mad;
+    rec.ns_ci_low = m.ns_corr.ci_low;
+    rec.ns_ci_high = m.ns_corr.ci_high;
+    rec.cpb = m.ticks_corr.median / nbytes;
+    rec.gb_per_sec = gb_per_sec;
+    rec.perf = m.perf;
+    return rec;
 }
 
 
-void testu01_threads::test_battery_speed(const GenFactoryFunc &create_gen, const GenInfoC &geninfo)
+/**
+ * @brief Prints the capability flags reported by the module.
+ */
+static void print_flags(const GenInfoC &geninfo)
+{
+    static const struct {
+        uint64_t mask;
+        const char *name;
+    } names[] = {
+        {GENINFOC_FLAG_NATIVE64, "NATIVE64"},
+        {GENINFOC_FLAG_VECTORIZED, "VECTORIZED"},
+        {GENINFOC_FLAG_COUNTER, "COUNTER"},
+        {GENINFOC_FLAG_JUMPABLE, "JUMPABLE"},
+        {GENINFOC_FLAG_THREADSAFE, "THREADSAFE"}
+    };
+    std::cout << "Capability flags:";
+    if (geninfo.flags == 0) {
+        std::cout << " none";
+    }
+    for (auto &n : names) {
+        if (geninfo.flags & n.mask) {
+            std::cout << " " << n.name;
+        }
+    }
+    std::cout << std::endl << std::endl;
+}
+
+
+std::vector<SpeedRecord> testu01_threads::test_battery_speed(const GenFactoryFunc &create_gen,
+    const GenInfoC &geninfo, const SpeedHarness &harness)
 {
+    std::vector<SpeedRecord> records;
+    print_flags(geninfo);
+    std::cout << "Repetitions: " << harness.GetNRepeats() << std::endl;
+    std::cout << "TSC frequency, GHz: " << SpeedHarness::GetTicksPerNs() << std::endl << std::endl;
     // Part 1. Scalar tests
     std::cout << "----- Speed test for double generation -----" << std::endl;
-    test_speed(create_gen, geninfo, run_u01_block);
+    records.push_back(test_speed(create_gen, geninfo, harness, "u01", run_u01_block));
     std::cout << std::endl;
     std::cout << "----- Speed test for uint32 generation -----" << std::endl;
-    test_speed(create_gen, geninfo, run_uint32_block);
+    records.push_back(test_speed(create_gen, geninfo, harness, "u32", run_uint32_block));
     std::cout << std::endl;
     if (geninfo.get_bits64 != nullptr) {
         std::cout << "----- Speed test for uint64 generation -----" << std::endl;
-        test_speed(create_gen, geninfo, run_uint64_block, 64);
+        records.push_back(test_speed(create_gen, geninfo, harness, "u64",
+            run_uint64_block, 64));
         std::cout << std::endl;
     } else {
         std::cout << "----- uint64 generator is not implemented -----" << std::endl;
     }
+    // Part 1a. Scalar calls served from the buffer: the fastest path
+    // for the generators that make outputs in blocks.
+    if ((geninfo.flags & GENINFOC_FLAG_VECTORIZED) &&
+        UniformGeneratorCBuffered::IsSupported(&geninfo)) {
+        auto create_buf_gen = [&geninfo] () -> std::shared_ptr<UniformGenerator> {
+            return std::shared_ptr<UniformGenerator>(new UniformGeneratorCBuffered(&geninfo));
+        };
+        std::cout << "----- Speed test for double generation (buffered) -----" << std::endl;
+        records.push_back(test_speed(create_buf_gen, geninfo, harness, "u01_buffered",
+            run_u01_block, 32, true));
+        std::cout << std::endl;
+        std::cout << "----- Speed test for uint32 generation (buffered) -----" << std::endl;
+        records.push_back(test_speed(create_buf_gen, geninfo, harness, "u32_buffered",
+            run_uint32_block, 32, true));
+        std::cout << std::endl;
+    }
     // Part 2. Vectorized tests
     if (geninfo.get_array32 != nullptr) {
         std::cout << "----- Speed test for array of uint32 generation -----" << std::endl;
-        test_speed(create_gen, geninfo, run_array32_block, ELEMENTS_PER_BLOCK * 32);
+        records.push_back(test_speed(create_gen, geninfo, harness, "array32",
+            run_array32_block, ELEMENTS_PER_BLOCK * 32));
     } else {
         std::cout << "----- Array of uint32 generator is not implemented -----" << std::endl;
     }
 
     if (geninfo.get_array64 != nullptr) {
         std::cout << "----- Speed test for array of uint64 generation -----" << std::endl;
-        test_speed(create_gen, geninfo, run_array64_block, ELEMENTS_PER_BLOCK * 64);
+        records.push_back(test_speed(create_gen, geninfo, harness, "array64",
+            run_array64_block, ELEMENTS_PER_BLOCK * 64));
         std::cout << std::endl;
     } else {
         std::cout << "----- Array of uint64 generator is not implemented -----" << std::endl;
@@ -179,7 +391,8 @@ void testu01_threads::test_battery_speed(const GenFactoryFunc &create_gen, const
     // Part 3. Inlining tests
     if (geninfo.get_sum32 != nullptr) {
         std::cout << "----- Speed test for sum of uint32 generation -----" << std::endl;
-        test_speed(create_gen, geninfo, run_sum32_block, ELEMENTS_PER_BLOCK * 32);
+        records.push_back(test_speed(create_gen, geninfo, harness, "sum32",
+            run_sum32_block, ELEMENTS_PER_BLOCK * 32));
         std::cout << std::endl;
     } else {
         std::cout << "----- Sum of uint32 generator is not implemented -----" << std::endl;
@@ -187,9 +400,219 @@ void testu01_threads::test_battery_speed(const GenFactoryFunc &create_gen, const
 
     if (geninfo.get_sum64 != nullptr) {
         std::cout << "----- Speed test for sum of uint64 generation -----" << std::endl;
-        test_speed(create_gen, geninfo, run_sum64_block, ELEMENTS_PER_BLOCK * 64);
+        records.push_back(test_speed(create_gen, geninfo, harness, "sum64",
+            run_sum64_block, ELEMENTS_PER_BLOCK * 64));
         std::cout << std::endl;
     } else {
         std::cout << "----- Sum of uint64 generator is not implemented -----" << std::endl;
     }
+    return records;
+}
+
+
+///////////////////////////////////////////////
+///// Multi-threaded speed (scaling) test /////
+///////////////////////////////////////////////
+
+/**
+ * @brief Result of the run of several generator instances in parallel.
+ */
+class SpeedResultsMT
+{
+public:
+    double ns_per_call; ///< Mean time of one call in one thread, ns.
+    double ticks_per_call; ///< Mean CPU ticks per call in one thread.
+    double wall_ns; ///< Time from the start to the end of the slowest thread, ns.
+
+    SpeedResultsMT() : ns_per_call(0.0), ticks_per_call(0.0), wall_ns(0.0) {}
+};
+
+/**
+ * @brief Runs `nthreads` instances of the generator in the first workers
+ * of the pool (each worker creates its own instance, so its memory is local
+ * to the worker). All workers start simultaneously.
+ */
+static SpeedResultsMT measure_speed_mt(GenFactoryFunc create_gen,
+    RunBlockFunc run_block_func, size_t niter, ThreadPool &pool, size_t nthreads)
+{
+    std::vector<std::shared_ptr<UniformGenerator>> gens(nthreads);
+    // Modules are not required to be thread-safe during initialization
+    for (size_t i = 0; i < nthreads; i++) {
+        pool.SubmitPinned([&gens, &create_gen, i] (size_t) { gens[i] = create_gen(); }, i);
+        pool.Wait();
+    }
+    std::vector<double> ns(nthreads), ticks(nthreads);
+    std::atomic<size_t> nready(0);
+    auto start = std::chrono::steady_clock::time_point::max();
+    auto finish = std::chrono::steady_clock::time_point::min();
+    std::mutex mut;
+    for (size_t i = 0; i < nthreads; i++) {
+        pool.SubmitPinned([&, i] (size_t) {
+            // Spin barrier: all instances are run simultaneously
+            nready++;
+            while (nready < nthreads) {}
+            auto tic = std::chrono::steady_clock::now();
+            uint64_t tic_proc = Entropy::CpuClock();
+            run_block_func(gens[i], niter);
+            uint64_t toc_proc = Entropy::CpuClock();
+            auto toc = std::chrono::steady_clock::now();
+            ns[i] = std::chrono::duration<double, std::nano>(toc - tic).count();
+            ticks[i] = (double) (toc_proc - tic_proc);
+            std::lock_guard<std::mutex> lock(mut);
+            start = std::min(start, tic);
+            finish = std::max(finish, toc);
+        }, i);
+    }
+    pool.Wait();
+    SpeedResultsMT results;
+    for (size_t i = 0; i < nthreads; i++) {
+        results.ns_per_call += ns[i] / niter / nthreads;
+        results.ticks_per_call += ticks[i] / niter / nthreads;
+    }
+    results.wall_ns = std::chrono::duration<double, std::nano>(finish - start).count();
+    return results;
+}
+
+/**
+ * @brief Prints the table of per-core and aggregate speeds of the generator
+ * interface for 1, 2, 4, ... threads (and for all threads of the pool).
+ * Times are corrected for the overhead of calls by the "dummy" PRNG run
+ * with the same number of threads. Each row is the median of repetitions
+ * where the generator and the "dummy" PRNG runs are interleaved.
+ * @param rec      Template of the record with generator and interface names.
+ * @param records  Output: one record per number of threads is appended.
+ */
+static void test_speed_mt(GenFactoryFunc create_gen, RunBlockFunc run_block_func,
+    size_t nbits, ThreadPool &pool, const SpeedHarness &harness,
+    SpeedRecord rec, std::vector<SpeedRecord> &records)
+{
+    auto create_dummy_gen = dummy_factory(false);
+    size_t niter = 0;
+    {
+        auto objptr = create_gen();
+        niter = harness.Calibrate(objptr, run_block_func);
+    }
+    size_t nrepeats = harness.GetNRepeats();
+    double nbytes = nbits / 8.0;
+    char buf[128];
+    snprintf(buf, 128, "  %7s %13s %12s %9s %9s %9s\n",
+        "Threads", "GB/s per core", "GB/s total", "+/- MAD", "cpB", "Scaling");
+    std::cout << buf;
+    double gbs_1 = 0.0;
+    size_t nmax = pool.GetNThreads();
+    for (size_t n = 1; n <= nmax; n = (n < nmax && 2 * n > nmax) ? nmax : 2 * n) {
+        std::vector<double> gbs_core, gbs_total, cpb, ns;
+        size_t nrejected = 0;
+        for (size_t i = 0; i < nrepeats; i++) {
+            SpeedResultsMT full, dummy;
+            if (i % 2 == 0) {
+                dummy = measure_speed_mt(create_dummy_gen, run_block_func, niter, pool, n);
+                full = measure_speed_mt(create_gen, run_block_func, niter, pool, n);
+            } else {
+                full = measure_speed_mt(create_gen, run_block_func, niter, pool, n);
+                dummy = measure_speed_mt(create_dummy_gen, run_block_func, niter, pool, n);
+            }
+            double ns_corr = full.ns_per_call - dummy.ns_per_call;
+            double wall_corr = full.wall_ns - dummy.ns_per_call * niter;
+            // The correction may exceed the measured time because of noise
+            if (ns_corr <= 0.0 || wall_corr <= 0.0) {
+                nrejected++;
+                continue;
+            }
+            ns.push_back(ns_corr);
+            gbs_core.push_back(nbytes / ns_corr);
+            gbs_total.push_back(nbytes * niter * n / wall_corr);
+            cpb.push_back((full.ticks_per_call - dummy.ticks_per_call) / nbytes);
+        }
+        if (nrejected > 0) {
+            std::cout << "  (" << nrejected << " of " << nrepeats << " repetitions with "
+                << n << " threads are rejected: the correction exceeds the time)"
+                << std::endl;
+        }
+        auto total = SpeedStats::Compute(gbs_total);
+        auto ns_stats = SpeedStats::Compute(ns);
+        if (n == 1) {
+            gbs_1 = total.median;
+        }
+        rec.nthreads = n;
+        rec.ns_per_call = ns_stats.median;
+        rec.ns_mad = ns_stats.mad;
+        rec.ns_ci_low = ns_stats.ci_low;
+        rec.ns_ci_high = ns_stats.ci_high;
+        rec.cpb = SpeedStats::Compute(cpb).median;
+        rec.gb_per_sec = total.median;
+        records.push_back(rec);
+        snprintf(buf, 128, "  %7d %13.3f %12.3f %9.3f %9.3f %9.2f\n", (int) n,
+            SpeedStats::Compute(gbs_core).median, total.median, total.mad,
+            rec.cpb, (gbs_1 > 0.0) ? (total.median / gbs_1) : 0.0);
+        std::cout << buf << std::flush;
+        if (n == nmax) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Multi-threaded speed test: shows how the generator scales when
+ * 1..N cores run their own instances simultaneously, i.e. in the same way
+ * as in parallel batteries. Cores share caches and memory bandwidth, so
+ * generators with large tables may scale worse than register-only ones.
+ * Workers of the pool may be pinned to CPUs (see AffinityPolicy).
+ */
+std::vector<SpeedRecord> testu01_threads::test_battery_speed_mt(const GenFactoryFunc &create_gen,
+    const GenInfoC &geninfo, std::shared_ptr<ThreadPool> pool,
+    const SpeedHarness &harness)
+{
+    std::vector<SpeedRecord> records;
+    SpeedRecord rec;
+    rec.generator = geninfo.name;
+    std::cout << "Generator name: " << geninfo.name << std::endl;
+    std::cout << "Number of threads: " << pool->GetNThreads() << std::endl;
+    std::cout << "Repetitions: " << harness.GetNRepeats() << std::endl;
+    std::cout << "Speeds are corrected for the overhead of calls; "
+        "1 GB = 10^9 bytes" << std::endl << std::endl;
+    pool->SetNActive(pool->GetNThreads());
+    std::cout << "----- Scaling for double generation -----" << std::endl;
+    rec.interface = "u01";
+    test_speed_mt(create_gen, run_u01_block, 32, *pool, harness, rec, records);
+    std::cout << std::endl;
+    std::cout << "----- Scaling for uint32 generation -----" << std::endl;
+    rec.interface = "u32";
+    test_speed_mt(create_gen, run_uint32_block, 32, *pool, harness, rec, records);
+    std::cout << std::endl;
+    if (geninfo.get_bits64 != nullptr) {
+        std::cout << "----- Scaling for uint64 generation -----" << std::endl;
+        rec.interface = "u64";
+        test_speed_mt(create_gen, run_uint64_block, 64, *pool, harness, rec, records);
+        std::cout << std::endl;
+    }
+    if (geninfo.get_array32 != nullptr) {
+        std::cout << "----- Scaling for array of uint32 generation -----" << std::endl;
+        rec.interface = "array32";
+        test_speed_mt(create_gen, run_array32_block, ELEMENTS_PER_BLOCK * 32, *pool,
+            harness, rec, records);
+        std::cout << std::endl;
+    }
+    if (geninfo.get_array64 != nullptr) {
+        std::cout << "----- Scaling for array of uint64 generation -----" << std::endl;
+        rec.interface = "array64";
+        test_speed_mt(create_gen, run_array64_block, ELEMENTS_PER_BLOCK * 64, *pool,
+            harness, rec, records);
+        std::cout << std::endl;
+    }
+    if (geninfo.get_sum32 != nullptr) {
+        std::cout << "----- Scaling for sum of uint32 generation -----" << std::endl;
+        rec.interface = "sum32";
+        test_speed_mt(create_gen, run_sum32_block, ELEMENTS_PER_BLOCK * 32, *pool,
+            harness, rec, records);
+        std::cout << std::endl;
+    }
+    if (geninfo.get_sum64 != nullptr) {
+        std::cout << "----- Scaling for sum of uint64 generation -----" << std::endl;
+        rec.interface = "sum64";
+        test_speed_mt(create_gen, run_sum64_block, ELEMENTS_PER_BLOCK * 64, *pool,
+            harness, rec, records);
+        std::cout << std::endl;
+    }
+    return records;
 }
@@ -4,7 +4,8 @@
 int main()
 {
     GenInfoC gi;
-    splitmix_get_geninfo(&gi);
+    GenInfoC_init(&gi);
+    splitmix_get_geninfo(&gi, sizeof(GenInfoC));
     run_smallcrush(&gi);
     return 0;
 }
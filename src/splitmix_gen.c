@@ -49,6 +49,18 @@ static long unsigned int get_bits32(void *param, void *state)
     return x >> 32;
 }
 
+/**
+ * @brief Jump by 2^log2_distance outputs.
+ */
+static void jump(void *param, void *state, unsigned int log2_distance)
+{
+    SplitMixState *obj = state;
+    (void) param;
+    if (log2_distance < 64) {
+        obj->x += 1ull << log2_distance;
+    }
+}
+
 static void *init_state(void)
 {
     SplitMixState *obj = malloc(sizeof(SplitMixState));
@@ -56,6 +68,13 @@ static void *init_state(void)
     return (void *) obj;
 }
 
+static void *init_state_seeded(const uint64_t *seed, size_t nwords)
+{
+    SplitMixState *obj = malloc(sizeof(SplitMixState));
+    obj->x = (nwords > 0) ? seed[0] : 0;
+    return (void *) obj;
+}
+
 static void delete_state(void *param, void *state)
 {
     (void) param;
@@ -63,7 +82,7 @@ static void delete_state(void *param, void *state)
 }
 
 
-int splitmix_get_geninfo(GenInfoC *gi)
+int splitmix_get_geninfo(GenInfoC *gi, size_t size)
 {
     static const char name[] = "SplitMix64";
     gi->name = name;
@@ -74,5 +93,13 @@ int splitmix_get_geninfo(GenInfoC *gi)
     gi->get_bits64 = get_bits64;
     gi->get_array64 = get_array64;
     gi->get_sum64 = get_sum64;
+    if (GENINFOC_HAS_FIELD(size, init_state_seeded)) {
+        gi->init_state_seeded = init_state_seeded;
+    }
+    if (GENINFOC_HAS_FIELD(size, jump)) {
+        gi->jump = jump;
+    }
+    GenInfoC_set_flags(gi, size, GENINFOC_FLAG_NATIVE64 | GENINFOC_FLAG_COUNTER |
+        GENINFOC_FLAG_JUMPABLE);
     return 1;
 }
@@ -0,0 +1,308 @@
+#include "testu01th/stream_writer.h"
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif
+
+using namespace testu01_threads;
+
+/**
+ * @brief Returns the size of one generator output for the given format.
+ */
+size_t testu01_threads::stream_word_size(StreamFormat format)
+{
+    return (format == STREAM_BITS32 || format == STREAM_ARRAY32) ?
+        sizeof(uint32_t) : sizeof(uint64_t);
+}
+
+/**
+ * @brief Fills the buffer by the generator output. The number of written
+ * bytes is rounded up to the size of generator output (buffers must have
+ * some extra space for it).
+ */
+void testu01_threads::fill_stream_buffer(UniformGenerator &gen, StreamFormat format,
+    uint8_t *buf, size_t len)
+{
+    if (format == STREAM_BITS32 || format == STREAM_ARRAY32) {
+        uint32_t *out = reinterpret_cast<uint32_t *>(buf);
+        size_t n = (len + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+        if (format == STREAM_ARRAY32) {
+            gen.GetArray32(out, n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = gen.GetBits32();
+            }
+        }
+    } else {
+        uint64_t *out = reinterpret_cast<uint64_t *>(buf);
+        size_t n = (len + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        if (format == STREAM_ARRAY64) {
+            gen.GetArray64(out, n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = gen.GetBits64();
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////
+///// StreamWriter class implementation /////
+///////////////////////////////////////////////
+
+StreamWriter::StreamWriter(GenFactoryFunc create_gen_, StreamFormat format_)
+    : create_gen(create_gen_), format(format_), nthreads(1), nslots(0),
+    buffer_size(4 * 1048576), limit(0), streams_log2(0), streams_seed(0),
+    zerocopy(true), stop(false)
+{
+}
+
+/**
+ * @brief Sets the size of one buffer; it is rounded up to the size
+ * of the memory page.
+ */
+void StreamWriter::SetBufferSize(size_t bytes)
+{
+    if (bytes < PAGE_SIZE) {
+        bytes = PAGE_SIZE;
+    }
+    buffer_size = (bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+}
+
+/**
+ * @brief Generators of different threads will be initialized by the same
+ * seed and moved to non-overlapping substreams of 2^log2_distance outputs.
+ * The generator must support jumps. 0 means independent seeds.
+ */
+void StreamWriter::SetStreams(unsigned int log2_distance, uint64_t seed)
+{
+    streams_log2 = log2_distance;
+    streams_seed = seed;
+}
+
+/**
+ * @brief Creates the generator for the given generator thread.
+ */
+std::shared_ptr<UniformGenerator> StreamWriter::CreateGenerator(size_t thread_id)
+{
+    if (streams_log2 == 0) {
+        return create_gen();
+    }
+    Entropy::SetThreadSeed(streams_seed);
+    auto gen = create_gen();
+    Entropy::ResetThreadSeed();
+    if (!gen->SetStream(thread_id, streams_log2)) {
+        fprintf(stderr, "Generator doesn't support jumps: streams are not used\n");
+    }
+    return gen;
+}
+
+/**
+ * @brief Returns the size of the block with the given index: all blocks
+ * except the last one have the size of the buffer.
+ */
+uint64_t StreamWriter::GetBlockSize(uint64_t seq, uint64_t nblocks) const
+{
+    if (limit > 0 && seq == nblocks - 1) {
+        return limit - seq * buffer_size;
+    }
+    return buffer_size;
+}
+
+/**
+ * @brief Generator thread: fills blocks `thread_id`, `thread_id + nthreads`,
+ * `thread_id + 2*nthreads` etc.
+ */
+void StreamWriter::GeneratorFunc(std::shared_ptr<UniformGenerator> gen,
+    size_t thread_id, uint64_t nblocks)
+{
+    size_t ns = slots.size();
+    for (uint64_t k = thread_id; k < nblocks; k += nthreads) {
+        Slot &s = slots[k % ns];
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            cv.wait(lock, [this, &s, k] { return stop || (!s.ready && s.seq == k); });
+            if (stop) {
+                return;
+            }
+        }
+        size_t len = (size_t) GetBlockSize(k, nblocks);
+        fill_stream_buffer(*gen, format, s.buf, len);
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            s.len = len;
+            s.ready = true;
+        }
+        cv.notify_all();
+    }
+}
+
+/**
+ * @brief Writes the whole buffer to the file descriptor.
+ * @return false in the case of error (e.g. the pipe is closed).
+ */
+bool StreamWriter::WriteAll(int fd, const uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+#if defined(_WIN32) || defined(_WIN64)
+        unsigned int chunk = (len > 0x40000000) ? 0x40000000 : (unsigned int) len;
+        int n = _write(fd, buf, chunk);
+#else
+        ssize_t n = write(fd, buf, len);
+#endif
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= (size_t) n;
+    }
+    return true;
+}
+
+/**
+ * @brief Gives the whole buffer to the pipe by `vmsplice` (Linux only).
+ * @return false in the case of error (e.g. the pipe is closed).
+ */
+bool StreamWriter::SpliceAll(int fd, const uint8_t *buf, size_t len)
+{
+#if defined(__linux__)
+    while (len > 0) {
+        struct iovec iov;
+        iov.iov_base = const_cast<uint8_t *>(buf);
+        iov.iov_len = len;
+        ssize_t n = vmsplice(fd, &iov, 1, SPLICE_F_GIFT);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= (size_t) n;
+    }
+    return true;
+#else
+    return WriteAll(fd, buf, len);
+#endif
+}
+
+/**
+ * @brief Checks if the zero-copy output may be used for the file
+ * descriptor (it must be a pipe) and enlarges the pipe to the buffer size.
+ * @return Number of blocks that may be still referenced by the pipe after
+ * writing of the next block, 0 if zero-copy output is not used.
+ */
+size_t StreamWriter::SetupZeroCopy(int fd)
+{
+#if defined(__linux__)
+    struct stat st;
+    if (!zerocopy || fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode)) {
+        return 0;
+    }
+    fcntl(fd, F_SETPIPE_SZ, (int) buffer_size); // May fail: it is not critical
+    int capacity = fcntl(fd, F_GETPIPE_SZ);
+    if (capacity <= 0) {
+        return 0;
+    }
+    return ((size_t) capacity + buffer_size - 1) / buffer_size;
+#else
+    (void) fd;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Returns the slot with the given block to generators.
+ */
+void StreamWriter::ReleaseSlot(uint64_t seq)
+{
+    Slot &s = slots[seq % slots.size()];
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        s.ready = false;
+        s.seq = seq + slots.size();
+    }
+    cv.notify_all();
+}
+
+/**
+ * @brief Runs generator threads and writes their output to the file
+ * descriptor in the calling thread. Prints the achieved speed to stderr.
+ * @param fd  File descriptor, e.g. `fileno(stdout)`.
+ * @return Number of written bytes.
+ */
+uint64_t StreamWriter::Run(int fd)
+{
+    // With vmsplice the slot is released with the lag: the pipe may still
+    // refer to its pages.
+    size_t lag = SetupZeroCopy(fd);
+    size_t ns = (nslots == 0) ? 2 * nthreads : std::max(nslots, nthreads);
+    if (lag > 0) {
+        ns = std::max(ns, nthreads + lag + 1);
+    }
+    slots = std::vector<Slot>(ns);
+    for (size_t i = 0; i < ns; i++) {
+        Slot &s = slots[i];
+        s.storage.resize(buffer_size + PAGE_SIZE + sizeof(uint64_t));
+        uintptr_t addr = reinterpret_cast<uintptr_t>(s.storage.data());
+        addr = (addr + PAGE_SIZE - 1) & ~((uintptr_t) PAGE_SIZE - 1);
+        s.buf = reinterpret_cast<uint8_t *>(addr);
+        s.seq = i;
+    }
+    stop = false;
+    uint64_t nblocks = (limit > 0) ? (limit + buffer_size - 1) / buffer_size : UINT64_MAX;
+    // Generators are created one by one: modules are not required
+    // to be thread-safe during initialization.
+    std::vector<std::shared_ptr<UniformGenerator>> gens;
+    for (size_t i = 0; i < nthreads; i++) {
+        gens.push_back(CreateGenerator(i));
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nthreads; i++) {
+        threads.emplace_back(&StreamWriter::GeneratorFunc, this, gens[i], i, nblocks);
+    }
+    uint64_t nbytes = 0;
+    auto tic = std::chrono::steady_clock::now();
+    for (uint64_t k = 0; k < nblocks; k++) {
+        Slot &s = slots[k % ns];
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            cv.wait(lock, [&s, k] { return s.ready && s.seq == k; });
+        }
+        bool is_ok = (lag > 0) ? SpliceAll(fd, s.buf, s.len) : WriteAll(fd, s.buf, s.len);
+        if (!is_ok) {
+            break;
+        }
+        nbytes += s.len;
+        if (k >= lag) {
+            ReleaseSlot(k - lag);
+        }
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - tic).count();
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stop = true;
+    }
+    cv.notify_all();
+    for (auto &th : threads) {
+        th.join();
+    }
+    fprintf(stderr, "=====> %.3f GiB written in %.2f s (%.3f GB/s, output: %s)\n",
+        nbytes / 1073741824.0, sec, (sec > 0.0) ? nbytes / sec * 1.0e-9 : 0.0,
+        (lag > 0) ? "vmsplice" : "write");
+    return nbytes;
+}
@@ -1,8 +1,8 @@
 #include "testu01th/testu01_mt.h"
+#include "testu01th/stream_writer.h"
 #include <iostream>
 #include <chrono>
 #include <cstring>
-#include <random>
 #include <io.h>
 #include <fcntl.h>
 #include <stdarg.h>
@@ -226,6 +226,46 @@ uint64_t UniformGenerator::GetSum64(size_t len)
 }
 
 
+/**
+ * @brief Advances the generator by 2^log2_distance outputs.
+ * @return false if jumps are not supported by the generator.
+ */
+bool UniformGenerator::Jump(unsigned int log2_distance)
+{
+    (void) log2_distance;
+    return false;
+}
+
+/**
+ * @brief Moves the generator to the beginning of the given substream:
+ * substreams are non-overlapping segments of 2^log2_distance outputs
+ * of one sequence. The jump is made as a sum of jumps by powers of 2.
+ * @return false if jumps are not supported by the generator.
+ */
+bool UniformGenerator::SetStream(uint64_t stream, unsigned int log2_distance)
+{
+    for (unsigned int i = 0; stream != 0; i++, stream >>= 1) {
+        if ((stream & 1) && !Jump(log2_distance + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Moves the generator to the beginning of the region of `len`
+ * outputs that starts at `offset` (see `TestsPull::SetSampleRegions`).
+ * The default implementation just makes the jump: only finite sources
+ * (such as files) track the region end, see `GetRegionOverruns`.
+ * @return false if jumps are not supported by the generator.
+ */
+bool UniformGenerator::SetRegion(uint64_t offset, uint64_t len)
+{
+    (void) len;
+    return SetStream(offset, 0);
+}
+
+
 UniformGenerator::UniformGenerator(const std::string &name)
 {
     this->name = name;
@@ -243,11 +283,32 @@ UniformGenerator::UniformGenerator(const std::string &name)
 //////////////////////////////////////////////////
 
 
+/**
+ * @brief Initializes the state of the PRNG from the C module. If the
+ * deterministic seeds are enabled for the calling thread (see
+ * Entropy::SetThreadSeed) and the module supports explicit seeding then
+ * the seed is passed to `init_state_seeded`. Otherwise `init_state` is
+ * used: it obtains seeds from the caller API (and they are deterministic
+ * if the caller uses Entropy::Seed64).
+ */
+static void *init_cmodule_state(const GenInfoC *gi)
+{
+    uint64_t seed[GENINFOC_SEED_NWORDS];
+    if (gi->init_state_seeded != nullptr && Entropy::NextThreadSeed(seed[0])) {
+        for (size_t i = 1; i < GENINFOC_SEED_NWORDS; i++) {
+            Entropy::NextThreadSeed(seed[i]);
+        }
+        return gi->init_state_seeded(seed, GENINFOC_SEED_NWORDS);
+    }
+    return gi->init_state();
+}
+
+
 UniformGeneratorC::UniformGeneratorC(const GenInfoC *gi)
 : UniformGenerator(""), gen_module(*gi)
 {
     this->name = std::string(gi->name);
-    gen.state = gi->init_state();
+    gen.state = init_cmodule_state(gi);
     gen.param = nullptr;
     gen.Write = WrExternGen;
     gen.GetU01 = gi->get_u01;
@@ -255,6 +316,97 @@ UniformGeneratorC::UniformGeneratorC(const GenInfoC *gi)
     gen.name = const_cast<char *>(name.c_str());
 }
 
+/**
+ * @brief Advances the generator by 2^log2_distance outputs using
+ * the `jump` function of the C module (if it is supplied).
+ */
+bool UniformGeneratorC::Jump(unsigned int log2_distance)
+{
+    if (gen_module.jump == nullptr) {
+        return false;
+    }
+    gen_module.jump(gen.param, gen.state, log2_distance);
+    return true;
+}
+
+//////////////////////////////////////////////////////////
+///// UniformGeneratorCBuffered class implementation /////
+//////////////////////////////////////////////////////////
+
+UniformGeneratorCBuffered::UniformGeneratorCBuffered(const GenInfoC *gi)
+: UniformGenerator(""), gen_module(*gi), state(nullptr),
+    storage(ELEMENTS_PER_BLOCK + 8), buf32(nullptr), buf64(nullptr),
+    bufu01(nullptr), pos(ELEMENTS_PER_BLOCK), pos_u01(ELEMENTS_PER_BLOCK / 2)
+{
+    // Align the buffers to the 64-byte cache line: the first half of
+    // the storage is for integers, the second one is for doubles.
+    uintptr_t addr = reinterpret_cast<uintptr_t>(storage.data());
+    addr = (addr + 63) & ~((uintptr_t) 63);
+    if (gi->get_array32 != nullptr) {
+        buf32 = reinterpret_cast<uint32_t *>(addr);
+    } else {
+        buf64 = reinterpret_cast<uint64_t *>(addr);
+    }
+    if (gi->get_array_u01 != nullptr) {
+        bufu01 = reinterpret_cast<double *>(addr + ELEMENTS_PER_BLOCK * sizeof(uint32_t));
+    }
+    this->name = std::string(gi->name) + " (buffered)";
+    state = init_cmodule_state(gi);
+    gen.state = state;
+    gen.param = static_cast<void *>(this);
+    gen.Write = WrExternGen;
+    gen.GetU01 = (bufu01 != nullptr) ? GetU01BufArray : GetU01Buf;
+    gen.GetBits = GetBitsBuf;
+    gen.name = const_cast<char *>(name.c_str());
+}
+
+/**
+ * @brief Checks if the C module has vectorized functions required
+ * for buffering.
+ */
+bool UniformGeneratorCBuffered::IsSupported(const GenInfoC *gi)
+{
+    return gi->get_array32 != nullptr || gi->get_array64 != nullptr;
+}
+
+/**
+ * @brief Advances the generator by 2^log2_distance outputs using
+ * the `jump` function of the C module. Buffered values are discarded.
+ */
+bool UniformGeneratorCBuffered::Jump(unsigned int log2_distance)
+{
+    if (gen_module.jump == nullptr) {
+        return false;
+    }
+    gen_module.jump(nullptr, state, log2_distance);
+    pos = ELEMENTS_PER_BLOCK;
+    pos_u01 = ELEMENTS_PER_BLOCK / 2;
+    return true;
+}
+
+/**
+ * @brief Refills the buffer by the vectorized function of the C module.
+ */
+void UniformGeneratorCBuffered::Refill()
+{
+    if (buf32 != nullptr) {
+        gen_module.get_array32(nullptr, state, buf32, ELEMENTS_PER_BLOCK);
+    } else {
+        gen_module.get_array64(nullptr, state, buf64, ELEMENTS_PER_BLOCK / 2);
+    }
+    pos = 0;
+}
+
+/**
+ * @brief Refills the buffer of doubles by `get_array_u01` function
+ * of the C module.
+ */
+void UniformGeneratorCBuffered::RefillU01()
+{
+    gen_module.get_array_u01(nullptr, state, bufu01, ELEMENTS_PER_BLOCK / 2);
+    pos_u01 = 0;
+}
+
 //////////////////////////////////////////
 ///// BatteryIO class implementation /////
 //////////////////////////////////////////
@@ -401,85 +553,459 @@ std::string BatteryResults::ToString() const
 }
 
 
+//////////////////////////////////////////
+///// TestDescr class implementation /////
+//////////////////////////////////////////
+
+/**
+ * @brief Splits the test into shards that can be run in different threads.
+ * @param nshards  Required number of shards (will be decreased to the
+ * maximal number of shards for this test).
+ * @return List of shards. If the test cannot be split, it will contain
+ * only a copy of the test.
+ */
+std::vector<TestDescr> TestDescr::Split(size_t nshards) const
+{
+    std::vector<TestDescr> shards;
+    if (nshards > max_shards) {
+        nshards = max_shards;
+    }
+    if (nshards <= 1 || split_func == nullptr) {
+        shards.push_back(*this);
+        return shards;
+    }
+    auto funcs = split_func(nshards);
+    for (size_t i = 0; i < funcs.size(); i++) {
+        shards.emplace_back(id, name, funcs[i].func, funcs[i].cost, funcs[i].words);
+        shards.back().shard_weight = 1.0 / funcs.size();
+        shards.back().shard_id = i;
+        shards.back().nshards = funcs.size();
+        shards.back().mem = mem;
+        shards.back().chunked = chunked;
+        shards.back().index = index;
+    }
+    return shards;
+}
+
+/////////////////////////////////////////////
+///// MemoryBudget class implementation /////
+/////////////////////////////////////////////
+
+/**
+ * @brief Reserves memory for the test; waits if the memory is not
+ * available yet.
+ * @param bytes  Memory estimate for the test.
+ * @return Reserved amount of memory (it is clamped to the limit),
+ * must be passed to `Release`.
+ */
+double MemoryBudget::Acquire(double bytes)
+{
+    if (limit <= 0.0 || bytes <= 0.0) {
+        return 0.0;
+    }
+    if (bytes > limit) {
+        bytes = limit;
+    }
+    std::unique_lock<std::mutex> lock(mut);
+    cv.wait(lock, [this, bytes] { return used + bytes <= limit; });
+    used += bytes;
+    return bytes;
+}
+
+/**
+ * @brief Selects the first item of the list that is not taken yet and
+ * fits into the budget, marks it as taken and reserves its memory. Items
+ * that don't fit are skipped, so the caller waits only if none of the
+ * remaining items fits.
+ * @param bytes     Memory estimates of items in the order of priority.
+ * @param taken     Flags of taken items; they must be changed only by
+ * this function while items are being selected.
+ * @param reserved  Output: reserved amount of memory (it is clamped to
+ * the limit), must be passed to `Release`.
+ * @return Index of the item or `bytes.size()` if all items are taken.
+ */
+size_t MemoryBudget::AcquireFirst(const std::vector<double> &bytes,
+    std::vector<bool> &taken, double &reserved)
+{
+    std::unique_lock<std::mutex> lock(mut);
+    while (true) {
+        bool remaining = false;
+        for (size_t i = 0; i < bytes.size(); i++) {
+            if (taken[i]) {
+                continue;
+            }
+            remaining = true;
+            double b = (limit <= 0.0 || bytes[i] <= 0.0) ? 0.0 : std::min(bytes[i], limit);
+            if (used + b <= limit || b == 0.0) {
+                taken[i] = true;
+                used += b;
+                reserved = b;
+                return i;
+            }
+        }
+        if (!remaining) {
+            reserved = 0.0;
+            return bytes.size();
+        }
+        cv.wait(lock);
+    }
+}
+
+/**
+ * @brief Returns the memory reserved by `Acquire` or `AcquireFirst`
+ * to the budget.
+ */
+void MemoryBudget::Release(double bytes)
+{
+    if (bytes <= 0.0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        used -= bytes;
+        if (used < 0.0) {
+            used = 0.0;
+        }
+    }
+    cv.notify_all();
+}
+
 //////////////////////////////////////////
 ///// TestsPull class implementation /////
 //////////////////////////////////////////
 
+/**
+ * @brief Makes the list of tests sorted in the longest-processing-time-first
+ * (LPT) order. Tests with unknown cost get the mean cost of other tests.
+ */
 TestsPull::TestsPull(const std::vector<TestDescr> &obj)
+    : calls_per_sec(0.0), seeded(false), seed(0), nshards(0), streams_log2(0),
+    regions(false), regions_limit(0), perf(false)
+{
+    size_t nknown = 0;
+    double mean_cost = 0.0;
+    for (auto &t : obj) {
+        if (t.GetCost() > 0.0) {
+            mean_cost += t.GetCost();
+            nknown++;
+        }
+    }
+    mean_cost = (nknown > 0) ? (mean_cost / nknown) : 1.0;
+    for (auto &t : obj) {
+        tests.push_back(t);
+        if (tests.back().GetCost() <= 0.0) {
+            tests.back().SetCost(mean_cost);
+            if (tests.back().GetWords() <= 0.0) {
+                tests.back().SetWords(mean_cost);
+            }
+        }
+    }
+    SortTests();
+}
+
+/**
+ * @brief Sorts tests by their cost in the descending order (LPT order).
+ * The sort is stable, i.e. tests with equal costs keep the battery order.
+ */
+void TestsPull::SortTests()
 {
-    pos = 0;
-    size_t len = obj.size();
+    size_t len = tests.size();
     std::vector<size_t> tests_inds(len);
     for (size_t i = 0; i < len; i++) {
         tests_inds[i] = i;
     }
-    std::random_device rd;
-    std::mt19937 prng(rd()); 
-    std::shuffle(tests_inds.begin(), tests_inds.end(), prng);
+    std::stable_sort(tests_inds.begin(), tests_inds.end(),
+        [this] (size_t a, size_t b) {
+            return tests[a].GetCost() > tests[b].GetCost();
+        });
 
+    std::vector<TestDescr> tests_sorted;
     for (auto ind : tests_inds) {
-        tests.push_back(obj[ind]);
+        tests_sorted.push_back(tests[ind]);
     }
+    tests = tests_sorted;
 }
 
 /**
- * @brief Returns the pointer to the next test that was not processed.
- * @param[out] pos_msg Buffer for the `test _ of _` message.
- * @return Pointer to the test (success) or nullptr (failure, i.e.
- * no more tests left).
+ * @brief Splits tests with many replications into shards, so the number
+ * of shards of one test doesn't exceed the number of threads.
+ * @param nthreads  Maximal number of shards of one test.
+ * @param jumpable  true if the generator supports jumps: only in this
+ * case tests with one replication are split into chunks.
  */
-const TestDescr *TestsPull::Get(std::string &pos_msg)
+void TestsPull::SplitTests(size_t nthreads, bool jumpable)
 {
-    std::lock_guard<std::mutex> lock(get_mutex);
-    if (pos < tests.size()) {
-        pos_msg = "test " + std::to_string(pos + 1) +
-            " of " + std::to_string(tests.size());
-        return &tests[pos++];
-    } else {
-        pos_msg = "NONE";
-        return nullptr;
+    std::vector<TestDescr> tests_split;
+    for (auto &t : tests) {
+        size_t n = (t.IsChunked() && !jumpable) ? 1 : nthreads;
+        for (auto &shard : t.Split(n)) {
+            tests_split.push_back(shard);
+        }
     }
+    tests = tests_split;
 }
 
+/**
+ * @brief Attaches the runtime history to the dispatcher.
+ * @param hist     Runtime history (may be nullptr).
+ * @param battery  Battery name used in the history keys.
+ */
+void TestsPull::SetHistory(std::shared_ptr<RuntimeHistory> hist,
+    const std::string &battery)
+{
+    history = hist;
+    history_battery = battery;
+}
 
+/**
+ * @brief Replaces the estimated costs of tests by the running times from
+ * the history. Measured times are converted to the cost units using the
+ * ratio of model costs and measured times for all tests found in the
+ * history, so tests without history records still can be compared
+ * with other tests using the cost model.
+ */
+void TestsPull::ApplyHistory()
+{
+    calls_per_sec = 0.0;
+    if (history == nullptr) {
+        return;
+    }
+    std::vector<double> wall(tests.size(), 0.0);
+    double model_sum = 0.0, wall_sum = 0.0;
+    for (size_t i = 0; i < tests.size(); i++) {
+        // Tests are identified by positions: IDs may be not unique
+        RuntimeRecord rec;
+        int test_no = (int) tests[i].GetIndex() + 1;
+        if (history->Find(history_battery, test_no, history_gen, rec) &&
+            rec.wall_sec > 0.0) {
+            wall[i] = rec.wall_sec;
+            model_sum += tests[i].GetCost();
+            wall_sum += rec.wall_sec;
+        }
+    }
+    if (wall_sum <= 0.0) {
+        return;
+    }
+    calls_per_sec = model_sum / wall_sum;
+    for (size_t i = 0; i < tests.size(); i++) {
+        if (wall[i] > 0.0) {
+            tests[i].SetCost(wall[i] * calls_per_sec);
+        }
+    }
+}
+
+/**
+ * @brief Returns the number of threads for the battery: it is limited by
+ * the size of the thread pool and by the number of tests (and shards).
+ */
 size_t TestsPull::GetNThreads() const
 {
-    size_t nthreads = std::thread::hardware_concurrency();
-    size_t ntests = tests.size();
+    size_t nthreads = pool->GetNThreads();
+    size_t ntests = 0;
+    for (auto &t : tests) {
+        ntests += t.GetMaxShards();
+    }
     while (nthreads > ntests)
         nthreads /= 2;
     return nthreads;
 }
 
+/**
+ * @brief Assigns contiguous regions of the sequence to tests and shards.
+ * Regions are placed in the order of test IDs and shard indexes, so they
+ * don't depend on the tests schedule. Lengths of regions are upper bounds
+ * of consumed outputs (see TestCbInfo) rounded up to 4096 outputs.
+ * @return Total length of regions (in outputs).
+ */
+uint64_t TestsPull::SetRegions()
+{
+    std::vector<size_t> inds(tests.size());
+    for (size_t i = 0; i < inds.size(); i++) {
+        inds[i] = i;
+    }
+    std::stable_sort(inds.begin(), inds.end(), [this] (size_t a, size_t b) {
+        const TestDescr &ta = tests[a], &tb = tests[b];
+        return (ta.GetId() != tb.GetId()) ? (ta.GetId() < tb.GetId()) :
+            (ta.GetShardId() < tb.GetShardId());
+    });
+    uint64_t offset = 0;
+    for (size_t i : inds) {
+        tests[i].SetSeed(seed);
+        tests[i].SetStream(offset);
+        uint64_t len = (uint64_t) ceil(tests[i].GetWords() / 4096.0) * 4096;
+        if (len == 0) {
+            len = 4096;
+        }
+        tests[i].SetRegionLength(len);
+        offset += len;
+    }
+    return offset;
+}
+
+/**
+ * @brief Estimates the makespan (in cost units) of the battery, i.e.
+ * simulates the dispatching of tests in the current order to `nthreads`
+ * threads. Each test is taken by the thread that becomes free first.
+ */
+double TestsPull::GetMakespan(size_t nthreads) const
+{
+    if (nthreads == 0) {
+        return 0.0;
+    }
+    std::vector<double> loads(nthreads, 0.0);
+    for (auto &t : tests) {
+        auto it = std::min_element(loads.begin(), loads.end());
+        *it += t.GetCost();
+    }
+    return *std::max_element(loads.begin(), loads.end());
+}
 
-void TestsPull::ThreadFunc(TestsPull &pull, BatteryIO &io, int thread_id)
-{
-    fprintf(stderr, "vvvvvvvvvv  Thread #%d started  vvvvvvvvvv\n", thread_id);
-    const TestDescr *test = nullptr;
-    std::string pos_msg;
-    while ((test = pull.Get(pos_msg)) != nullptr) {
-        TestDescr t = *test;
-        fprintf(stderr, "vvvvv  Thread #%d: test %s started (%s)\n",
-            thread_id, t.GetName().c_str(), pos_msg.c_str());
-        size_t ind1 = io.GetNResults();
-        t.Run(io);
-        size_t ind2 = io.GetNResults();
-        fprintf(stderr, "^^^^^  Thread #%d: test %s finished (%s)",
-            thread_id, t.GetName().c_str(), pos_msg.c_str());
-        if (ind2 > ind1) {
-            ind2--;
-            fprintf(stderr, "; p = [");
-            for (size_t i = ind1; i <= ind2; i++) {
-                fprintf(stderr, "%g ", io.GetPValueRecord(i).pvalue);
-            }
-            fprintf(stderr, "]\n");
-        } else {
-            fprintf(stderr, "\n");
+/**
+ * @brief Prints the order of tests and the estimated load balance
+ * to stderr before the battery run.
+ */
+void TestsPull::PrintSchedule(size_t nthreads) const
+{
+    double total_cost = 0.0;
+    fprintf(stderr, "=====> Tests schedule (longest first, %s)\n",
+        (calls_per_sec > 0.0) ? "runtime history" : "cost model");
+    fprintf(stderr, "  %4s %4s %-36s %14s %10s\n",
+        "#", "ID", "Name", "Cost, Mcalls", "Mem, MiB");
+    for (size_t i = 0; i < tests.size(); i++) {
+        fprintf(stderr, "  %4d %4d %-36s %14.1f %10.1f\n", (int) i + 1,
+            tests[i].GetId(), tests[i].GetName().c_str(),
+            tests[i].GetCost() / 1.0e6, tests[i].GetMem() / 1048576.0);
+        total_cost += tests[i].GetCost();
+    }
+    if (budget.GetLimit() > 0.0) {
+        fprintf(stderr, "=====> Memory limit: %.1f MiB\n",
+            budget.GetLimit() / 1048576.0);
+    }
+    if (nthreads > 0 && total_cost > 0.0) {
+        double makespan = GetMakespan(nthreads);
+        double ideal = total_cost / nthreads;
+        fprintf(stderr, "=====> Estimated makespan: %.1f Mcalls; "
+            "total/threads: %.1f Mcalls; efficiency: %.1f%%\n",
+            makespan / 1.0e6, ideal / 1.0e6, 100.0 * ideal / makespan);
+        if (calls_per_sec > 0.0) {
+            unsigned long sec = (unsigned long) (makespan / calls_per_sec + 0.5);
+            fprintf(stderr, "=====> Estimated battery time (ETA): %02lu:%02lu:%02lu\n",
+                sec / 3600, (sec / 60) % 60, sec % 60);
         }
-        
+    }
+}
 
+
+/**
+ * @brief Runs the next test from the list in the worker thread: it is
+ * the first test that wasn't started yet and fits into the memory budget
+ * (the list is in the LPT order). The worker waits only if none of the
+ * remaining tests fits.
+ * @param io         Generator and results storage of the worker.
+ * @param thread_id  Worker index.
+ */
+void TestsPull::RunTestTask(BatteryIO &io, int thread_id)
+{
+    double mem = 0.0;
+    size_t ind = budget.AcquireFirst(tests_mem, tests_taken, mem);
+    if (ind >= tests.size()) {
+        return;
+    }
+    TestDescr t = tests[ind];
+    std::string pos_msg = "test " + std::to_string(ind + 1) +
+        " of " + std::to_string(tests.size());
+    fprintf(stderr, "vvvvv  Thread #%d: test %s started (%s)\n",
+        thread_id, t.GetName().c_str(), pos_msg.c_str());
+    std::shared_ptr<UniformGenerator> worker_gen;
+    if (seeded || regions) {
+        // The new generator for each test: its output doesn't depend
+        // on the previous tests run by this worker.
+        io.SetGenerator(CreateGenerator(t.GetSeed(), t.GetStream(),
+            t.GetRegionLength()));
+    } else if (t.IsChunked() && t.GetNShards() > 1) {
+        // Chunks need the common seed: the worker generator is restored
+        // after the chunk.
+        worker_gen = io.GetGenerator();
+        io.SetGenerator(CreateGenerator(t.GetSeed(), t.GetStream()));
     }
-    fprintf(stderr, "^^^^^^^^^^  Thread #%d finished  ^^^^^^^^^^\n", thread_id);
+    size_t ind1 = io.GetNResults();
+    // Counters are opened for each test: they belong to the worker thread
+    std::unique_ptr<PerfCounters> counters((perf) ? new PerfCounters() : nullptr);
+    if (counters != nullptr) {
+        counters->Start();
+    }
+    auto tic = std::chrono::steady_clock::now();
+    double cpu_tic = RuntimeHistory::GetThreadCpuTime();
+    t.Run(io);
+    double cpu_sec = RuntimeHistory::GetThreadCpuTime() - cpu_tic;
+    double wall_sec = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - tic).count();
+    PerfCounterValues test_perf;
+    if (counters != nullptr) {
+        test_perf = counters->Stop();
+        tests_perf[ind] = test_perf;
+    }
+    budget.Release(mem);
+    if (regions) {
+        tests_overruns[ind] = io.GetGenerator()->GetRegionOverruns();
+        if (tests_overruns[ind] > 0) {
+            fprintf(stderr, "=====> WARNING: test %s (shard %d) read %llu times "
+                "beyond its sample region: its own data were reused\n",
+                t.GetName().c_str(), (int) t.GetShardId(),
+                (unsigned long long) tests_overruns[ind]);
+        }
+    }
+    if (worker_gen != nullptr) {
+        io.SetGenerator(worker_gen);
+    }
+    if (history != nullptr) {
+        // Shards are saved as estimates of the whole test
+        double w = t.GetShardWeight();
+        PerfCounterValues hist_perf = test_perf;
+        hist_perf.Scale(1.0 / w);
+        history->Update(history_battery, (int) t.GetIndex() + 1,
+            history_gen, wall_sec / w, cpu_sec / w, hist_perf);
+    }
+    size_t ind2 = io.GetNResults();
+    fprintf(stderr, "^^^^^  Thread #%d: test %s finished (%s)",
+        thread_id, t.GetName().c_str(), pos_msg.c_str());
+    if (ind2 > ind1) {
+        ind2--;
+        fprintf(stderr, "; p = [");
+        for (size_t i = ind1; i <= ind2; i++) {
+            fprintf(stderr, "%g ", io.GetPValueRecord(i).pvalue);
+        }
+        fprintf(stderr, "]\n");
+    } else {
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, "^^^^^  Thread #%d: wall time %.2f s, CPU time %.2f s\n",
+        thread_id, wall_sec, cpu_sec);
+    if (!test_perf.IsEmpty()) {
+        fprintf(stderr, "^^^^^  Thread #%d: %s\n", thread_id, test_perf.ToString().c_str());
+    }
+}
+
+
+/**
+ * @brief Creates the generator initialized by the given seed and moves it
+ * to the beginning of the given substream. Substreams have the length set
+ * by `SetStreams` or, if streams are disabled, the length of chunks of
+ * single-stream tests. In the regions mode the stream is the offset
+ * of the region (in outputs).
+ */
+std::shared_ptr<UniformGenerator> TestsPull::CreateGenerator(uint64_t gen_seed,
+    uint64_t stream, uint64_t region_len)
+{
+    Entropy::SetThreadSeed(gen_seed);
+    auto gen = create_gen();
+    Entropy::ResetThreadSeed();
+    if (regions) {
+        gen->SetRegion(stream, region_len);
+    } else if (stream != 0) {
+        gen->SetStream(stream, (streams_log2 > 0) ? streams_log2 : CHUNK_LOG2);
+    }
+    return gen;
 }
 
 
@@ -488,50 +1014,230 @@ BatteryResults TestsPull::Run(std::function<std::shared_ptr<UniformGenerator>()>
 {
     // Timers and threads number
     chrono_Chrono *timer = chrono_Create();
+    if (pool == nullptr) {
+        pool = ThreadPool::GetGlobal();
+    }
     size_t nthreads = GetNThreads();
     fprintf(stderr, "=====> Number of threads: %d\n", (int) nthreads);
     BatteryResults results(nthreads);
-    std::vector<BatteryIO> threads_bats;
+    this->create_gen = create_gen;
+    // Substreams and chunks of single-stream tests: generators get the same
+    // base seed, so the generator must support jumps. The seed is taken from
+    // the probe generator if the master seed is not set.
+    bool has_chunks = false;
+    for (auto &t : tests) {
+        has_chunks = has_chunks || (t.IsChunked() && t.GetMaxShards() > 1);
+    }
+    bool jumpable = false;
+    uint64_t streams_seed = 0;
+    unsigned int period_log2 = 0;
+    if (streams_log2 > 0 || has_chunks || regions) {
+        auto probe = create_gen();
+        jumpable = probe->Jump(0);
+        period_log2 = probe->GetPeriodLog2();
+        streams_seed = (seeded) ? Entropy::DeriveSeed(seed, 0, 0) : probe->GetBits64();
+    }
+    if (regions && !jumpable) {
+        fprintf(stderr, "=====> Generator doesn't support jumps: regions are disabled\n");
+        regions = false;
+    }
+    if (regions) {
+        streams_log2 = 0;
+    }
+    // Substreams: tests and shards first (by positions in the battery),
+    // then workers. They must fit into the period, otherwise they overlap.
+    size_t nshards_max = (nshards > 0) ? nshards : nthreads;
+    size_t ntests_bat = 0;
+    for (auto &t : tests) {
+        ntests_bat = std::max(ntests_bat, t.GetIndex() + 1);
+    }
+    uint64_t workers_stream = (uint64_t) ntests_bat * nshards_max;
+    std::string warnings;
+    if (streams_log2 > 0 && jumpable && period_log2 > 0) {
+        uint64_t nstreams = workers_stream + nthreads;
+        unsigned int count_log2 = 0;
+        while (count_log2 < 64 && (1ull << count_log2) < nstreams) {
+            count_log2++;
+        }
+        if (streams_log2 + count_log2 > period_log2) {
+            char buf[256];
+            unsigned int fit_log2 = (period_log2 > count_log2) ? (period_log2 - count_log2) : 0;
+            snprintf(buf, 256, "ERROR: %llu substreams of 2^%u outputs exceed the "
+                "period 2^%u of the generator: ", (unsigned long long) nstreams,
+                streams_log2, period_log2);
+            fprintf(stderr, "=====> %s", buf);
+            warnings += buf;
+            if (fit_log2 > 0) {
+                snprintf(buf, 256, "substreams are shortened to 2^%u outputs\n", fit_log2);
+            } else {
+                snprintf(buf, 256, "substreams are disabled\n");
+            }
+            fprintf(stderr, "%s", buf);
+            warnings += buf;
+            streams_log2 = fit_log2;
+        }
+    }
+    if (streams_log2 > 0 && jumpable) {
+        fprintf(stderr, "=====> Substreams of 2^%u outputs, base seed: 0x%16.16llX\n",
+            streams_log2, (unsigned long long) streams_seed);
+    } else if (streams_log2 > 0) {
+        fprintf(stderr, "=====> Generator doesn't support jumps: streams are disabled\n");
+        streams_log2 = 0;
+    }
+    if (has_chunks && !jumpable) {
+        fprintf(stderr, "=====> Generator doesn't support jumps: "
+            "single-stream tests are not split\n");
+    }
+    results.streams_log2 = streams_log2;
+    // Generators are created by workers that will use them: their memory
+    // is first touched on the right NUMA node. They are created one by one
+    // to keep the order of seeds in the seeds log. With streams each worker
+    // gets its own substream after substreams of tests.
+    std::vector<std::unique_ptr<BatteryIO>> threads_bats(nthreads);
     for (size_t i = 0; i < nthreads; i++) {
-        threads_bats.emplace_back(create_gen());
+        pool->SubmitPinned([this, &threads_bats, &create_gen, streams_seed,
+            workers_stream] (size_t worker_id) {
+            if (streams_log2 > 0) {
+                threads_bats[worker_id].reset(new BatteryIO(
+                    CreateGenerator(streams_seed, workers_stream + worker_id)));
+            } else {
+                threads_bats[worker_id].reset(new BatteryIO(create_gen()));
+            }
+        }, i);
+        pool->Wait();
+    }
+    // Tests order: from the runtime history or from the cost model
+    if (history != nullptr && nthreads > 0) {
+        history_gen = threads_bats[0]->Gen()->name;
+        ApplyHistory();
+    }
+    SplitTests(nshards_max, jumpable);
+    SortTests();
+    PrintSchedule(nthreads);
+    // Seeds of tests: they don't depend on the tests order. Chunks of
+    // single-stream tests share the seed of the test and differ by substreams.
+    results.nshards = nshards_max;
+    if (seeded) {
+        fprintf(stderr, "=====> Master seed: 0x%16.16llX\n", (unsigned long long) seed);
+        results.seeded = true;
+        results.seed = seed;
+    }
+    if (regions) {
+        uint64_t nsamples = SetRegions();
+        fprintf(stderr, "=====> Sample regions: %.4g outputs in total\n", (double) nsamples);
+        if (regions_limit > 0 && nsamples > regions_limit) {
+            char buf[256];
+            snprintf(buf, 256, "WARNING: sample regions need %.4g outputs but the source "
+                "has only %.4g:\n  regions of different tests overlap, p-values "
+                "are not reliable\n", (double) nsamples, (double) regions_limit);
+            fprintf(stderr, "=====> %s", buf);
+            warnings += buf;
+        }
+    }
+    uint64_t chunks_seed = (seeded) ? seed : streams_seed;
+    for (auto &t : tests) {
+        if (regions) {
+            if (seeded) {
+                results.test_seeds.emplace_back(t.GetId(), t.GetShardId(),
+                    t.GetNShards(), t.GetSeed(), t.GetStream());
+            }
+            continue;
+        }
+        bool is_chunk = t.IsChunked() && t.GetNShards() > 1;
+        if (streams_log2 > 0) {
+            // The same seed, but own substream for each test and shard
+            t.SetSeed(streams_seed);
+            t.SetStream((uint64_t) t.GetIndex() * nshards_max + t.GetShardId());
+        } else if (is_chunk) {
+            t.SetSeed(Entropy::DeriveSeed(chunks_seed, (uint64_t) t.GetId(), 0));
+            t.SetStream(t.GetShardId());
+        } else if (seeded) {
+            t.SetSeed(Entropy::DeriveSeed(seed, (uint64_t) t.GetId(), t.GetShardId()));
+        }
+        if (seeded) {
+            results.test_seeds.emplace_back(t.GetId(), t.GetShardId(),
+                t.GetNShards(), t.GetSeed(), t.GetStream());
+        }
     }
+    if (perf && !PerfCounters::IsAvailable()) {
+        perf = false;
+    }
+    tests_perf.assign(tests.size(), PerfCounterValues());
+    tests_overruns.assign(tests.size(), 0);
+    tests_mem.resize(tests.size());
+    for (size_t i = 0; i < tests.size(); i++) {
+        tests_mem[i] = tests[i].GetMem();
+    }
+    tests_taken.assign(tests.size(), false);
     // Disable thread unsafe features of TestU01
     swrite_Host = FALSE;
-    // Multi-threaded run
+    // Multi-threaded run: one task for the pool per test, each task takes
+    // the next test that fits into the memory budget. Each worker uses its
+    // own generator.
     auto tic = std::chrono::high_resolution_clock::now();
-    std::vector<std::thread> threads;
-    for (size_t i = 0; i < nthreads; i++) {
-        threads.emplace_back(ThreadFunc,
-            std::ref(*this),
-            std::ref(threads_bats[i]),
-            i);
+    std::vector<PoolTask> tasks;
+    for (size_t i = 0; i < tests.size(); i++) {
+        tasks.push_back([this, &threads_bats] (size_t worker_id) {
+            RunTestTask(*threads_bats[worker_id], (int) worker_id);
+        });
     }
-    for (auto &th : threads) {
-        th.join();
+    TaskGroup group;
+    pool->SetNActive(nthreads);
+    pool->Submit(group, tasks);
+    pool->Wait(group);
+    for (size_t i = 0; i < tests.size(); i++) {
+        if (!tests_perf[i].IsEmpty()) {
+            results.test_perf.emplace_back(tests[i].GetId(), tests[i].GetShardId(),
+                tests_perf[i]);
+        }
     }
     // Save p-values from different threads to output array
     // (it preserves an exact order of calls).
     for (size_t i = 0; i < threads_bats.size(); i++) {
-        for (size_t j = 0; j < threads_bats[i].GetNResults(); j++) {
-            results.pvalues[i].push_back(threads_bats[i].GetPValueRecord(j));
+        BatteryIO &bat = *threads_bats[i];
+        for (size_t j = 0; j < bat.GetNResults(); j++) {
+            results.pvalues[i].push_back(bat.GetPValueRecord(j));
         }
     }
     // Merge results from different threads.
     const char *gen_name;
     if (nthreads > 0) {
-        gen_name = threads_bats[0].Gen()->name;
+        gen_name = threads_bats[0]->Gen()->name;
     } else {
         gen_name = "Dummy";
     }
     BatteryIO io(std::make_shared<DummyGenerator>());
     for (auto &bat : threads_bats) {
-        io.Add(bat);
+        io.Add(*bat);
     }
     // Estimate the elapsed time
     auto toc = std::chrono::high_resolution_clock::now();    
     size_t ms_total = std::chrono::duration_cast<std::chrono::milliseconds>(toc - tic).count();
     // Print report
     results.report = io.WriteReport(battery_name.c_str(), gen_name, timer, ms_total);
+    size_t noverruns = std::count_if(tests_overruns.begin(), tests_overruns.end(),
+        [] (uint64_t n) { return n > 0; });
+    if (noverruns > 0) {
+        warnings += "WARNING: " + std::to_string(noverruns) +
+            " tests or shards read beyond their sample regions\n";
+    }
+    // Chunked tests are valid but their p-values differ from serial runs
+    std::vector<std::string> chunked_names;
+    for (auto &t : tests) {
+        if (t.IsChunked() && t.GetNShards() > 1 && t.GetShardId() == 0) {
+            chunked_names.push_back(t.GetName());
+        }
+    }
+    if (!chunked_names.empty()) {
+        std::string names;
+        for (auto &name : chunked_names) {
+            names += (names.empty() ? "" : ", ") + name;
+        }
+        warnings += "NOTE: tests split into chunks (" + names + ") don't reproduce\n"
+            "  p-values of the serial TestU01 run: chunks are separate substreams\n"
+            "  and classes of the chi-square statistic are merged per chunk\n";
+    }
+    results.report += warnings;
     chrono_Delete(timer);
     return results;
 }
@@ -543,7 +1249,8 @@ BatteryResults TestsPull::Run(std::function<std::shared_ptr<UniformGenerator>()>
 
 
 TestsBattery::TestsBattery(GenFactoryFunc genf)
-    : create_gen(genf)
+    : create_gen(genf), mem_limit(0.0), seeded(false), seed(0), nshards(0),
+    streams_log2(0), regions(false), regions_limit(0), perf(false)
 {
 }
 
@@ -558,7 +1265,21 @@ BatteryResults TestsBattery::Run() const
         "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n\n\n",
         battery_name.c_str(), PACKAGE_STRING);
 
-    TestsPull pull(tests);
+    std::vector<TestDescr> t = tests;
+    for (size_t i = 0; i < t.size(); i++) {
+        t[i].SetIndex(i);
+    }
+    TestsPull pull(t);
+    pull.SetHistory(history, battery_name);
+    pull.SetThreadPool(pool);
+    pull.SetMemLimit(mem_limit);
+    pull.SetNShards(nshards);
+    pull.SetStreams(streams_log2);
+    pull.SetSampleRegions(regions, regions_limit);
+    pull.SetPerfCounters(perf);
+    if (seeded) {
+        pull.SetSeed(seed);
+    }
     return pull.Run(create_gen, battery_name);
 }
 
@@ -576,8 +1297,10 @@ BatteryResults TestsBattery::RunTest(int id) const
     std::vector<TestDescr> t;
     BatteryResults results(1);
     for (size_t i = 0; i < tests.size(); i++) {
-        if (tests[i].GetId() == id)
+        if (tests[i].GetId() == id) {
             t.push_back(tests[i]);
+            t.back().SetIndex(i);
+        }
     }
     if (t.size() == 0) {
         return results;
@@ -589,6 +1312,16 @@ BatteryResults TestsBattery::RunTest(int id) const
         battery_name.c_str(), id, PACKAGE_STRING);
 
     TestsPull pull(t);
+    pull.SetHistory(history, battery_name);
+    pull.SetThreadPool(pool);
+    pull.SetMemLimit(mem_limit);
+    pull.SetNShards(nshards);
+    pull.SetStreams(streams_log2);
+    pull.SetSampleRegions(regions, regions_limit);
+    pull.SetPerfCounters(perf);
+    if (seeded) {
+        pull.SetSeed(seed);
+    }
     return pull.Run(create_gen, battery_name + " test " + std::to_string(id));
 }
 
@@ -659,20 +1392,25 @@ void set_bin_stdin()
 }
 
 
+/**
+ * @brief Writes an output of the generator to the stdout by StreamWriter
+ * with one generator thread (without length limit).
+ */
+static void prng_to_stdout(std::shared_ptr<UniformGenerator> genptr, StreamFormat format)
+{
+    set_bin_stdout();
+    fflush(stdout);
+    StreamWriter writer([genptr] { return genptr; }, format);
+    writer.Run(fileno(stdout));
+}
+
 /**
  * @brief Dump an output of a 32-bit PRNG to the stdout in the format suitable
  * for PractRand.
  */
 void prng_bits32_to_file(std::shared_ptr<UniformGenerator> genptr)
 {
-    uint32_t buf[256];
-    set_bin_stdout();
-    while (1) {
-        for (size_t i = 0; i < 256; i++) {
-            buf[i] = genptr->GetBits32();
-        }
-        fwrite(buf, sizeof(uint32_t), 256, stdout);
-    }
+    prng_to_stdout(genptr, STREAM_BITS32);
 }
 
 /**
@@ -681,13 +1419,7 @@ void prng_bits32_to_file(std::shared_ptr<UniformGenerator> genptr)
  */
 void prng_array32_to_file(std::shared_ptr<UniformGenerator> genptr)
 {
-    constexpr size_t len = 1024;
-    uint32_t buf[len];
-    set_bin_stdout();
-    while (1) {
-        genptr->GetArray32(buf, len);
-        fwrite(buf, sizeof(uint32_t), len, stdout);
-    }
+    prng_to_stdout(genptr, STREAM_ARRAY32);
 }
 
 /**
@@ -696,14 +1428,7 @@ void prng_array32_to_file(std::shared_ptr<UniformGenerator> genptr)
  */
 void prng_bits64_to_file(std::shared_ptr<UniformGenerator> genptr)
 {
-    uint64_t buf[256];
-    set_bin_stdout();
-    while (1) {
-        for (int i = 0; i < 256; i++) {
-            buf[i] = genptr->GetBits64();
-        }
-        fwrite(buf, sizeof(uint64_t), 256, stdout);
-    }
+    prng_to_stdout(genptr, STREAM_BITS64);
 }
 
 
@@ -713,13 +1438,7 @@ void prng_bits64_to_file(std::shared_ptr<UniformGenerator> genptr)
  */
 void prng_array64_to_file(std::shared_ptr<UniformGenerator> genptr)
 {
-    constexpr size_t len = 1024;
-    uint64_t buf[len];
-    set_bin_stdout();
-    while (1) {
-        genptr->GetArray64(buf, len);
-        fwrite(buf, sizeof(uint32_t), len, stdout);
-    }
+    prng_to_stdout(genptr, STREAM_ARRAY64);
 }
 
 
@@ -729,141 +1448,394 @@ void prng_array64_to_file(std::shared_ptr<UniformGenerator> genptr)
 ///// Functions that generate callbacks for tests /////
 ///////////////////////////////////////////////////////
 
+/**
+ * @brief Binary logarithm used in the costs of tests that sort
+ * or search n points. Returns 1 for small n.
+ */
+static inline double log2_cost(double n)
+{
+    return (n > 2.0) ? log2(n) : 1.0;
+}
+
+/**
+ * @brief Estimated memory (bytes) for tables of counters for n points
+ * in k cells used by smultin module: dense table of counters for small k
+ * or hashing table with about 2n cells for large k.
+ */
+static inline double multin_mem(double n, double k)
+{
+    return 8.0 * std::min(k, 2.0 * n);
+}
+
+/**
+ * @brief Upper bound of outputs consumed by the test with a random
+ * sample length: the mean plus 10 standard deviations and a margin.
+ */
+static inline double random_words(double mean, double var)
+{
+    return ceil(mean + 10.0 * sqrt(var)) + 1024.0;
+}
+
 
-TestCbFunc svaria_AppearanceSpacings_cb(long N, long Q, long K, int r, int s, int L)
+TestCbInfo svaria_AppearanceSpacings_cb(long N, long Q, long K, int r, int s, int L)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) (Q + K) * L / s;
+    // Blocks shorter than s bits still use one output each
+    double words = N * (double) (Q + K) * ceil((double) L / s);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Basic *res = sres_CreateBasic();
         svaria_AppearanceSpacings(io.Gen(), res, N, Q, K, r, s, L);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteBasic(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc sstring_AutoCor_cb(long N, long n, int r, int s, int d)
+TestCbInfo sstring_AutoCor_cb(long N, long n, int r, int s, int d)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n / s;
+    double words = N * (ceil((double) (n + d) / s) + 1.0);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Basic *res = sres_CreateBasic();
         sstring_AutoCor(io.Gen(), res, N, n, r, s, d);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Sum]);
         sres_DeleteBasic(res);
+    }, cost).SetWords(words);
+}
+
+/**
+ * @brief Accumulates the results of shards of the test with Poisson
+ * statistic: the sum of N independent Poisson variables with means
+ * Mu_i is also a Poisson variable with mean sum(Mu_i).
+ */
+class PoissonShardsMerger
+{
+    std::mutex mut;
+    double mu; ///< Sum of expected values.
+    long sum; ///< Sum of observed values.
+    size_t nleft; ///< Number of shards that are not finished yet.
+
+public:
+    PoissonShardsMerger(size_t nshards) : mu(0.0), sum(0), nleft(nshards) {}
+
+    /**
+     * @brief Adds the result of one shard.
+     * @param[out] pvalue  Final p-value (only if true is returned).
+     * @return true if it was the last shard, false otherwise.
+     */
+    bool Add(const sres_Poisson *res, double &pvalue)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        mu += res->Mu;
+        sum += (long) (res->sVal2 + 0.5);
+        if (--nleft > 0) {
+            return false;
+        }
+        pvalue = gofw_pDisc(fdist_Poisson1(mu, sum), fbar_Poisson1(mu, sum));
+        return true;
+    }
+};
+
+/**
+ * @brief Function that runs the test with Poisson statistic
+ * for N replications and returns its results.
+ */
+typedef std::function<void(unif01_Gen *gen, long N, sres_Poisson *res)> PoissonRunFunc;
+
+/**
+ * @brief Makes the function that splits the test with Poisson statistic
+ * and N replications into shards with smaller N.
+ * @param cost   Cost of the whole test.
+ * @param words  Upper bound of outputs consumed by the whole test.
+ */
+static TestSplitFunc poisson_split(long N, double cost, double words,
+    PoissonRunFunc run_func)
+{
+    return [=] (size_t nshards) {
+        std::vector<TestCbInfo> shards;
+        auto merger = std::make_shared<PoissonShardsMerger>(nshards);
+        for (size_t i = 0; i < nshards; i++) {
+            long Ni = N / nshards + ((long) i < (long) (N % nshards));
+            shards.push_back(TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
+                sres_Poisson *res = sres_CreatePoisson();
+                run_func(io.Gen(), Ni, res);
+                double pvalue;
+                if (merger->Add(res, pvalue)) {
+                    io.Add(td.GetId(), td.GetName(), pvalue);
+                }
+                sres_DeletePoisson(res);
+            }, cost * Ni / N).SetWords(words * Ni / N));
+        }
+        return shards;
     };
 }
 
-TestCbFunc smarsa_BirthdaySpacings_cb(long N, long n, int r, long d, int t, int p)
+/**
+ * @brief Accumulates the counters of chunks of the chi-square test with
+ * one replication. Chunks are substreams of one sequence (2^40 outputs
+ * apart by default, see `TestsPull::CreateGenerator`) or sample regions,
+ * i.e. they are not contiguous segments of the serial sample.
+ * @details All chunks must have the same size: then they have the same
+ * classes. TestU01 merges classes with small expected counts using the
+ * sample size of the chunk (n/K), so classes may be coarser than for
+ * the whole sample. The merged statistic is a valid chi-square statistic,
+ * but its p-value is not identical to the one of the serial run.
+ */
+class Chi2ChunksMerger
+{
+    std::mutex mut;
+    std::vector<double> nbexp; ///< Expected numbers of observations.
+    std::vector<long> count; ///< Observed numbers.
+    long jmin, jmax, degfree; ///< Classes (from the first chunk).
+    size_t nleft; ///< Number of chunks that are not finished yet.
+
+public:
+    Chi2ChunksMerger(size_t nchunks)
+        : jmin(0), jmax(-1), degfree(0), nleft(nchunks) {}
+
+    /**
+     * @brief Adds the result of one chunk.
+     * @param[out] pvalue  Final p-value (only if true is returned).
+     * @return true if it was the last chunk, false otherwise.
+     */
+    bool Add(const sres_Chi2 *res, double &pvalue)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (jmax < jmin) {
+            jmin = res->jmin;
+            jmax = res->jmax;
+            degfree = res->degFree;
+            nbexp.assign(jmax + 1, 0.0);
+            count.assign(jmax + 1, 0);
+        }
+        for (long j = jmin; j <= jmax; j++) {
+            nbexp[j] += res->NbExp[j];
+            count[j] += res->Count[j];
+        }
+        if (--nleft > 0) {
+            return false;
+        }
+        double x2 = gofs_Chi2(nbexp.data(), count.data(), jmin, jmax);
+        pvalue = fbar_ChiSquare2(degfree, 12, x2);
+        return true;
+    }
+};
+
+/**
+ * @brief Function that runs the chi-square test with one replication
+ * for the sample of n elements and returns its results.
+ */
+typedef std::function<void(unif01_Gen *gen, long n, sres_Chi2 *res)> Chi2RunFunc;
+
+/**
+ * @brief Maximal number of chunks for the test with one replication:
+ * samples shorter than 10^7 are not split.
+ */
+static inline size_t chunks_max(long n)
+{
+    return (n > 10 * MILLION) ? (size_t) (n / (10 * MILLION)) : 1;
+}
+
+/**
+ * @brief Makes the function that splits the chi-square test with one
+ * replication and the sample size n into chunks. The number of chunks
+ * is decreased to the divisor of n, so all chunks are of the same size.
+ * @param cost        Cost of the whole test.
+ * @param words_func  Upper bound of consumed outputs for the sample size.
+ */
+static TestSplitFunc chi2_chunks_split(long n, double cost,
+    std::function<double(long)> words_func, Chi2RunFunc run_func)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    return [=] (size_t nshards) {
+        while (nshards > 1 && n % (long) nshards != 0) {
+            nshards--;
+        }
+        std::vector<TestCbInfo> shards;
+        auto merger = std::make_shared<Chi2ChunksMerger>(nshards);
+        long ni = n / (long) nshards;
+        for (size_t i = 0; i < nshards; i++) {
+            shards.push_back(TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
+                sres_Chi2 *res = sres_CreateChi2();
+                run_func(io.Gen(), ni, res);
+                double pvalue;
+                if (merger->Add(res, pvalue)) {
+                    io.Add(td.GetId(), td.GetName(), pvalue);
+                }
+                sres_DeleteChi2(res);
+            }, cost / nshards).SetWords(words_func(ni)));
+        }
+        return shards;
+    };
+}
+
+TestCbInfo smarsa_BirthdaySpacings_cb(long N, long n, int r, long d, int t, int p)
+{
+    double cost = N * (double) n * (t + log2_cost(n));
+    double words = N * (double) n * t;
+    double mem = 16.0 * n;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Poisson *res = sres_CreatePoisson();
         smarsa_BirthdaySpacings(io.Gen(), res, N, n, r, d, t, p);
         io.Add(td.GetId(), td.GetName(), res->pVal2);
         sres_DeletePoisson(res);
-    };
+    }, cost, poisson_split(N, cost, words, [=] (unif01_Gen *gen, long Ni, sres_Poisson *res) {
+        smarsa_BirthdaySpacings(gen, res, Ni, n, r, d, t, p);
+    }), N).SetMem(mem).SetWords(words);
 }
 
-TestCbFunc smarsa_CollisionOver_cb(long N, long n, int r, long d, int t)
+TestCbInfo smarsa_CollisionOver_cb(long N, long n, int r, long d, int t)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = 2.0 * N * n;
+    double words = N * ((double) n + t);
+    double mem = multin_mem(n, pow((double) d, t));
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         smarsa_Res *res = smarsa_CreateRes();
         smarsa_CollisionOver (io.Gen(), res, N, n, r, d, t);
         io.Add(td.GetId(), td.GetName(), res->Pois->pVal2);
         smarsa_DeleteRes(res);
-    };
+    }, cost, poisson_split(N, cost, words, [=] (unif01_Gen *gen, long Ni, sres_Poisson *res) {
+        smarsa_Res *sres = smarsa_CreateRes();
+        smarsa_CollisionOver(gen, sres, Ni, n, r, d, t);
+        res->Mu = sres->Pois->Mu;
+        res->sVal2 = sres->Pois->sVal2;
+        smarsa_DeleteRes(sres);
+    }), N).SetMem(mem).SetWords(words);
 }
 
-TestCbFunc sknuth_CollisionPermut_cb(long N, long n, int r, int t)
+TestCbInfo sknuth_CollisionPermut_cb(long N, long n, int r, int t)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = 2.0 * N * n * t;
+    double words = N * (double) n * t;
+    double mem = multin_mem(n, tgamma(t + 1.0));
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sknuth_Res2 *res = sknuth_CreateRes2 ();
         sknuth_CollisionPermut(io.Gen(), res, N, n, r, t);
         io.Add(td.GetId(), td.GetName(), res->Pois->pVal2);
         sknuth_DeleteRes2 (res);
-    };
+    }, cost).SetWords(words).SetMem(mem);
 }
 
-TestCbFunc sknuth_CouponCollector_cb(long N, long n, int r, int d)
+TestCbInfo sknuth_CouponCollector_cb(long N, long n, int r, int d)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * d * (log((double) d) + 0.5772);
+    // Each of N*n segments: mean d*H_d, variance below (pi*d)^2/6 = 1.645*d^2
+    double harm = 0.0;
+    for (int i = 1; i <= d; i++) {
+        harm += 1.0 / i;
+    }
+    double words = random_words(N * (double) n * d * harm,
+        N * (double) n * d * d * 1.645);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         auto *res2 = sres_CreateChi2 ();
         sknuth_CouponCollector (io.Gen(), res2, N, n, r, d);
         io.Add(td.GetId(), td.GetName(), res2->pVal2[gofw_Mean]);
         sres_DeleteChi2(res2);
-    };
+    }, cost).SetWords(words);
 }
 
 
-TestCbFunc snpair_ClosePairs_cb(long N, long n, int r, int k, int p, int m, const std::string &mess, bool flag)
+TestCbInfo snpair_ClosePairs_cb(long N, long n, int r, int k, int p, int m, const std::string &mess, bool flag)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * k * (1.0 + log2_cost(n));
+    double words = N * (double) n * k;
+    double mem = 16.0 * n * k;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         snpair_Res *res = snpair_CreateRes();
         snpair_ClosePairs(io.Gen(), res, N, n, r, k, p, m);
         GetPValue_CPairs(io, 10, res, td.GetId(), mess, flag);
         snpair_DeleteRes(res);
-    };
+    }, cost).SetMem(mem).SetWords(words);
 }
 
 /**
  * @brief Needed for pseudoDIEHARD battery.
  */
-TestCbFunc snpair_ClosePairsNP_cb(long N, long n, int r, int k, int p, int m)
+TestCbInfo snpair_ClosePairsNP_cb(long N, long n, int r, int k, int p, int m)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * k * (1.0 + log2_cost(n));
+    double words = N * (double) n * k;
+    double mem = 16.0 * n * k;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         snpair_Res *res = snpair_CreateRes();
         snpair_ClosePairs(io.Gen(), res, N, n, r, k, p, m);
         io.Add(td.GetId(), td.GetName(), res->pVal[snpair_NP]);
         snpair_DeleteRes(res);
-    };
+    }, cost).SetMem(mem).SetWords(words);
 }
 
-TestCbFunc snpair_ClosePairsBitMatch_cb(long N, long n, int r, int t)
+TestCbInfo snpair_ClosePairsBitMatch_cb(long N, long n, int r, int t)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * (t + log2_cost(n));
+    double words = N * (double) n * t;
+    double mem = 16.0 * n;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         snpair_Res *res = snpair_CreateRes();
         snpair_ClosePairsBitMatch(io.Gen(), res, N, n, r, t);
         io.Add(td.GetId(), td.GetName(), res->pVal[snpair_BM]);
         snpair_DeleteRes(res);
-    };
+    }, cost).SetMem(mem).SetWords(words);
 }
 
 /**
  * @brief An envelope for smarsa_CollisionOver for pseudoDIEHARD battery.
  */
-TestCbFunc smarsa_Dna_cb(int i)
+TestCbInfo smarsa_Dna_cb(int i)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = 2.0 * 2097152;
+    double mem = multin_mem(2097152, 1048576);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         printf ("***********************************************************\n"
             "Test DNA calling smarsa_CollisionOver\n\n");
         smarsa_Res *res = smarsa_CreateRes();
         smarsa_CollisionOver(io.Gen(), res, 1, 2097152, i, 4, 10);
         io.Add(td.GetId(), td.GetName(), res->Bas->pVal2[gofw_Mean]);
         smarsa_DeleteRes(res);
-    };
+    }, cost).SetMem(mem).SetWords(2097152.0 + 10);
 }
 
-TestCbFunc sspectral_Fourier3_cb(long N, int k, int r, int s)
+TestCbInfo sspectral_Fourier3_cb(long N, int k, int r, int s)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * pow(2.0, k) * (1.0 / s + k);
+    double words = N * ceil(pow(2.0, k) / s);
+    double mem = 16.0 * pow(2.0, k);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sspectral_Res *res = sspectral_CreateRes();
         sspectral_Fourier3(io.Gen(), res, N, k, r, s);
         io.Add(td.GetId(), td.GetName(), res->Bas->pVal2[gofw_AD]);
         sspectral_DeleteRes(res);
-    };
+    }, cost).SetMem(mem).SetWords(words);
 }
 
 
-TestCbFunc sknuth_Gap_cb(long N, long n, int r, double Alpha, double Beta)
+TestCbInfo sknuth_Gap_cb(long N, long n, int r, double Alpha, double Beta)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n / (Beta - Alpha);
+    // The number of outputs for n gaps has the negative binomial distribution
+    auto words_func = [=] (long ni) {
+        double p = Beta - Alpha;
+        return random_words(N * (double) ni / p, N * (double) ni * (1.0 - p) / (p * p));
+    };
+    auto func = [=] (TestDescr &td, BatteryIO &io) {
         sres_Chi2 *res = sres_CreateChi2();
         sknuth_Gap(io.Gen(), res, N, n, r, Alpha, Beta);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteChi2(res);
     };
+    if (N != 1) {
+        return TestCbInfo(func, cost).SetWords(words_func(n));
+    }
+    return TestCbInfo(func, cost, chi2_chunks_split(n, cost, words_func, [=] (unif01_Gen *gen, long ni, sres_Chi2 *res) {
+        sknuth_Gap(gen, res, 1, ni, r, Alpha, Beta);
+    }), chunks_max(n)).SetChunked().SetWords(words_func(n));
 }
 
 
-TestCbFunc smarsa_GCD_cb(long N, long n, int r, int s)
+TestCbInfo smarsa_GCD_cb(long N, long n, int r, int s)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * (2.0 + 0.6 * s);
+    // Zero integers are rejected
+    double words = random_words(2.0 * N * n / (1.0 - ldexp(1.0, -s)),
+        2.0 * N * n * ldexp(1.0, -s));
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         smarsa_Res2 *res = smarsa_CreateRes2();
         smarsa_GCD (io.Gen(), res, N, n, r, s);
         if (N == 1)
@@ -871,24 +1843,28 @@ TestCbFunc smarsa_GCD_cb(long N, long n, int r, int s)
         else
             io.Add(td.GetId(), td.GetName(), res->GCD->pVal2[gofw_Sum]);
         smarsa_DeleteRes2(res);
-    };
+    }, cost).SetWords(words);
 }
 
 
-TestCbFunc sstring_HammingCorr_cb(long N, long n, int r, int s, int L)
+TestCbInfo sstring_HammingCorr_cb(long N, long n, int r, int s, int L)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * L / s;
+    double words = N * (double) n * ceil((double) L / s);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sstring_Res *res = sstring_CreateRes();
         sstring_HammingCorr(io.Gen(), res, N, n, r, s, L);
         io.Add(td.GetId(), td.GetName(), res->Bas->pVal2[gofw_Mean]);
         sstring_DeleteRes(res);
 
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc sstring_HammingIndep_cb(long N, long n, int r, int s, int L, int d)
+TestCbInfo sstring_HammingIndep_cb(long N, long n, int r, int s, int L, int d)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = 2.0 * N * n * L / s;
+    double words = 2.0 * N * n * ceil((double) L / s);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sstring_Res *res = sstring_CreateRes();
         sstring_HammingIndep(io.Gen(), res, N, n, r, s, L, d);
         if (N == 1)
@@ -896,57 +1872,68 @@ TestCbFunc sstring_HammingIndep_cb(long N, long n, int r, int s, int L, int d)
         else
             io.Add(td.GetId(), td.GetName(), res->Bas->pVal2[gofw_Sum]);
         sstring_DeleteRes(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc sstring_HammingWeight2_cb(long N, int r, int s, long L, long K)
+TestCbInfo sstring_HammingWeight2_cb(long N, int r, int s, long L, long K)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    // The arguments are sent to TestU01 as (N, n, r, s, L)
+    double cost = N * (double) r / L;
+    double words = N * (ceil((double) r / L) + ceil((double) K / L) + 1.0);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Basic *res = sres_CreateBasic();
         sstring_HammingWeight2(io.Gen(), res, N, r, s, L, K);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Sum]);
         sres_DeleteBasic (res);
-    };
+    }, cost).SetWords(words);
 }
 
 
-TestCbFunc scomp_LempelZiv_cb(long N, int t, int r, int s)
+TestCbInfo scomp_LempelZiv_cb(long N, int t, int r, int s)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * pow(2.0, t) * (1.0 / s + t);
+    double words = N * ceil(pow(2.0, t) / s);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Basic *res = sres_CreateBasic();
         scomp_LempelZiv(io.Gen(), res, N, t, r, s);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Sum]);
         sres_DeleteBasic(res);
-    };
+    }, cost).SetWords(words);
 }
 
 
-TestCbFunc scomp_LinearComp_cb(long N, long n, int r, int s)
+TestCbInfo scomp_LinearComp_cb(long N, long n, int r, int s)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * (1.0 / s + n / 64.0);
+    double words = N * ceil((double) n / s);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         scomp_Res *res = scomp_CreateRes();
         scomp_LinearComp(io.Gen(), res, N, n, r, s);
         io.Add(td.GetId(), td.GetName(), res->JumpNum->pVal2[gofw_Mean]);
         io.Add(td.GetId(), td.GetName(), res->JumpSize->pVal2[gofw_Mean]);
         scomp_DeleteRes(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc sstring_LongestHeadRun_cb(long N, long n, int r, int s, long L)
+TestCbInfo sstring_LongestHeadRun_cb(long N, long n, int r, int s, long L)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * L / s;
+    double words = N * (double) n * ceil((double) L / s);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sstring_Res2 *res = sstring_CreateRes2();
         sstring_LongestHeadRun(io.Gen(), res, N, n, r, s, L);
         io.Add(td.GetId(), td.GetName(), res->Chi->pVal2[gofw_Mean]);
         io.Add(td.GetId(), td.GetName(), res->Disc->pVal2);
         sstring_DeleteRes2(res);
-    };
+    }, cost).SetWords(words);
 }
 
 
-TestCbFunc smarsa_MatrixRank_cb(long N, long n, int r, int s, int L, int k)
+TestCbInfo smarsa_MatrixRank_cb(long N, long n, int r, int s, int L, int k)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * L * (ceil((double) k / s) + k * std::min(L, k) / 64.0);
+    double words = N * (double) n * L * ceil((double) k / s);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Chi2 *res = sres_CreateChi2();
         smarsa_MatrixRank(io.Gen(), res, N, n, r, s, L, k);
         if (N == 1)
@@ -954,12 +1941,14 @@ TestCbFunc smarsa_MatrixRank_cb(long N, long n, int r, int s, int L, int k)
         else
             io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Sum]);
         sres_DeleteChi2(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc sknuth_MaxOft_cb(long N, long n, int r, int d, int t)
+TestCbInfo sknuth_MaxOft_cb(long N, long n, int r, int d, int t)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * t;
+    double words = N * (double) n * t;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         gofw_TestType type_chi = gofw_Sum, type_bas = gofw_AD;
         if (N == 1) {
             type_chi = gofw_Mean;
@@ -972,40 +1961,47 @@ TestCbFunc sknuth_MaxOft_cb(long N, long n, int r, int d, int t)
         ad_name.replace(ad_name.find("MaxOft"), sizeof("MaxOft") - 1, "MaxOft AD");
         io.Add(td.GetId(), ad_name, res5->Bas->pVal2[type_bas]);
         sknuth_DeleteRes1(res5);        
-    };
+    }, cost).SetWords(words);
 }
 
 
-TestCbFunc smarsa_Opso_cb(long N, int r, int p)
+TestCbInfo smarsa_Opso_cb(long N, int r, int p)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * 4.0 * 2097152;
+    double words = N * (8388608.0 + 8); // n <= 2^23 for all p
+    double mem = multin_mem(2097152, 1048576);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         smarsa_Res *res = smarsa_CreateRes();
         smarsa_Opso(io.Gen(), res, N, r, p);
         io.Add(td.GetId(), td.GetName(), res->Pois->pVal2);
         smarsa_DeleteRes(res);
-    };
+    }, cost).SetMem(mem).SetWords(words);
 }
 
 /**
  * @brief An envelope for smarsa_CollisionOver for pseudoDIEHARD battery.
  */
-TestCbFunc smarsa_Oqso_cb(int i)
+TestCbInfo smarsa_Oqso_cb(int i)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = 2.0 * 2097152;
+    double mem = multin_mem(2097152, 1048576);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         printf ("***********************************************************\n"
             "Test OQSO calling smarsa_CollisionOver\n\n");
         smarsa_Res *res = smarsa_CreateRes();
         smarsa_CollisionOver(io.Gen(), res, 1, 2097152, i, 32, 4);
         io.Add(td.GetId(), td.GetName(), res->Bas->pVal2[gofw_Mean]);
         smarsa_DeleteRes(res);
-    };
+    }, cost).SetMem(mem).SetWords(2097152.0 + 4);
 }
 
 
 
-TestCbFunc sstring_PeriodsInStrings_cb(long N, long n, int r, int s)
+TestCbInfo sstring_PeriodsInStrings_cb(long N, long n, int r, int s)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * (ceil(31.0 / s) + 31.0);
+    double words = N * (double) n * ceil(31.0 / s);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Chi2 *res = sres_CreateChi2();
         sstring_PeriodsInStrings(io.Gen(), res, N, n, r, s);
         if (N == 1)        
@@ -1013,66 +2009,79 @@ TestCbFunc sstring_PeriodsInStrings_cb(long N, long n, int r, int s)
         else
             io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Sum]);
         sres_DeleteChi2 (res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc sknuth_Permutation_cb(long N, long n, int r, int t)
+TestCbInfo sknuth_Permutation_cb(long N, long n, int r, int t)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * t * (1.0 + log2_cost(t));
+    double words = N * (double) n * t;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Chi2 *res = sres_CreateChi2();
         sknuth_Permutation(io.Gen(), res, N, n, r, t);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteChi2(res);
-    };
+    }, cost).SetWords(words);
 }
 
 
-TestCbFunc smarsa_RandomWalk1_cb(long N, long n, int r, int s,
+TestCbInfo smarsa_RandomWalk1_cb(long N, long n, int r, int s,
     long L0, long L1, const std::string &mess)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * L1 * (1.0 + 1.0 / s);
+    double words = N * (double) n * ceil((double) L1 / s);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         auto *res = swalk_CreateRes ();
         swalk_RandomWalk1 (io.Gen(), res, N, n, r, s, L0, L1);
         GetPValue_Walk(io, 1, res, td.GetId(), mess.c_str());
         swalk_DeleteRes(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc sknuth_Run_cb(long N, long n, int r, bool Up)
+TestCbInfo sknuth_Run_cb(long N, long n, int r, bool Up)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n;
+    double words = N * ((double) n + 1.0);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Chi2 *res = sres_CreateChi2 ();
         sknuth_Run(io.Gen(), res, N, n, r, Up);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Sum]);
         sres_DeleteChi2(res);
-    };
+    }, cost).SetWords(words);
 }
 
 
-TestCbFunc sstring_Run_cb(long N, long n, int r, int s)
+TestCbInfo sstring_Run_cb(long N, long n, int r, int s)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * 4.0 * n / s;
+    // 2n runs of bits with geometric lengths: mean and variance are 4n bits
+    double words = random_words(N * 4.0 * n / s, N * 4.0 * n / ((double) s * s)) + N;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sstring_Res3 *res = sstring_CreateRes3();
         sstring_Run(io.Gen(), res, N, n, r, s);
         io.Add(td.GetId(), td.GetName(), res->NRuns->pVal2[gofw_Mean]);
         io.Add(td.GetId(), td.GetName(), res->NBits->pVal2[gofw_Mean]);
         sstring_DeleteRes3 (res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc svaria_SampleCorr_cb(long N, long n, int r, int k)
+TestCbInfo svaria_SampleCorr_cb(long N, long n, int r, int k)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n;
+    double words = N * ((double) n + k);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Basic *res = sres_CreateBasic();
         svaria_SampleCorr(io.Gen(), res, N, n, r, k);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteBasic(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc svaria_SampleProd_cb(long N, long n, int r, int t)
+TestCbInfo svaria_SampleProd_cb(long N, long n, int r, int t)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * t;
+    double words = N * (double) n * t;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Basic *res = sres_CreateBasic();
         svaria_SampleProd(io.Gen(), res, N, n, r, t);
         if (N > 1) // Derived from comparison of Crush and BigCrush
@@ -1080,22 +2089,26 @@ TestCbFunc svaria_SampleProd_cb(long N, long n, int r, int t)
         else
             io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteBasic(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc svaria_SampleMean_cb(long N, long n, int r)
+TestCbInfo svaria_SampleMean_cb(long N, long n, int r)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n;
+    double words = N * (double) n;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Basic *res = sres_CreateBasic();
         svaria_SampleMean(io.Gen(), res, N, n, r);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_AD]);
         sres_DeleteBasic(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc smarsa_Savir2_cb(long N, long n, int r, long m, int t)
+TestCbInfo smarsa_Savir2_cb(long N, long n, int r, long m, int t)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * t;
+    double words = N * (double) n * t;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         auto *res = sres_CreateChi2();
         smarsa_Savir2(io.Gen(), res, N, n, r, m, t);
         if (N == 1)
@@ -1103,49 +2116,66 @@ TestCbFunc smarsa_Savir2_cb(long N, long n, int r, long m, int t)
         else
             io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Sum]);
         sres_DeleteChi2(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc smarsa_SerialOver_cb(long N, long n, int r, long d, int t)
+TestCbInfo smarsa_SerialOver_cb(long N, long n, int r, long d, int t)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (2.0 * n + pow((double) d, t));
+    double words = N * ((double) n + t);
+    double mem = multin_mem(n, pow((double) d, t));
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Basic *res = sres_CreateBasic();
         smarsa_SerialOver(io.Gen(), res, N, n, r, d, t);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteBasic (res);
-    };
+    }, cost).SetMem(mem).SetWords(words);
 }
 
 
-TestCbFunc sknuth_SimpPoker_cb(long N, long n, int r, int d, int k)
+TestCbInfo sknuth_SimpPoker_cb(long N, long n, int r, int d, int k)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * k;
+    auto words_func = [=] (long ni) { return N * (double) ni * k; };
+    auto func = [=] (TestDescr &td, BatteryIO &io) {
         sres_Chi2 *res = sres_CreateChi2();
         sknuth_SimpPoker(io.Gen(), res, N, n, r, d, k);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteChi2(res);
     };
+    if (N != 1) {
+        return TestCbInfo(func, cost).SetWords(words_func(n));
+    }
+    return TestCbInfo(func, cost, chi2_chunks_split(n, cost, words_func, [=] (unif01_Gen *gen, long ni, sres_Chi2 *res) {
+        sknuth_SimpPoker(gen, res, 1, ni, r, d, k);
+    }), chunks_max(n)).SetChunked().SetWords(words_func(n));
 }
 
-TestCbFunc svaria_SumCollector_cb(long N, long n, int r, double g)
+TestCbInfo svaria_SumCollector_cb(long N, long n, int r, double g)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * (2.0 * g + 1.0);
+    // Each of N*n sums uses about 2g + 5/3 outputs with variance 2g/3
+    double words = random_words(N * (double) n * (2.0 * g + 5.0 / 3.0),
+        N * (double) n * 2.0 * g / 3.0);
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Chi2 *res = sres_CreateChi2();
         svaria_SumCollector(io.Gen(), res, N, n, r, g);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteChi2(res);
-    };
+    }, cost).SetWords(words);
 }
 
-TestCbFunc svaria_WeightDistrib_cb(long N, long n, int r, long k,
+TestCbInfo svaria_WeightDistrib_cb(long N, long n, int r, long k,
     double alpha, double beta)
 {
-    return [=] (TestDescr &td, BatteryIO &io) {
+    double cost = N * (double) n * k;
+    double words = N * (double) n * k;
+    return TestCbInfo([=] (TestDescr &td, BatteryIO &io) {
         sres_Chi2 *res = sres_CreateChi2();
         svaria_WeightDistrib(io.Gen(), res, N, n, r, k, alpha, beta);
         io.Add(td.GetId(), td.GetName(), res->pVal2[gofw_Mean]);
         sres_DeleteChi2(res);
-    };
+    }, cost).SetWords(words);
 }
 
 } // namespace testu01_threads
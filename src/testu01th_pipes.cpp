@@ -1,7 +1,9 @@
 /**
  * @file testu01th_pipes.cpp
- * @brief Reads pseudorandom numbers from stdin as uint32_t in binary form
- * and sends it to one-threaded version of TestU01.
+ * @brief Reads pseudorandom numbers from stdin as uint32_t (or uint64_t,
+ * or double) in binary form and sends it to one-threaded version of TestU01. Pre-generated files
+ * and stdin (with the fan-out buffering) may be tested by multi-threaded
+ * batteries.
  *
  * @copyright (c) 2024 Alexey L. Voskov, Lomonosov Moscow State University.
  * alvoskov@gmail.com
@@ -16,63 +18,137 @@
 #include "testu01_threads.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <thread>
 #include <mutex>
 
 using namespace testu01_threads;
 
+void print_help()
+{
+    const std::string helptext(
+    "Runs TestU01 batteries from binary data from stdin. Data are\n"
+    "processed as unsigned 32-bit integers (see the --input option for 64-bit\n"
+    "integers and doubles). By default batteries are working\n"
+    "in one-threaded mode. Multi-threaded mode is available for stdin\n"
+    "(the --parallel option), for files (the --file option) and for\n"
+    "C modules (testu01th_run)\n\n"
+    "Usage: test01th_pipes battery [--options]\n"
+    "  battery: SmallCrush, Crush, BigCrush, pseudoDIEHARD\n"
+    "  --input=F      Format of stdin: u32 (default); 64-bit words decomposed to\n"
+    "                 high32, low32 or interleaved32 (both halves, lower first);\n"
+    "                 reversed32 (32-bit words or halves with reversed bits);\n"
+    "                 double (numbers from [0;1), upper 32 bits of fractions)\n"
+    "  --parallel     Run the multi-threaded battery: the reader thread reads\n"
+    "                 stdin by large blocks, each worker takes the next block\n"
+    "                 when its current block is exhausted\n"
+    "  --blocks=N     Number of blocks for --parallel (default: 2 per thread + 2);\n"
+    "                 the reader waits if all of them are in use; at least\n"
+    "                 threads + 1 blocks are used\n"
+    "  --block-size=M Size of one block for --parallel, MiB (default: 4)\n"
+    "  --file=F       Read data from the file mapped to memory and run\n"
+    "                 the multi-threaded battery: each test reads its own\n"
+    "                 region of the file\n"
+    "  --threads=N    Number of threads for --parallel and --file\n"
+    "                 (default: all hardware threads)\n\n"
+    "Example:\n"
+    "  testu01th_run.exe stdout32 gen.dll | testu01th_pipes.exe SmallCrush\n"
+    "  testu01th_run.exe stdout32 gen.dll | testu01th_pipes.exe Crush --parallel\n"
+    "  testu01th_run.exe stdout64 gen.dll | testu01th_pipes.exe SmallCrush --input=low32\n"
+    "  testu01th_pipes.exe BigCrush --file=gen.bin\n\n"
+    );
+    std::cout << helptext << std::endl;
+}
+
 /**
- * @brief This pseudorandom number generator obtains numbers
- * from stdin (as uint32_t in binary format).
+ * @brief Runs the multi-threaded battery.
+ * @param regions  Each test reads its own region of the sequence (requires
+ * the generator with jumps, see TestsPull::SetSampleRegions).
+ * @param nwords   Length of the sequence for regions (0 - unlimited).
+ * @return Exit code of the program.
  */
-class Stdin32Collector : public UniformGenerator
+int run_parallel(const std::string &battery, GenFactoryFunc create_gen,
+    std::shared_ptr<ThreadPool> pool, bool regions, uint64_t nwords = 0)
 {
-    static constexpr size_t buffer_size = 2048;
-    uint32_t buffer[buffer_size];
-    size_t pos;
-
-public:
-    Stdin32Collector() : UniformGenerator("stdin32")
-    {
-        set_bin_stdin();
-        pos = buffer_size;
-    }
-
-    void FillBuffer()
-    {
-        fread(buffer, sizeof(uint32_t), buffer_size, stdin);
-        pos = 0;
+    std::unique_ptr<TestsBattery> bat;
+    if (battery == "SmallCrush") {
+        bat.reset(new SmallCrushBattery(create_gen));
+    } else if (battery == "Crush") {
+        bat.reset(new CrushBattery(create_gen));
+    } else if (battery == "BigCrush") {
+        bat.reset(new BigCrushBattery(create_gen));
+    } else if (battery == "pseudoDIEHARD") {
+        bat.reset(new PseudoDiehardBattery(create_gen));
+    } else {
+        std::cerr << "Unknown battery " << battery << std::endl;
+        return 1;
     }
+    bat->SetThreadPool(pool);
+    bat->SetSampleRegions(regions, nwords);
+    auto results = bat->Run();
+    std::cout << results.report;
+    return 0;
+}
 
-    double GetU01() override
-    {
-        return (double) GetBits32() / ((double) UINT_MAX + 1.0);
+/**
+ * @brief Runs the multi-threaded battery for the file mapped to memory.
+ * Each test and shard reads its own region of the file.
+ * @return Exit code of the program.
+ */
+int run_file(const std::string &battery, const std::string &filename, int nthreads)
+{
+    auto file = std::make_shared<MappedFile>(filename);
+    if (!file->IsOpen()) {
+        return 1;
     }
-
-    uint32_t GetBits32() override
-    {
-        if (pos == buffer_size) {
-            FillBuffer();
-        }
-        return buffer[pos++];
+    if (file->GetSize() < sizeof(uint32_t)) {
+        std::cerr << "The file " << filename << " is too short" << std::endl;
+        return 1;
     }
-};
-
-
+    uint64_t nwords = file->GetSize() / sizeof(uint32_t);
+    std::cerr << "=====> File " << filename << ": " << nwords
+        << " 32-bit words" << std::endl;
+    GenFactoryFunc create_gen = [file] () -> std::shared_ptr<UniformGenerator> {
+        return std::make_shared<MappedFileGenerator>(file);
+    };
+    // The battery warns before the run if its regions don't fit into the file
+    return run_parallel(battery, create_gen, std::make_shared<ThreadPool>(nthreads),
+        true, nwords);
+}
 
-void print_help()
+/**
+ * @brief Runs the multi-threaded battery for stdin: blocks of stdin are
+ * given to workers in the order of arrival.
+ * @param nblocks     Number of blocks (0 - two per thread + 2); it is
+ * increased to the number of threads + 1 if necessary.
+ * @param block_size  Size of one block, bytes.
+ * @param format      Format of input words.
+ * @return Exit code of the program.
+ */
+int run_stdin_parallel(const std::string &battery, int nthreads,
+    size_t nblocks, size_t block_size, InputFormat format)
 {
-    const std::string helptext(
-    "Runs TestU01 batteries from binary data from stdin. Data are\n"
-    "processed as unsigned 32-bit integers. All batteries are working\n"
-    "in one-threaded mode. Multi-threaded mode is available only for\n"
-    "C modules and testu01th_run\n\n"
-    "Usage: test01th_pipes battery\n"
-    "  battery: SmallCrush, Crush, BigCrush, pseudoDIEHARD\n\n"
-    "Example:\n"
-    "  testu01th_run.exe stdout32 gen.dll | testu01th_pipes.exe SmallCrush\n\n"
-    );
-    std::cout << helptext << std::endl;
+    auto pool = std::make_shared<ThreadPool>(nthreads);
+    if (nblocks == 0) {
+        nblocks = 2 * pool->GetNThreads() + 2;
+    }
+    // Each worker keeps its partly consumed block between tests, so the
+    // reader needs at least one more block: otherwise it may deadlock.
+    size_t nblocks_min = pool->GetNThreads() + 1;
+    if (nblocks < nblocks_min) {
+        std::cerr << "=====> Number of blocks is increased from " << nblocks
+            << " to " << nblocks_min << " (threads + 1)" << std::endl;
+        nblocks = nblocks_min;
+    }
+    std::cerr << "=====> Fan-out of stdin: " << nblocks << " blocks of "
+        << block_size / 1048576 << " MiB" << std::endl;
+    set_bin_stdin();
+    auto reader = std::make_shared<FanOutReader>(stdin, nblocks, block_size, format);
+    GenFactoryFunc create_gen = [reader] () -> std::shared_ptr<UniformGenerator> {
+        return std::make_shared<FanOutGenerator>(reader);
+    };
+    return run_parallel(battery, create_gen, pool, false);
 }
 
 /**
@@ -80,12 +156,51 @@ void print_help()
  */
 int main(int argc, char *argv[]) 
 {
-    Stdin32Collector stdin_prng;
     if (argc < 2) {
         print_help();
         return 0;
     }
-    std::string battery = argv[1];
+    std::string battery = argv[1], filename;
+    int nthreads = 0, nblocks = 0, block_mib = 4;
+    bool parallel = false;
+    InputFormat format = INPUT_U32;
+    for (int i = 2; i < argc; i++) {
+        if (!strncmp(argv[i], "--file=", 7)) {
+            filename = argv[i] + 7;
+        } else if (!strncmp(argv[i], "--threads=", 10) && atoi(argv[i] + 10) > 0) {
+            nthreads = atoi(argv[i] + 10);
+        } else if (!strncmp(argv[i], "--input=", 8)) {
+            if (!parse_input_format(argv[i] + 8, format)) {
+                std::cerr << "Unknown input format " << argv[i] + 8 << std::endl;
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--parallel")) {
+            parallel = true;
+        } else if (!strncmp(argv[i], "--blocks=", 9) && atoi(argv[i] + 9) > 0) {
+            nblocks = atoi(argv[i] + 9);
+        } else if (!strncmp(argv[i], "--block-size=", 13) && atoi(argv[i] + 13) > 0) {
+            block_mib = atoi(argv[i] + 13);
+        } else {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (!filename.empty()) {
+        if (format != INPUT_U32) {
+            std::cerr << "Only u32 format is supported for files" << std::endl;
+            return 1;
+        }
+        return run_file(battery, filename, nthreads);
+    } else if (parallel) {
+        return run_stdin_parallel(battery, nthreads, nblocks,
+            (size_t) block_mib * 1048576, format);
+    }
+    // Serial mode: the reader thread still reads and decodes stdin
+    // in advance (double buffering).
+    set_bin_stdin();
+    auto reader = std::make_shared<FanOutReader>(stdin, 2,
+        (size_t) block_mib * 1048576, format);
+    FanOutGenerator stdin_prng(reader);
     if (battery == "SmallCrush") {
         bbattery_SmallCrush(stdin_prng.GetPtr());
     } else if (battery == "Crush") {
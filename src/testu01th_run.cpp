@@ -19,6 +19,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <signal.h>
 
 #include <string>
 #include <system_error>
@@ -51,6 +52,8 @@ class HModuleWrapper
 public:
     HModuleWrapper() : hDll(0) {}
     HModuleWrapper(HMODULE h) : hDll(h) {}
+    HModuleWrapper(const HModuleWrapper &) = delete;
+    HModuleWrapper &operator=(const HModuleWrapper &) = delete;
     ~HModuleWrapper()
     {
         if (hDll != 0)
@@ -58,34 +61,65 @@ public:
     }
 };
 
-bool load_module(GenCModule &mod, const char *libname)
+typedef HModuleWrapper ModuleHandle;
+
+/**
+ * @brief Loads the module; the library is unloaded when the returned
+ * handle is destroyed.
+ * @return Handle of the library or nullptr in the case of error.
+ */
+std::shared_ptr<ModuleHandle> open_module(GenCModule &mod, const char *libname)
 {
     HMODULE hDll = LoadLibraryA(libname);
     if (hDll == 0 || hDll == INVALID_HANDLE_VALUE) {
         int errcode = (int) GetLastError();
         fprintf(stderr, "Cannot load the '%s' module; error code: %d\n",
             libname, errcode);
-        return false;
+        return nullptr;
     }
 
-    static HModuleWrapper dll_wrapper(hDll);
+    auto dll_wrapper = std::make_shared<HModuleWrapper>(hDll);
 
     mod.gen_initlib = reinterpret_cast<GenInitLibFunc>((void *) GetProcAddress(hDll, "gen_initlib"));
     if (mod.gen_initlib == nullptr) {
         fprintf(stderr, "Cannot find the 'gen_initlib' function\n");
-        return false;
+        return nullptr;
     }
     mod.gen_closelib = reinterpret_cast<GenCloseLibFunc>((void *) GetProcAddress(hDll, "gen_closelib"));
     if (mod.gen_closelib == nullptr) {
         fprintf(stderr, "Cannot find the 'gen_closelib' function\n");
-        return false;
+        return nullptr;
     }
     mod.gen_getinfo = reinterpret_cast<GenGetInfoFunc>((void *) GetProcAddress(hDll, "gen_getinfo"));
     if (mod.gen_getinfo == nullptr) {
         fprintf(stderr, "Cannot find the 'gen_getinfo' function\n");
-        return false;
+        return nullptr;
     }
-    return true;
+    // Optional entry point for the extended fields of GenInfoC
+    mod.gen_getinfo2 = reinterpret_cast<GenGetInfo2Func>((void *) GetProcAddress(hDll, "gen_getinfo2"));
+    return dll_wrapper;
+}
+
+/**
+ * @brief Returns sorted names of files in the directory that match
+ * the wildcard, e.g. `*_shared*.dll`.
+ */
+std::vector<std::string> list_directory(const std::string &dirname, const std::string &mask)
+{
+    std::vector<std::string> names;
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA((dirname + "\\" + mask).c_str(), &fd);
+    if (h == INVALID_HANDLE_VALUE) {
+        return names;
+    }
+    do {
+        if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            names.push_back(dirname + "\\" + fd.cFileName);
+        }
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+    std::sort(names.begin(), names.end());
+    return names;
 }
 
 ////////////////////////////////////////
@@ -97,6 +131,8 @@ bool load_module(GenCModule &mod, const char *libname)
 ///////////////////////////////////////
 
 #include <dlfcn.h>
+#include <fnmatch.h>
+#include <dirent.h>
 
 class ExtLibraryWrapper
 {
@@ -105,6 +141,8 @@ class ExtLibraryWrapper
 public:
     ExtLibraryWrapper() : lib(nullptr) {}
     ExtLibraryWrapper(void *h) : lib(h) {}
+    ExtLibraryWrapper(const ExtLibraryWrapper &) = delete;
+    ExtLibraryWrapper &operator=(const ExtLibraryWrapper &) = delete;
     ~ExtLibraryWrapper()
     {
         if (lib != nullptr)
@@ -113,33 +151,64 @@ public:
 };
 
 
-bool load_module(GenCModule &mod, const char *libname)
+typedef ExtLibraryWrapper ModuleHandle;
+
+/**
+ * @brief Loads the module; the library is unloaded when the returned
+ * handle is destroyed.
+ * @return Handle of the library or nullptr in the case of error.
+ */
+std::shared_ptr<ModuleHandle> open_module(GenCModule &mod, const char *libname)
 {
     void *lib = dlopen(libname, RTLD_LAZY);
     if (lib == nullptr) {
         fprintf(stderr, "dlopen() error: %s\n", dlerror());
-        return false;
+        return nullptr;
     };
 
-    static ExtLibraryWrapper lib_wrapper(lib);
+    auto lib_wrapper = std::make_shared<ExtLibraryWrapper>(lib);
 
     mod.gen_initlib = reinterpret_cast<GenInitLibFunc>(dlsym(lib, "gen_initlib"));
     if (mod.gen_initlib == nullptr) {
         fprintf(stderr, "Cannot find the 'gen_initlib' function\n");
-        return false;
+        return nullptr;
     }
     mod.gen_closelib = reinterpret_cast<GenCloseLibFunc>(dlsym(lib, "gen_closelib"));
-    if (mod.gen_initlib == nullptr) {
+    if (mod.gen_closelib == nullptr) {
         fprintf(stderr, "Cannot find the 'gen_closelib' function\n");
-        return false;
+        return nullptr;
     }
     mod.gen_getinfo = reinterpret_cast<GenGetInfoFunc>(dlsym(lib, "gen_getinfo"));
-    if (mod.gen_initlib == nullptr) {
+    if (mod.gen_getinfo == nullptr) {
         fprintf(stderr, "Cannot find the 'gen_getinfo' function\n");
-        return false;
+        return nullptr;
     }
+    // Optional entry point for the extended fields of GenInfoC
+    mod.gen_getinfo2 = reinterpret_cast<GenGetInfo2Func>(dlsym(lib, "gen_getinfo2"));
 
-    return true;
+    return lib_wrapper;
+}
+
+/**
+ * @brief Returns sorted names of files in the directory that match
+ * the wildcard, e.g. `*_shared*.so`.
+ */
+std::vector<std::string> list_directory(const std::string &dirname, const std::string &mask)
+{
+    std::vector<std::string> names;
+    DIR *dir = opendir(dirname.c_str());
+    if (dir == nullptr) {
+        return names;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (fnmatch(mask.c_str(), entry->d_name, 0) == 0) {
+            names.push_back(dirname + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
 }
 
 
@@ -148,6 +217,16 @@ bool load_module(GenCModule &mod, const char *libname)
 /////////////////////////////////////
 #endif
 
+/**
+ * @brief Loads the module that is used until the end of the program.
+ */
+bool load_module(GenCModule &mod, const char *libname)
+{
+    static std::shared_ptr<ModuleHandle> lib_handle;
+    lib_handle = open_module(mod, libname);
+    return lib_handle != nullptr;
+}
+
 /**
  * @brief Seeds generation for PRNGs
  */
@@ -156,8 +235,8 @@ Entropy entropy;
 
 /**
  * @brief Obtain hardware generated seed (random number)
- * from the RDSEED instruction. Used during configuration of C modules
- * interfaces.
+ * from the selected entropy source (see `--entropy`). Used during
+ * configuration of C modules interfaces.
  */
 static uint64_t seed64()
 {
@@ -172,7 +251,7 @@ void print_help()
     "The parallel mode allows to use all cores of CPU for computations and\n"
     "used its own dispatcher. The serial version runs in one-threaded mode\n"
     "and just runs the batteries from TestU01 without modification.\n\n"
-    "Usage: test01th_lib battery generator_lib [test_id] [gen_options]\n"
+    "Usage: test01th_lib battery generator_lib [test_id] [gen_options] [--options]\n"
     "  battery: battery name; supported batteries are:\n"
     "    Parallel versions of batteries:\n"
     "    - SmallCrush, Crush, BigCrush, pseudoDIEHARD\n"
@@ -181,18 +260,81 @@ void print_help()
     "    Output to stdout that is useful for practrand library:\n"
     "    - stdout32, stdout64, stdout32v, stdout64v;\n"
     "      'v' means vectorized versions of generators\n"
+    "    Binary dump of 2^K bytes to the file (see options below):\n"
+    "    - dump\n"
     "    Special measurements for the supplied PRNG:\n"
     "    - speed - measures performance\n"
+    "    - speed-mt - measures performance of 1..N instances run in parallel\n"
+    "      (--threads and --affinity options are used)\n"
+    "    - speed-all - measures performance of all *_shared modules from\n"
+    "      the directory given instead of generator_lib (sorted table)\n"
+    "    - speed-compare - measures performance and compares it with\n"
+    "      the baseline saved by --json; the baseline file is given\n"
+    "      instead of test_id, exit code is 1 if regressions are found\n"
     "    - selftest - runs the internal self-test\n"
     "  generator_lib: name of dynamic library with PRNG that export the functions:\n"
     "    - int gen_initlib()\n"
     "    - int gen_getinfo(GenInfoC *gi)\n"
+    "    - int gen_getinfo2(GenInfoC *gi, size_t size) (optional)\n"
     "    - int gen_closelib()\n"
     "  test_id:   Optional argument with specific test ID\n"
-    "  gen_options: Optional argument with generator options\n\n"
+    "  gen_options: Optional argument with generator options\n"
+    "Options for parallel batteries:\n"
+    "  --threads=N    Number of worker threads (default: all hardware threads)\n"
+    "  --affinity=P   Binding of workers to CPUs: none (default), compact,\n"
+    "                 scatter (round-robin between NUMA nodes), node (workers\n"
+    "                 are split between NUMA nodes)\n"
+    "  --mem-limit=M  Memory limit for simultaneously run tests; K, M and G\n"
+    "                 suffixes are supported, e.g. --mem-limit=4G\n"
+    "  --seed=S       Master seed; each test gets its own seed derived from it\n"
+    "                 (by default the master seed is random)\n"
+    "  --replay=FILE  Take the master seed from the report (report.txt) and\n"
+    "                 rerun the battery or the selected test bit-identically\n"
+    "  --streams[=L]  All tests use the same seed but non-overlapping substreams\n"
+    "                 of 2^L outputs (default L=40); requires the `jump` function\n"
+    "  --buffered     Serve TestU01 calls from a buffer filled by get_array32\n"
+    "                 or get_array64 (64-bit outputs are split into halves);\n"
+    "                 stdout32/stdout64 also use the array functions\n"
+    "  --perf         Collect hardware counters of tests (cycles, instructions,\n"
+    "                 L1D/LLC and branch misses; Linux perf events) and save\n"
+    "                 them to report.txt and the runtime history\n"
+    "  --history=FILE Runtime history file used for scheduling of tests\n"
+    "                 (default: testu01th_history.txt); --history=0 disables it\n"
+    "  --entropy=E    Source of entropy for random seeds: rdseed, rdrand, rdtsc,\n"
+    "                 getrandom, time or fixed (the same seeds at each run);\n"
+    "                 by default the best source supported by CPU is used\n"
+    "Options for stdout modes:\n"
+    "  --gen-threads=N  Number of generator threads; their outputs are written\n"
+    "                 by blocks in turn (default: 1). With --streams generators\n"
+    "                 are non-overlapping substreams of one sequence\n"
+    "  --limit=B      Number of bytes to write, e.g. --limit=1T (default: no limit)\n"
+    "  --buffer-size=B  Size of one buffer (default: 4M)\n"
+    "  --vmsplice=0   Disable zero-copy output to pipes (Linux only)\n"
+    "Options for the dump mode:\n"
+    "  --file=F       Output file name (required)\n"
+    "  --log2-size=K  File size is 2^K bytes, K=12..62 (default: 30)\n"
+    "  --gen-threads=N  Number of generator threads writing disjoint regions\n"
+    "                 of the file (default: all hardware threads)\n"
+    "  --buffer-size=B  Size of one written block (default: 16M)\n"
+    "  --direct=0     Disable O_DIRECT output (Linux only)\n"
+    "  --checkpoint=S Interval between checkpoints in seconds (default: 60)\n"
+    "  --resume       Continue the interrupted dump from the F.ckpt checkpoint\n"
+    "Options for speed modes:\n"
+    "  --reps=K       Number of repetitions; the median, MAD and 95% confidence\n"
+    "                 interval of the median are reported (default: 15)\n"
+    "  --sample-time=MS  Minimal duration of one repetition, ms (default: 20)\n"
+    "  --perf         Print hardware counters per call (Linux perf events)\n"
+    "  --json=F, --csv=F  Save results (one record per interface and number\n"
+    "                 of threads) to the JSON or CSV file\n"
+    "  --threshold=P  Throughput drop treated as a regression by speed-compare,\n"
+    "                 percent (default: 10)\n\n"
     "Examples:\n"
     "  testu01th_lib SmallCrush lcg64_shared.dll\n"
-    "  testu01th_lib stdout32 lcg64_shared.dll | RNG_test stdin32 -multithreaded");
+    "  testu01th_lib BigCrush lcg64_shared.dll 15 --replay=report.txt\n"
+    "  testu01th_lib stdout32 lcg64_shared.dll | RNG_test stdin32 -multithreaded\n"
+    "  testu01th_lib dump lcg64_shared.dll --file=lcg64.bin --log2-size=40\n"
+    "  testu01th_lib speed-compare chacha_avx_shared.dll base.json --threshold=5\n"
+    "  testu01th_lib speed-all bin/generators --json=speed.json");
 
     std::cout << helptext << std::endl << std::endl;
 }
@@ -229,11 +371,38 @@ static int run_self_test(const GenInfoC &geninfo)
 }
 
 
-std::string get_gen_options(int argc, char *argv[])
+/**
+ * @brief Extracts options in the `--name=value` format from
+ * the command line arguments.
+ * @param[out] opts  Found options.
+ * @return Other (positional) arguments including the program name.
+ */
+std::vector<std::string> parse_options(int argc, char *argv[],
+    std::map<std::string, std::string> &opts)
+{
+    std::vector<std::string> args;
+    for (int i = 0; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (i > 0 && arg.size() > 2 && arg[0] == '-' && arg[1] == '-') {
+            size_t eqpos = arg.find('=');
+            if (eqpos == std::string::npos) {
+                opts[arg.substr(2)] = "";
+            } else {
+                opts[arg.substr(2, eqpos - 2)] = arg.substr(eqpos + 1);
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+    return args;
+}
+
+
+std::string get_gen_options(const std::vector<std::string> &args)
 {
     std::string gen_options;
-    if (argc >= 5) {
-        gen_options = std::string(argv[4]);
+    if (args.size() >= 5) {
+        gen_options = args[4];
     }
     return gen_options;
 }
@@ -243,13 +412,13 @@ std::string get_gen_options(int argc, char *argv[])
  * selected by the user.
  * @return -1 -- no test selected, 0 -- invalid test ID, >0 - test ID.
  */
-int get_test_id(int argc, char *argv[])
+int get_test_id(const std::vector<std::string> &args)
 {
     int test_id = -1;
-    if (argc >= 4) {
-        test_id = std::stoi(argv[3]);
+    if (args.size() >= 4) {
+        test_id = std::stoi(args[3]);
         if (test_id == 0) {
-            std::cerr << "Invalid test number " << argv[3] << std::endl;
+            std::cerr << "Invalid test number " << args[3] << std::endl;
             return 0;
         }
     }
@@ -257,7 +426,215 @@ int get_test_id(int argc, char *argv[])
 }
 
 /**
- * @brief Save the full protocol to the file
+ * @brief Selects the source of entropy for random seeds from
+ * the `--entropy` option.
+ * @return true on success, false in the case of invalid option.
+ */
+bool set_entropy_method(const std::map<std::string, std::string> &opts)
+{
+    auto it = opts.find("entropy");
+    if (it != opts.end()) {
+        EntropyMethod method;
+        if (!parse_entropy_method(it->second, method)) {
+            std::cerr << "Unknown entropy source " << it->second << std::endl;
+            return false;
+        }
+        if ((method == ENTROPY_RDSEED && !Entropy::HasRdSeed()) ||
+            (method == ENTROPY_RDRAND && !Entropy::HasRdRand())) {
+            std::cerr << "This CPU doesn't support " << it->second <<
+                ", fallback entropy sources will be used" << std::endl;
+        }
+        entropy.SetMethod(method);
+    }
+    std::cerr << "=====> Entropy source: "
+        << entropy_method_name(entropy.GetMethod()) << std::endl;
+    return true;
+}
+
+/**
+ * @brief Converts the size with optional K, M, G or T suffix
+ * (binary units) to bytes.
+ * @return Size in bytes or negative value if the string is invalid.
+ */
+double parse_size(const std::string &txt)
+{
+    char *endptr = nullptr;
+    double bytes = strtod(txt.c_str(), &endptr);
+    if (endptr == txt.c_str() || bytes <= 0.0) {
+        return -1.0;
+    }
+    switch (*endptr) {
+    case 'K': case 'k': bytes *= 1024.0; endptr++; break;
+    case 'M': case 'm': bytes *= 1048576.0; endptr++; break;
+    case 'G': case 'g': bytes *= 1073741824.0; endptr++; break;
+    case 'T': case 't': bytes *= 1099511627776.0; endptr++; break;
+    default: break;
+    }
+    return (*endptr == '\0') ? bytes : -1.0;
+}
+
+/**
+ * @brief Returns the memory limit from the `--mem-limit` option.
+ * @return Memory limit in bytes, 0 if there is no limit, negative
+ * value if the option is invalid.
+ */
+double get_mem_limit(const std::map<std::string, std::string> &opts)
+{
+    auto it = opts.find("mem-limit");
+    if (it == opts.end()) {
+        return 0.0;
+    }
+    double bytes = parse_size(it->second);
+    if (bytes < 0.0) {
+        std::cerr << "Invalid memory limit " << it->second << std::endl;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Creates the thread pool for parallel batteries using
+ * the `--threads` and `--affinity` options.
+ * @return Pointer to the pool or nullptr in the case of invalid options.
+ */
+std::shared_ptr<ThreadPool> create_thread_pool(const std::map<std::string, std::string> &opts)
+{
+    int nthreads = 0;
+    AffinityPolicy affinity = AFFINITY_NONE;
+    auto it = opts.find("threads");
+    if (it != opts.end()) {
+        nthreads = atoi(it->second.c_str());
+        if (nthreads <= 0) {
+            std::cerr << "Invalid number of threads " << it->second << std::endl;
+            return nullptr;
+        }
+    }
+    it = opts.find("affinity");
+    if (it != opts.end() && !parse_affinity_policy(it->second, affinity)) {
+        std::cerr << "Invalid affinity policy " << it->second << std::endl;
+        return nullptr;
+    }
+    auto pool = std::make_shared<ThreadPool>(nthreads, affinity);
+    const CpuTopology &topo = pool->GetTopology();
+    std::cerr << "=====> Thread pool: " << pool->GetNThreads() << " threads; "
+        << topo.nodes.size() << " NUMA node(s); "
+        << topo.GetNCpus() << " CPUs" << std::endl;
+    return pool;
+}
+
+/**
+ * @brief Options of parallel batteries obtained from the command line.
+ */
+class BatteryOptions
+{
+public:
+    std::shared_ptr<ThreadPool> pool; ///< Pool of worker threads.
+    double mem_limit; ///< Memory limit, bytes (0 - no limit).
+    uint64_t seed; ///< Master seed for seeds of tests.
+    size_t nshards; ///< Maximal number of shards (0 - number of threads).
+    unsigned int streams_log2; ///< log2 of the substream length (0 - no streams).
+    bool perf; ///< Collect hardware counters of tests.
+    std::string history_file; ///< Runtime history file (empty - disabled).
+
+    BatteryOptions() : mem_limit(0.0), seed(0), nshards(0), streams_log2(0), perf(false),
+        history_file("testu01th_history.txt") {}
+};
+
+/**
+ * @brief Reads the master seed, the maximal number of shards and
+ * the substreams length from the report saved by `SaveProtocol`.
+ * @return true on success, false otherwise.
+ */
+bool load_replay(const std::string &filename, BatteryOptions &bopts)
+{
+    static const std::string seed_key = "  Master seed:";
+    static const std::string nshards_key = "  Max shards per test:";
+    static const std::string streams_key = "  Streams log2 distance:";
+    std::ifstream infile(filename);
+    if (!infile.is_open()) {
+        std::cerr << "Cannot open the report " << filename << std::endl;
+        return false;
+    }
+    bool seed_found = false;
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (line.compare(0, seed_key.size(), seed_key) == 0) {
+            bopts.seed = strtoull(line.c_str() + seed_key.size(), nullptr, 0);
+            seed_found = true;
+        } else if (line.compare(0, nshards_key.size(), nshards_key) == 0) {
+            bopts.nshards = strtoul(line.c_str() + nshards_key.size(), nullptr, 10);
+        } else if (line.compare(0, streams_key.size(), streams_key) == 0) {
+            bopts.streams_log2 = (unsigned int) strtoul(
+                line.c_str() + streams_key.size(), nullptr, 10);
+        }
+    }
+    if (!seed_found) {
+        std::cerr << "Master seed is not found in " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the master seed from the `--seed` or `--replay` options.
+ * If they are absent, the seed is made by the entropy source, so any run
+ * may be replayed using its report.
+ * @return true on success, false in the case of invalid options.
+ */
+bool get_seed(const std::map<std::string, std::string> &opts, BatteryOptions &bopts)
+{
+    auto it = opts.find("seed");
+    auto it_replay = opts.find("replay");
+    if (it != opts.end() && it_replay != opts.end()) {
+        std::cerr << "--seed and --replay options cannot be used together" << std::endl;
+        return false;
+    }
+    if (it != opts.end()) {
+        char *endptr = nullptr;
+        bopts.seed = strtoull(it->second.c_str(), &endptr, 0);
+        if (endptr == it->second.c_str() || *endptr != '\0') {
+            std::cerr << "Invalid seed " << it->second << std::endl;
+            return false;
+        }
+    } else if (it_replay != opts.end()) {
+        if (!load_replay(it_replay->second, bopts)) {
+            return false;
+        }
+        std::cerr << "=====> Replay of " << it_replay->second << std::endl;
+    } else {
+        bopts.seed = entropy.Seed64();
+    }
+    return true;
+}
+
+/**
+ * @brief Returns log2 of the substreams length from the `--streams`
+ * option (0 if substreams are not used).
+ * @return true on success, false in the case of invalid option.
+ */
+bool get_streams(const std::map<std::string, std::string> &opts, BatteryOptions &bopts)
+{
+    auto it = opts.find("streams");
+    if (it == opts.end()) {
+        return true;
+    }
+    if (it->second.empty()) {
+        bopts.streams_log2 = 40;
+        return true;
+    }
+    char *endptr = nullptr;
+    unsigned long val = strtoul(it->second.c_str(), &endptr, 10);
+    if (endptr == it->second.c_str() || *endptr != '\0' || val < 1 || val > 63) {
+        std::cerr << "Invalid substreams length " << it->second
+            << " (must be 1..63)" << std::endl;
+        return false;
+    }
+    bopts.streams_log2 = (unsigned int) val;
+    return true;
+}
+
+/**
+ * @brief Save the full protocol to the file. If tests had their own
+ * seeds then the table of seeds is saved: it is used by `--replay`.
  */
 void SaveProtocol(const BatteryResults &results, Entropy &entropy)
 {
@@ -268,6 +645,64 @@ void SaveProtocol(const BatteryResults &results, Entropy &entropy)
     size_t seeds_per_thread = nseeds / nthreads;
     outfile.open("report.txt");
     outfile << results.ToString() << std::endl;
+    if (!results.test_perf.empty()) {
+        auto test_perf = results.test_perf;
+        std::sort(test_perf.begin(), test_perf.end(),
+            [] (const TestPerfRecord &a, const TestPerfRecord &b) {
+                return (a.id != b.id) ? (a.id < b.id) : (a.shard < b.shard);
+            });
+        outfile << "========= Hardware counters of tests =========" << std::endl;
+        snprintf(buf, 256, "  %4s %5s", "ID", "SHARD");
+        outfile << buf;
+        for (int i = 0; i < PERF_NCOUNTERS; i++) {
+            snprintf(buf, 256, " %13s", perf_counter_name(static_cast<PerfCounterType>(i)));
+            outfile << buf;
+        }
+        outfile << "    IPC" << std::endl;
+        for (auto &r : test_perf) {
+            snprintf(buf, 256, "  %4d %5d", r.id, (int) r.shard);
+            outfile << buf;
+            for (int i = 0; i < PERF_NCOUNTERS; i++) {
+                PerfCounterType type = static_cast<PerfCounterType>(i);
+                if (r.perf.Has(type)) {
+                    snprintf(buf, 256, " %13.4g", r.perf.Get(type));
+                } else {
+                    snprintf(buf, 256, " %13s", "-");
+                }
+                outfile << buf;
+            }
+            snprintf(buf, 256, " %6.3f\n", r.perf.GetIPC());
+            outfile << buf;
+        }
+        outfile << std::endl;
+    }
+    if (results.seeded) {
+        auto test_seeds = results.test_seeds;
+        std::sort(test_seeds.begin(), test_seeds.end(),
+            [] (const TestSeedRecord &a, const TestSeedRecord &b) {
+                return (a.id != b.id) ? (a.id < b.id) : (a.shard < b.shard);
+            });
+        snprintf(buf, 256, "0x%16.16llX", (unsigned long long) results.seed);
+        outfile << "========= Seeds of tests =========" << std::endl;
+        outfile << "  Master seed: " << buf << std::endl;
+        outfile << "  Max shards per test: " << results.nshards << std::endl;
+        if (results.streams_log2 > 0) {
+            outfile << "  Streams log2 distance: " << results.streams_log2 << std::endl;
+        }
+        outfile << "  Any test may be rerun alone with the --replay=report.txt option"
+            << std::endl << std::endl;
+        snprintf(buf, 256, "  %4s %5s %7s   %18s %18s\n",
+            "ID", "SHARD", "NSHARDS", "SEED", "STREAM");
+        outfile << std::string(buf);
+        for (auto &r : test_seeds) {
+            snprintf(buf, 256, "  %4d %5d %7d   0x%16.16llX 0x%16.16llX\n", r.id,
+                (int) r.shard, (int) r.nshards, (unsigned long long) r.seed,
+                (unsigned long long) r.stream);
+            outfile << std::string(buf);
+        }
+        outfile << std::endl;
+        return;
+    }
     outfile << "========= Seeds allocator report =========" << std::endl;
     outfile << "  Number of threads: " << nthreads << std::endl;
     outfile << "  Seeds generated:   " << nseeds << std::endl;
@@ -280,7 +715,7 @@ void SaveProtocol(const BatteryResults &results, Entropy &entropy)
     outfile << std::string(buf);
     for (size_t i = 0, pos = 0; i < nthreads; i++) {
         for (size_t j = 0; j < seeds_per_thread; j++, pos++) {
-            uint64_t seed = entropy.seeds_log[pos];
+            uint64_t seed = entropy.GetLoggedSeed(pos);
             snprintf(buf, 256, "  %3d %3d %25llu 0x%16.16llX\n",
                 (int) i, (int) j,
                 (unsigned long long) seed, (unsigned long long) seed);
@@ -291,11 +726,425 @@ void SaveProtocol(const BatteryResults &results, Entropy &entropy)
 }
 
 
-void RunBattery(TestsBattery &bat, int test_id, Entropy &entropy)
+/**
+ * @brief Run the battery. Running times of tests are taken from and
+ * saved to the runtime history file (see the `--history` option).
+ */
+void RunBattery(TestsBattery &bat, int test_id, Entropy &entropy,
+    const BatteryOptions &bopts)
 {
+    bat.SetThreadPool(bopts.pool);
+    bat.SetMemLimit(bopts.mem_limit);
+    bat.SetSeed(bopts.seed);
+    bat.SetNShards(bopts.nshards);
+    bat.SetStreams(bopts.streams_log2);
+    bat.SetPerfCounters(bopts.perf);
+    std::shared_ptr<RuntimeHistory> history;
+    if (!bopts.history_file.empty()) {
+        history = std::make_shared<RuntimeHistory>(bopts.history_file);
+        if (history->Load()) {
+            std::cerr << "=====> Runtime history loaded (host: "
+                << history->GetHost() << ")" << std::endl;
+        }
+        bat.SetHistory(history);
+    }
     auto results = bat.RunTest(test_id);
     std::cout << results.report;
     SaveProtocol(results, entropy);
+    if (history != nullptr && !history->Save()) {
+        std::cerr << "Cannot save the runtime history to "
+            << bopts.history_file << std::endl;
+    }
+}
+
+/**
+ * @brief Writes the generator output to stdout (e.g. for PractRand).
+ * Generator threads, length limit and size of buffers are taken from
+ * the `--gen-threads`, `--limit` and `--buffer-size` options; substreams
+ * are used if the `--streams` option is set.
+ * @return Exit code of the program.
+ */
+int run_stdout(GenFactoryFunc create_gen, StreamFormat format,
+    const std::map<std::string, std::string> &opts, const BatteryOptions &bopts)
+{
+    StreamWriter writer(create_gen, format);
+    auto it = opts.find("gen-threads");
+    if (it != opts.end()) {
+        int n = atoi(it->second.c_str());
+        if (n <= 0) {
+            std::cerr << "Invalid number of generator threads " << it->second << std::endl;
+            return 1;
+        }
+        writer.SetNThreads(n);
+    }
+    it = opts.find("limit");
+    if (it != opts.end()) {
+        double nbytes = parse_size(it->second);
+        if (nbytes < 0.0) {
+            std::cerr << "Invalid length limit " << it->second << std::endl;
+            return 1;
+        }
+        writer.SetLimit((uint64_t) nbytes);
+    }
+    it = opts.find("buffer-size");
+    if (it != opts.end()) {
+        double nbytes = parse_size(it->second);
+        if (nbytes < 0.0) {
+            std::cerr << "Invalid buffer size " << it->second << std::endl;
+            return 1;
+        }
+        writer.SetBufferSize((size_t) nbytes);
+    }
+    if (bopts.streams_log2 > 0) {
+        writer.SetStreams(bopts.streams_log2, bopts.seed);
+    }
+    it = opts.find("vmsplice");
+    if (it != opts.end()) {
+        writer.SetZeroCopy(it->second != "0");
+    }
+#ifdef SIGPIPE
+    // Closed pipe (e.g. PractRand finished) is reported by write
+    // instead of killing the process: the speed report is printed.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    set_bin_stdout();
+    fflush(stdout);
+    writer.Run(fileno(stdout));
+    return 0;
+}
+
+/**
+ * @brief Sets the number of repetitions and the duration of one repetition
+ * of the speed harness from the `--reps` and `--sample-time` options;
+ * hardware counters are enabled by the `--perf` option.
+ * @return true on success, false in the case of invalid option.
+ */
+bool get_speed_harness(const std::map<std::string, std::string> &opts,
+    SpeedHarness &harness)
+{
+    auto it = opts.find("reps");
+    if (it != opts.end()) {
+        int n = atoi(it->second.c_str());
+        if (n <= 0) {
+            std::cerr << "Invalid number of repetitions " << it->second << std::endl;
+            return false;
+        }
+        harness.SetNRepeats(n);
+    }
+    it = opts.find("sample-time");
+    if (it != opts.end()) {
+        double ms = atof(it->second.c_str());
+        if (ms <= 0.0) {
+            std::cerr << "Invalid duration of repetition " << it->second << std::endl;
+            return false;
+        }
+        harness.SetSampleTime(ms);
+    }
+    it = opts.find("perf");
+    harness.SetPerfCounters(it != opts.end() && it->second != "0");
+    return true;
+}
+
+/**
+ * @brief Returns the short name of the module from the name of its
+ * library, e.g. "chacha_avx" for "bin/libchacha_avx_shared.so".
+ */
+std::string module_short_name(const std::string &libname)
+{
+    std::string name = libname.substr(libname.find_last_of("/\\") + 1);
+    name = name.substr(0, name.find('.'));
+    if (name.compare(0, 3, "lib") == 0) {
+        name = name.substr(3);
+    }
+    size_t pos = name.rfind("_shared");
+    if (pos != std::string::npos && pos + 7 == name.size()) {
+        name = name.substr(0, pos);
+    }
+    return name;
+}
+
+/**
+ * @brief Saves the speed test results to the files given by the `--json`
+ * and `--csv` options.
+ * @return true on success, false otherwise.
+ */
+bool save_speed_results(const std::map<std::string, std::string> &opts,
+    const std::vector<SpeedRecord> &records)
+{
+    auto it = opts.find("json");
+    if (it != opts.end() && !save_speed_json(it->second, records)) {
+        return false;
+    }
+    it = opts.find("csv");
+    if (it != opts.end() && !save_speed_csv(it->second, records)) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the speed test (`speed`, `speed-mt` modes) or compares its
+ * results with the baseline saved by the `--json` option (`speed-compare`
+ * mode). Results are saved to the files given by the `--json` and `--csv`
+ * options.
+ * @param baseline  Name of the baseline JSON file (only for `speed-compare`).
+ * @return Exit code of the program: 1 if regressions are found.
+ */
+int run_speed(const std::string &battery, const std::string &module_name,
+    GenFactoryFunc create_gen, const GenInfoC &geninfo,
+    const std::map<std::string, std::string> &opts,
+    const BatteryOptions &bopts, const std::string &baseline)
+{
+    SpeedHarness harness;
+    if (!get_speed_harness(opts, harness)) {
+        return 1;
+    }
+    double threshold = 0.1;
+    auto it = opts.find("threshold");
+    if (it != opts.end()) {
+        threshold = atof(it->second.c_str()) / 100.0;
+        if (threshold <= 0.0) {
+            std::cerr << "Invalid regression threshold " << it->second << std::endl;
+            return 1;
+        }
+    }
+    std::vector<SpeedRecord> base;
+    bool run_mt = (battery == "speed-mt");
+    if (battery == "speed-compare") {
+        if (!load_speed_json(baseline, base)) {
+            return 1;
+        }
+        for (auto &r : base) {
+            run_mt = run_mt || (r.nthreads > 1);
+        }
+    }
+    std::vector<SpeedRecord> records;
+    if (battery != "speed-mt") {
+        records = test_battery_speed(create_gen, geninfo, harness);
+    }
+    if (run_mt) {
+        // One-threaded results are taken from the more precise scalar test
+        for (auto &r : test_battery_speed_mt(create_gen, geninfo, bopts.pool, harness)) {
+            if (records.empty() || r.nthreads > 1) {
+                records.push_back(r);
+            }
+        }
+    }
+    for (auto &r : records) {
+        r.module = module_short_name(module_name);
+    }
+    if (!save_speed_results(opts, records)) {
+        return 1;
+    }
+    if (battery == "speed-compare") {
+        std::cout << "----- Comparison with " << baseline << " (threshold "
+            << 100.0 * threshold << "%) -----" << std::endl;
+        size_t nregressions = compare_speed(base, records, threshold);
+        std::cout << "Regressions found: " << nregressions << std::endl;
+        return (nregressions > 0) ? 1 : 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Warns if the CPU frequency may change between measurements:
+ * the cpufreq governor is not "performance" or turbo boost is enabled
+ * (Linux only).
+ */
+void check_cpu_frequency()
+{
+#if defined(__linux__)
+    std::ifstream gov_file("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
+    std::string governor;
+    if (gov_file >> governor && governor != "performance") {
+        std::cerr << "=====> CPU frequency governor is '" << governor
+            << "'; 'performance' gives more reproducible results" << std::endl;
+    }
+    std::ifstream turbo_file("/sys/devices/system/cpu/intel_pstate/no_turbo");
+    int no_turbo = 1;
+    if (turbo_file >> no_turbo && no_turbo == 0) {
+        std::cerr << "=====> Turbo boost is enabled: results depend on "
+            "the CPU temperature" << std::endl;
+    }
+#endif
+}
+
+/**
+ * @brief Prints the table of corrected CPU ticks per byte for all modules
+ * sorted by the speed of the uint32 interface (the fastest first).
+ */
+void print_speed_table(const std::vector<SpeedRecord> &records)
+{
+    static const char *interfaces[] = {"u01", "u32", "u64", "array32", "array64"};
+    std::map<std::string, std::map<std::string, double>> cpb;
+    for (auto &r : records) {
+        cpb[r.module][r.interface] = r.cpb;
+    }
+    std::vector<std::string> modules;
+    for (auto &m : cpb) {
+        modules.push_back(m.first);
+    }
+    std::stable_sort(modules.begin(), modules.end(),
+        [&cpb] (const std::string &a, const std::string &b) {
+            return cpb[a]["u32"] < cpb[b]["u32"];
+        });
+    char buf[128];
+    std::cout << "----- Corrected CPU ticks per byte (cpb) -----" << std::endl;
+    snprintf(buf, 128, " %-20s", "Module name");
+    std::cout << buf;
+    for (auto name : interfaces) {
+        snprintf(buf, 128, " | %-8s", name);
+        std::cout << buf;
+    }
+    std::cout << std::endl;
+    for (auto &m : modules) {
+        snprintf(buf, 128, " %-20s", m.c_str());
+        std::cout << buf;
+        for (auto name : interfaces) {
+            auto it = cpb[m].find(name);
+            if (it != cpb[m].end()) {
+                snprintf(buf, 128, " | %-8.3f", it->second);
+            } else {
+                snprintf(buf, 128, " | %-8s", "-");
+            }
+            std::cout << buf;
+        }
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * @brief Measures performance of all modules (`*_shared` dynamic libraries)
+ * from the directory by the same harness. All measurements are made by one
+ * worker pinned to the same CPU. Results are printed as the table and saved
+ * to the files given by the `--json` and `--csv` options.
+ * @return Exit code of the program.
+ */
+int run_speed_all(const std::string &dirname, const std::map<std::string, std::string> &opts)
+{
+    SpeedHarness harness;
+    if (!get_speed_harness(opts, harness)) {
+        return 1;
+    }
+#ifdef USE_LOADLIBRARY
+    auto libnames = list_directory(dirname, "*_shared.dll");
+#else
+    auto libnames = list_directory(dirname, "*_shared.so");
+#endif
+    if (libnames.empty()) {
+        std::cerr << "No modules were found in " << dirname << std::endl;
+        return 1;
+    }
+    check_cpu_frequency();
+    ThreadPool pool(1, AFFINITY_COMPACT);
+    CallerAPI intf = get_caller_api();
+    std::vector<SpeedRecord> records;
+    for (auto &libname : libnames) {
+        std::cout << "===== Module " << libname << " =====" << std::endl;
+        GenCModule mod;
+        auto handle = open_module(mod, libname.c_str());
+        if (handle == nullptr) {
+            std::cerr << "=====> Cannot load the module " << libname << ", skipped" << std::endl;
+            continue;
+        }
+        GenInfoC geninfo;
+        GenInfoC_init(&geninfo);
+        mod.gen_initlib(&intf);
+        if (!GenCModule_getinfo(&mod, &geninfo)) {
+            std::cerr << "=====> PRNG `gen_getinfo` function failed, "
+                << libname << " is skipped" << std::endl;
+            mod.gen_closelib();
+            continue;
+        }
+        auto create_gen = [&geninfo] () -> std::shared_ptr<UniformGenerator> {
+            return std::shared_ptr<UniformGenerator>(new UniformGeneratorC(&geninfo));
+        };
+        std::vector<SpeedRecord> mod_records;
+        pool.SubmitPinned([&] (size_t) {
+            mod_records = test_battery_speed(create_gen, geninfo, harness);
+        }, 0);
+        pool.Wait();
+        for (auto &r : mod_records) {
+            r.module = module_short_name(libname);
+            records.push_back(r);
+        }
+        mod.gen_closelib();
+        std::cout << std::endl;
+    }
+    print_speed_table(records);
+    return save_speed_results(opts, records) ? 0 : 1;
+}
+
+/**
+ * @brief Writes 2^K bytes of the generator output to the file given by
+ * the `--file` option. Generators with native 64-bit outputs are dumped
+ * by 64-bit words, other ones by 32-bit words: jumps and positions in
+ * the file are then counted in the same outputs.
+ * @return Exit code of the program.
+ */
+int run_dump(GenFactoryFunc create_gen, const GenInfoC &geninfo,
+    const std::map<std::string, std::string> &opts, const BatteryOptions &bopts)
+{
+    auto it = opts.find("file");
+    if (it == opts.end() || it->second.empty()) {
+        std::cerr << "The output file must be set by the --file option" << std::endl;
+        return 1;
+    }
+    bool vectorized = (geninfo.flags & GENINFOC_FLAG_VECTORIZED) != 0;
+    StreamFormat format;
+    if ((geninfo.flags & GENINFOC_FLAG_NATIVE64) && geninfo.get_bits64 != nullptr) {
+        format = (vectorized && geninfo.get_array64 != nullptr) ? STREAM_ARRAY64 : STREAM_BITS64;
+    } else {
+        format = (vectorized && geninfo.get_array32 != nullptr) ? STREAM_ARRAY32 : STREAM_BITS32;
+    }
+    FileDump dump(create_gen, format, it->second);
+    dump.SetNativeWordSize((geninfo.flags & GENINFOC_FLAG_NATIVE64) ?
+        sizeof(uint64_t) : sizeof(uint32_t));
+    dump.SetSeed(bopts.seed);
+    dump.SetNThreads(std::thread::hardware_concurrency());
+    it = opts.find("log2-size");
+    if (it != opts.end()) {
+        int k = atoi(it->second.c_str());
+        if (k < 12 || k > 62) {
+            std::cerr << "Invalid log2 of file size " << it->second
+                << " (must be 12..62)" << std::endl;
+            return 1;
+        }
+        dump.SetSizeLog2(k);
+    }
+    it = opts.find("gen-threads");
+    if (it != opts.end()) {
+        int n = atoi(it->second.c_str());
+        if (n <= 0) {
+            std::cerr << "Invalid number of generator threads " << it->second << std::endl;
+            return 1;
+        }
+        dump.SetNThreads(n);
+    }
+    it = opts.find("buffer-size");
+    if (it != opts.end()) {
+        double nbytes = parse_size(it->second);
+        if (nbytes < 0.0) {
+            std::cerr << "Invalid buffer size " << it->second << std::endl;
+            return 1;
+        }
+        dump.SetBufferSize((size_t) nbytes);
+    }
+    it = opts.find("checkpoint");
+    if (it != opts.end()) {
+        double sec = atof(it->second.c_str());
+        if (sec <= 0.0) {
+            std::cerr << "Invalid checkpoint interval " << it->second << std::endl;
+            return 1;
+        }
+        dump.SetCheckpointInterval(sec);
+    }
+    it = opts.find("direct");
+    if (it != opts.end()) {
+        dump.SetDirectIO(it->second != "0");
+    }
+    bool resume = opts.find("resume") != opts.end();
+    return dump.Run(resume) ? 0 : 1;
 }
 
 /**
@@ -304,20 +1153,61 @@ void RunBattery(TestsBattery &bat, int test_id, Entropy &entropy)
 int main(int argc, char *argv[]) 
 {
     // Get command line arguments
-    if (argc < 3) {
+    std::map<std::string, std::string> opts;
+    auto args = parse_options(argc, argv, opts);
+    if (args.size() < 3) {
         print_help();
         //std::cout << entropy.XxteaTest() << std::endl;
         //std::cout << entropy.Seed64() << std::endl;
         //std::cout << entropy.Seed64() << std::endl;
         return 0;
     }
-    std::string battery = argv[1];
-    const char *module_name = argv[2];
-    int test_id = get_test_id(argc, argv);
-    std::string gen_options = get_gen_options(argc, argv);
+    std::string battery = args[1];
+    const char *module_name = args[2].c_str();
+    // The third argument of the `speed-compare` mode is the baseline file
+    int test_id = (battery == "speed-compare") ? -1 : get_test_id(args);
+    std::string gen_options = get_gen_options(args);
     if (test_id == 0) {
         return 0;
     }
+    if (battery == "speed-all") {
+        if (!set_entropy_method(opts)) {
+            return 1;
+        }
+        return run_speed_all(args[2], opts);
+    }
+    if (battery == "speed-compare" && args.size() < 4) {
+        std::cerr << "The baseline JSON file must be set for speed-compare" << std::endl;
+        return 1;
+    }
+    BatteryOptions bopts;
+    if (!set_entropy_method(opts)) {
+        return 1;
+    }
+    bopts.mem_limit = get_mem_limit(opts);
+    if (bopts.mem_limit < 0.0) {
+        return 1;
+    }
+    bopts.pool = create_thread_pool(opts);
+    if (bopts.pool == nullptr) {
+        return 1;
+    }
+    if (!get_streams(opts, bopts) || !get_seed(opts, bopts)) {
+        return 1;
+    }
+    auto perf_opt = opts.find("perf");
+    bopts.perf = (perf_opt != opts.end() && perf_opt->second != "0");
+    auto hist_opt = opts.find("history");
+    if (hist_opt != opts.end() && hist_opt->second == "0") {
+        bopts.history_file.clear();
+    } else if (hist_opt != opts.end() && !hist_opt->second.empty()) {
+        bopts.history_file = hist_opt->second;
+    }
+    // Generators of serial batteries and stdout modes are created
+    // in the main thread: an explicit seed makes them reproducible.
+    if (opts.find("seed") != opts.end()) {
+        Entropy::SetThreadSeed(bopts.seed);
+    }
 
     GenCModule mod;
     if (!load_module(mod, module_name)) {
@@ -330,27 +1220,55 @@ int main(int argc, char *argv[])
     GenInfoC_init(&geninfo);
     geninfo.options = gen_options.c_str();
     mod.gen_initlib(&intf);
-    if (!mod.gen_getinfo(&geninfo)) {
+    if (!GenCModule_getinfo(&mod, &geninfo)) {
         std::cerr << "Error: PRNG `gen_getinfo` function failed" << std::endl;
         return 1;
     }
 
-    auto create_gen = [&geninfo] () -> std::shared_ptr<UniformGenerator> {
+    if (bopts.streams_log2 > 0 && geninfo.jump == nullptr) {
+        std::cerr << "This PRNG doesn't support jumps, "
+            "--streams option is ignored" << std::endl;
+        bopts.streams_log2 = 0;
+    }
+    if (bopts.streams_log2 > 0 && geninfo.period_log2 > 0 &&
+        bopts.streams_log2 >= geninfo.period_log2) {
+        std::cerr << "Invalid substreams length 2^" << bopts.streams_log2
+            << ": the period of this PRNG is 2^" << geninfo.period_log2 << std::endl;
+        return 1;
+    }
+
+    // Buffering may change the sequence seen by TestU01 (e.g. 64-bit
+    // outputs are split into halves), so it is enabled only by --buffered.
+    auto buf_opt = opts.find("buffered");
+    bool buffered = (buf_opt != opts.end() && buf_opt->second != "0");
+    if (buffered && !UniformGeneratorCBuffered::IsSupported(&geninfo)) {
+        std::cerr << "This PRNG doesn't support vectorized mode, "
+            "--buffered option is ignored" << std::endl;
+        buffered = false;
+    }
+    auto create_gen_plain = [&geninfo] () -> std::shared_ptr<UniformGenerator> {
         return std::shared_ptr<UniformGenerator>(new UniformGeneratorC(&geninfo));
     };
+    auto create_gen = [&geninfo, buffered] () -> std::shared_ptr<UniformGenerator> {
+        if (buffered) {
+            return std::shared_ptr<UniformGenerator>(new UniformGeneratorCBuffered(&geninfo));
+        } else {
+            return std::shared_ptr<UniformGenerator>(new UniformGeneratorC(&geninfo));
+        }
+    };
     // Run the selected battery
     if (battery == "SmallCrush") {
         SmallCrushBattery bat(create_gen);
-        RunBattery(bat, test_id, entropy);
+        RunBattery(bat, test_id, entropy, bopts);
     } else if (battery == "Crush") {
         CrushBattery bat(create_gen);
-        RunBattery(bat, test_id, entropy);
+        RunBattery(bat, test_id, entropy, bopts);
     } else if (battery == "BigCrush") {
         BigCrushBattery bat(create_gen);
-        RunBattery(bat, test_id, entropy);
+        RunBattery(bat, test_id, entropy, bopts);
     } else if (battery == "pseudoDIEHARD") {
         PseudoDiehardBattery bat(create_gen);
-        RunBattery(bat, test_id, entropy);
+        RunBattery(bat, test_id, entropy, bopts);
     } else if (battery == "SmallCrush_ser") {
         auto objptr = create_gen();
         bbattery_SmallCrush(objptr->GetPtr());
@@ -364,27 +1282,34 @@ int main(int argc, char *argv[])
         auto objptr = create_gen();
         bbattery_pseudoDIEHARD(objptr->GetPtr());
     } else if (battery == "stdout32") {
-        prng_bits32_to_file(create_gen());
+        bool arr = buffered && geninfo.get_array32 != nullptr;
+        return run_stdout(create_gen, arr ? STREAM_ARRAY32 : STREAM_BITS32, opts, bopts);
     } else if (battery == "stdout32v") {
         if (geninfo.get_array32 == nullptr) {
             std::cerr << "This PRNG doesn't support vectorized 32-bit mode" << std::endl;
             return 1;
         }
-        prng_array32_to_file(create_gen());
+        return run_stdout(create_gen, STREAM_ARRAY32, opts, bopts);
     } else if (battery == "stdout64") {
         if (geninfo.get_bits64 == nullptr) {
             std::cerr << "This PRNG doesn't support 64-bit mode" << std::endl;
             return 1;
         }
-        prng_bits64_to_file(create_gen());
+        bool arr = buffered && geninfo.get_array64 != nullptr;
+        return run_stdout(create_gen, arr ? STREAM_ARRAY64 : STREAM_BITS64, opts, bopts);
     } else if (battery == "stdout64v") {
         if (geninfo.get_array64 == nullptr) {
             std::cerr << "This PRNG doesn't support vectorized 64-bit mode" << std::endl;
             return 1;
         }
-        prng_array64_to_file(create_gen());
-    } else if (battery == "speed") {
-        test_battery_speed(create_gen, geninfo);
+        return run_stdout(create_gen, STREAM_ARRAY64, opts, bopts);
+    } else if (battery == "dump") {
+        return run_dump(create_gen, geninfo, opts, bopts);
+    } else if (battery == "speed" || battery == "speed-mt" || battery == "speed-compare") {
+        int ans = run_speed(battery, module_name, create_gen_plain, geninfo, opts, bopts,
+            (args.size() >= 4) ? args[3] : "");
+        mod.gen_closelib();
+        return ans;
     } else if (battery == "selftest") {
         return run_self_test(geninfo);
     } else {
@@ -0,0 +1,469 @@
+#include "testu01th/thread_pool.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace testu01_threads;
+
+/**
+ * @brief The pool and the index of the worker that runs in the current
+ * thread (nullptr for threads that are not workers). Used by `Wait(group)`.
+ */
+static thread_local const ThreadPool *current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+/**
+ * @brief Converts the policy name (none, compact, scatter, node)
+ * to the AffinityPolicy value.
+ * @return true if the name is valid, false otherwise.
+ */
+bool testu01_threads::parse_affinity_policy(const std::string &name,
+    AffinityPolicy &policy)
+{
+    if (name == "none") {
+        policy = AFFINITY_NONE;
+    } else if (name == "compact") {
+        policy = AFFINITY_COMPACT;
+    } else if (name == "scatter") {
+        policy = AFFINITY_SCATTER;
+    } else if (name == "node" || name == "per-node") {
+        policy = AFFINITY_NODE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//////////////////////////////////////////////
+///// CpuTopology class implementation /////
+//////////////////////////////////////////////
+
+/**
+ * @brief Parses the Linux CPU list such as `0-7,16-23`.
+ */
+static std::vector<int> parse_cpulist(const std::string &txt)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(txt);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int a, b;
+        if (sscanf(item.c_str(), "%d-%d", &a, &b) == 2) {
+            for (int i = a; i <= b; i++) {
+                cpus.push_back(i);
+            }
+        } else if (sscanf(item.c_str(), "%d", &a) == 1) {
+            cpus.push_back(a);
+        }
+    }
+    return cpus;
+}
+
+/**
+ * @brief Detects NUMA nodes and their CPUs.
+ */
+CpuTopology CpuTopology::Detect()
+{
+    CpuTopology topo;
+#if defined(__linux__)
+    for (int i = 0; ; i++) {
+        std::ifstream infile("/sys/devices/system/node/node" +
+            std::to_string(i) + "/cpulist");
+        if (!infile.is_open()) {
+            break;
+        }
+        std::string txt;
+        std::getline(infile, txt);
+        auto cpus = parse_cpulist(txt);
+        if (!cpus.empty()) {
+            topo.nodes.push_back(cpus);
+        }
+    }
+#endif
+    if (topo.nodes.empty()) {
+        size_t ncpus = std::thread::hardware_concurrency();
+        std::vector<int> cpus;
+        for (size_t i = 0; i < ncpus || i == 0; i++) {
+            cpus.push_back((int) i);
+        }
+        topo.nodes.push_back(cpus);
+    }
+    return topo;
+}
+
+size_t CpuTopology::GetNCpus() const
+{
+    size_t ncpus = 0;
+    for (auto &n : nodes) {
+        ncpus += n.size();
+    }
+    return ncpus;
+}
+
+/**
+ * @brief Returns the set of CPUs for the worker.
+ * @param worker_id  Worker index.
+ * @param nworkers   Total number of workers.
+ * @param policy     Affinity policy.
+ * @return List of CPUs (empty for AFFINITY_NONE).
+ */
+std::vector<int> CpuTopology::GetWorkerCpus(size_t worker_id, size_t nworkers,
+    AffinityPolicy policy) const
+{
+    std::vector<int> cpus;
+    size_t nnodes = nodes.size(), ncpus = GetNCpus();
+    if (nnodes == 0 || ncpus == 0) {
+        return cpus;
+    }
+    if (policy == AFFINITY_COMPACT) {
+        size_t ind = worker_id % ncpus;
+        for (auto &n : nodes) {
+            if (ind < n.size()) {
+                cpus.push_back(n[ind]);
+                break;
+            }
+            ind -= n.size();
+        }
+    } else if (policy == AFFINITY_SCATTER) {
+        const std::vector<int> &n = nodes[worker_id % nnodes];
+        cpus.push_back(n[(worker_id / nnodes) % n.size()]);
+    } else if (policy == AFFINITY_NODE) {
+        if (nworkers == 0) {
+            nworkers = 1;
+        }
+        cpus = nodes[(worker_id * nnodes / nworkers) % nnodes];
+    }
+    return cpus;
+}
+
+/////////////////////////////////////////////
+///// ThreadPool class implementation /////
+/////////////////////////////////////////////
+
+/**
+ * @brief Creates the pool and starts its worker threads.
+ * @param nthreads  Number of threads (0 - number of hardware threads).
+ * @param affinity_ Policy of binding of workers to CPUs.
+ */
+ThreadPool::ThreadPool(size_t nthreads, AffinityPolicy affinity_)
+    : nqueued(0), npending(0), nactive(0), next_queue(0), stop(false),
+    affinity(affinity_), topology(CpuTopology::Detect())
+{
+    if (nthreads == 0) {
+        nthreads = std::thread::hardware_concurrency();
+    }
+    if (nthreads == 0) {
+        nthreads = 1;
+    }
+    for (size_t i = 0; i < nthreads; i++) {
+        queues.emplace_back(new WorkerQueue);
+    }
+    nactive = nthreads;
+    for (size_t i = 0; i < nthreads; i++) {
+        threads.emplace_back(&ThreadPool::WorkerFunc, this, i);
+    }
+}
+
+/**
+ * @brief Waits for all tasks and stops worker threads.
+ */
+ThreadPool::~ThreadPool()
+{
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stop = true;
+    }
+    cv_work.notify_all();
+    for (auto &th : threads) {
+        th.join();
+    }
+}
+
+/**
+ * @brief Returns the pool shared by all batteries of the program.
+ * It has one worker per hardware thread.
+ */
+std::shared_ptr<ThreadPool> ThreadPool::GetGlobal()
+{
+    static std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>();
+    return pool;
+}
+
+/**
+ * @brief Sets the number of workers that take tasks. Other workers
+ * are sleeping.
+ */
+void ThreadPool::SetNActive(size_t n)
+{
+    if (n == 0 || n > threads.size()) {
+        n = threads.size();
+    }
+    nactive = n;
+    next_queue = 0;
+    cv_work.notify_all();
+}
+
+/**
+ * @brief Pins the calling worker thread to CPUs according to the
+ * affinity policy. Errors are reported but not fatal.
+ */
+void ThreadPool::PinWorker(size_t id)
+{
+    auto cpus = topology.GetWorkerCpus(id, queues.size(), affinity);
+    if (cpus.empty()) {
+        return;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    DWORD_PTR mask = 0;
+    for (int c : cpus) {
+        if (c < (int) (8 * sizeof(DWORD_PTR))) {
+            mask |= ((DWORD_PTR) 1) << c;
+        }
+    }
+    if (mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0) {
+        fprintf(stderr, "Cannot set affinity of the worker %d\n", (int) id);
+    }
+#elif defined(__linux__)
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (int c : cpus) {
+        CPU_SET(c, &cpuset);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
+        fprintf(stderr, "Cannot set affinity of the worker %d\n", (int) id);
+    }
+#else
+    fprintf(stderr, "CPU affinity is not supported on this platform\n");
+#endif
+}
+
+/**
+ * @brief Takes the first task from the queue of the worker.
+ * @param group  If not nullptr, only tasks of this group are taken.
+ */
+bool ThreadPool::TryPop(size_t id, QueuedTask &task, const TaskGroup *group)
+{
+    WorkerQueue &q = *queues[id];
+    std::lock_guard<std::mutex> lock(q.mut);
+    auto it = q.tasks.begin();
+    if (group != nullptr) {
+        while (it != q.tasks.end() && it->group != group) {
+            ++it;
+        }
+    }
+    if (it == q.tasks.end()) {
+        return false;
+    }
+    task = std::move(*it);
+    q.tasks.erase(it);
+    nqueued--;
+    if (task.group != nullptr) {
+        task.group->nqueued--;
+    }
+    return true;
+}
+
+/**
+ * @brief Steals the task from other workers. Pinned tasks are not stolen.
+ * @param group  If not nullptr, only tasks of this group are taken.
+ */
+bool ThreadPool::TrySteal(size_t id, QueuedTask &task, const TaskGroup *group)
+{
+    size_t n = queues.size();
+    for (size_t i = 1; i < n; i++) {
+        if (TryPop((id + i) % n, task, group)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Runs the task and updates counters of the pool and of the group.
+ * Waiters are woken up when the last task of the pool or of the group
+ * is finished.
+ */
+void ThreadPool::RunTask(size_t id, QueuedTask &task)
+{
+    task.func(id);
+    bool group_done = (task.group != nullptr && --task.group->npending == 0);
+    if (--npending == 0 || group_done) {
+        std::lock_guard<std::mutex> lock(mut);
+        cv_done.notify_all();
+    }
+}
+
+
+void ThreadPool::WorkerFunc(size_t id)
+{
+    PinWorker(id);
+    current_pool = this;
+    current_worker = id;
+    while (true) {
+        QueuedTask task;
+        bool found = false;
+        WorkerQueue &q = *queues[id];
+        if (q.npinned > 0) {
+            std::lock_guard<std::mutex> lock(q.mut);
+            task.func = std::move(q.pinned.front());
+            q.pinned.pop_front();
+            q.npinned--;
+            found = true;
+        }
+        if (!found && id < nactive) {
+            found = TryPop(id, task) || TrySteal(id, task);
+        }
+        if (found) {
+            RunTask(id, task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mut);
+        cv_work.wait(lock, [this, id] {
+            return stop || queues[id]->npinned > 0 ||
+                (nqueued > 0 && id < nactive);
+        });
+        if (stop) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Pushes the task to the queue of the given worker and wakes up
+ * workers (and threads that wait for the group of the task).
+ */
+void ThreadPool::Push(QueuedTask task, size_t worker_id)
+{
+    // Counters are incremented before pushing the task: the worker
+    // may take it before the end of this function.
+    npending++;
+    nqueued++;
+    TaskGroup *group = task.group;
+    if (group != nullptr) {
+        group->npending++;
+        group->nqueued++;
+    }
+    {
+        WorkerQueue &q = *queues[worker_id % nactive];
+        std::lock_guard<std::mutex> lock(q.mut);
+        q.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mut);
+    }
+    cv_work.notify_all();
+    if (group != nullptr) {
+        cv_done.notify_all();
+    }
+}
+
+/**
+ * @brief Submits the task to the queue of the given worker. Other
+ * workers may steal it.
+ */
+void ThreadPool::Submit(PoolTask task, size_t worker_id)
+{
+    Push(QueuedTask(std::move(task)), worker_id);
+}
+
+/**
+ * @brief Submits the task to the queues of active workers
+ * in the round-robin order.
+ */
+void ThreadPool::Submit(PoolTask task)
+{
+    Submit(std::move(task), next_queue++);
+}
+
+/**
+ * @brief Submits the tasks to the queues of active workers in the
+ * round-robin order, so each queue keeps the order of tasks.
+ */
+void ThreadPool::Submit(const std::vector<PoolTask> &tasks)
+{
+    for (auto &t : tasks) {
+        Submit(t);
+    }
+}
+
+/**
+ * @brief Submits the task of the group. Can be called from tasks for
+ * submission of sub-tasks: the sub-task is put to the own queue of the
+ * worker, so it is likely to be run by the same worker.
+ */
+void ThreadPool::Submit(TaskGroup &group, PoolTask task)
+{
+    size_t worker_id = (current_pool == this) ? current_worker : next_queue++;
+    Push(QueuedTask(std::move(task), &group), worker_id);
+}
+
+/**
+ * @brief Submits the tasks of the group to the queues of active workers
+ * in the round-robin order, so each queue keeps the order of tasks.
+ */
+void ThreadPool::Submit(TaskGroup &group, const std::vector<PoolTask> &tasks)
+{
+    for (auto &t : tasks) {
+        Push(QueuedTask(t, &group), next_queue++);
+    }
+}
+
+/**
+ * @brief Submits the task that will be run only by the given worker
+ * (even if it is not active).
+ */
+void ThreadPool::SubmitPinned(PoolTask task, size_t worker_id)
+{
+    npending++;
+    {
+        WorkerQueue &q = *queues[worker_id % queues.size()];
+        std::lock_guard<std::mutex> lock(q.mut);
+        q.pinned.push_back(std::move(task));
+        q.npinned++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mut);
+    }
+    cv_work.notify_all();
+}
+
+/**
+ * @brief Waits until all submitted tasks (and their sub-tasks)
+ * are finished. Must not be called from tasks.
+ */
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(mut);
+    cv_done.wait(lock, [this] { return npending == 0; });
+}
+
+/**
+ * @brief Waits until all tasks of the group are finished. If it is called
+ * from the task (i.e. by the worker of this pool) then the worker runs
+ * queued tasks of the group while waiting, so nested waits don't block
+ * the pool. Other threads just sleep.
+ */
+void ThreadPool::Wait(TaskGroup &group)
+{
+    bool is_worker = (current_pool == this);
+    size_t id = current_worker;
+    while (group.npending > 0) {
+        QueuedTask task;
+        if (is_worker && (TryPop(id, task, &group) || TrySteal(id, task, &group))) {
+            RunTask(id, task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mut);
+        cv_done.wait(lock, [&group, is_worker] {
+            return group.npending == 0 || (is_worker && group.nqueued > 0);
+        });
+    }
+}